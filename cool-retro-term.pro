@@ -4,6 +4,7 @@ CONFIG += ordered
 
 SUBDIRS += qmltermwidget
 SUBDIRS += daemon
+SUBDIRS += daemon/ctl
 SUBDIRS += app
 
 desktop.files += cool-retro-term.desktop
@@ -0,0 +1,615 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// End-to-end load generator for crt-sessiond. Starts a private daemon,
+// creates N sessions running synthetic producers (this same binary in
+// --produce mode), attaches M clients that read at a configurable rate,
+// and reports throughput, input->echo latency, replay time and daemon
+// CPU/RSS as JSON on stdout. With --synthetic the daemon's in-process
+// generators replace the producer processes, so session counts in the
+// thousands measure the daemon rather than fork/exec.
+//
+//   crt-sessiond-bench [--daemon PATH] [--sessions N] [--clients M]
+//                      [--producers flood,fixed,burst,echo] [--rate B/s]
+//                      [--read-rate B/s] [--duration SECS] [--synthetic]
+//                      [--daemon-arg ARG]...
+
+#include "../clock.h"
+#include "../protocol.h"
+#include "../sync_client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// -------------------------------------------------------------------
+// Producers (run inside the daemon's sessions)
+// -------------------------------------------------------------------
+
+static bool write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Build-log-like text, a few KB, used by the paced producers
+static std::string producer_text() {
+    std::string text;
+    for (int i = 0; text.size() < 8192; i++)
+        text += "compiling src/module" + std::to_string(i) +
+                ".cpp -> build/module" + std::to_string(i) + ".o  [ok]\r\n";
+    return text;
+}
+
+static int run_producer(const char *mode, uint64_t rate) {
+    signal(SIGPIPE, SIG_DFL);
+    if (strcmp(mode, "flood") == 0) {
+        // `yes`: as fast as the PTY takes it
+        std::string buf;
+        while (buf.size() < 16384)
+            buf += "y\r\n";
+        while (write_all(STDOUT_FILENO, buf.data(), buf.size())) {}
+    } else if (strcmp(mode, "fixed") == 0 || strcmp(mode, "burst") == 0) {
+        // fixed: rate bytes/s in 10 ms slices; burst: one second's worth
+        // of output at once, then idle for the rest of the second
+        bool burst = mode[0] == 'b';
+        std::string text = producer_text();
+        uint64_t slice_ns = burst ? 1000000000ull : 10000000ull;
+        uint64_t per_slice = std::max<uint64_t>(1, rate * slice_ns / 1000000000ull);
+        size_t pos = 0;
+        uint64_t next = monotonic_ns();
+        while (true) {
+            for (uint64_t left = per_slice; left > 0;) {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(left, text.size() - pos));
+                if (!write_all(STDOUT_FILENO, text.data() + pos, n))
+                    return 0;
+                pos = (pos + n) % text.size();
+                left -= n;
+            }
+            next += slice_ns;
+            uint64_t now = monotonic_ns();
+            if (next > now)
+                usleep(static_cast<useconds_t>((next - now) / 1000));
+        }
+    } else if (strcmp(mode, "echo") == 0) {
+        // Interactive program: raw mode, write back whatever arrives
+        struct termios t;
+        if (tcgetattr(STDIN_FILENO, &t) == 0) {
+            cfmakeraw(&t);
+            tcsetattr(STDIN_FILENO, TCSANOW, &t);
+        }
+        char buf[4096];
+        while (true) {
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0 || !write_all(STDOUT_FILENO, buf, static_cast<size_t>(n)))
+                break;
+        }
+    } else {
+        fprintf(stderr, "unknown producer: %s\n", mode);
+        return 1;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// Benchmark configuration and results
+// -------------------------------------------------------------------
+
+struct BenchConfig {
+    std::string daemon = "./crt-sessiond";
+    std::vector<std::string> daemon_args;
+    std::string self;                       // Absolute path of this binary
+    std::vector<std::string> producers = {"flood", "fixed", "burst", "echo"};
+    int sessions = 4;
+    int clients = 1;
+    uint64_t rate = 1024 * 1024;            // fixed/burst producers, bytes/s
+    uint64_t read_rate = 0;                 // Per client, bytes/s (0 = unlimited)
+    double duration = 5.0;
+    double warmup = 0.5;
+    bool synthetic = false;                 // Daemon-side generators (--synthetic)
+    uint64_t probe_interval_ns = 20000000;  // Echo probes every 20 ms
+};
+
+struct BenchSession {
+    std::string uuid;
+    std::string producer;
+    uint64_t bytes = 0;                     // OUTPUT payload in the window
+    std::string tail;                       // Echo: recent output, for tokens
+    uint64_t replay_ns = 0;
+    uint64_t replay_bytes = 0;
+};
+
+struct ClientResult {
+    std::vector<BenchSession> sessions;
+    std::vector<uint64_t> echo_ns;
+    uint64_t echo_lost = 0;
+    bool failed = false;
+    std::string error;
+};
+
+// -------------------------------------------------------------------
+// Client thread
+// -------------------------------------------------------------------
+
+static bool wait_for(SyncClient *sc, uint8_t want, std::vector<uint8_t> *payload,
+                     int timeout_ms) {
+    uint64_t deadline = monotonic_ns() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    uint8_t type;
+    while (monotonic_ns() < deadline) {
+        int left = static_cast<int>((deadline - monotonic_ns()) / 1000000) + 1;
+        if (!sync_recv(sc, &type, payload, left))
+            return false;
+        if (type == want)
+            return true;
+        if (type == MSG_ERROR)
+            return false;
+    }
+    return false;
+}
+
+static std::vector<uint8_t> create_payload(const BenchConfig &cfg, const std::string &producer) {
+    std::vector<uint8_t> p;
+    auto str = [&p](const std::string &s) {
+        uint8_t len[2];
+        write_u16_le(len, static_cast<uint16_t>(s.size()));
+        p.insert(p.end(), len, len + 2);
+        p.insert(p.end(), s.begin(), s.end());
+    };
+    auto u16 = [&p](uint16_t v) {
+        uint8_t b[2];
+        write_u16_le(b, v);
+        p.insert(p.end(), b, b + 2);
+    };
+    // [shell][argc][args...][envc][env...][cwd][rows][cols]
+    if (cfg.synthetic) {
+        // Generator pattern as the shell; ansi and utf8 flood like "flood"
+        std::string rate = "rate=" + std::to_string(cfg.rate);
+        if (producer == "echo" || producer == "ansi" || producer == "utf8") {
+            str(producer);
+            u16(0);
+        } else if (producer == "fixed" || producer == "burst") {
+            str("text");
+            u16(producer == "burst" ? 2 : 1);
+            str(rate);
+            if (producer == "burst")
+                str("burst=" + std::to_string(cfg.rate));
+        } else {
+            str("text");
+            u16(0);
+        }
+    } else {
+        str(cfg.self);
+        u16(5);
+        str("crt-sessiond-bench");
+        str("--produce");
+        str(producer);
+        str("--rate");
+        str(std::to_string(cfg.rate));
+    }
+    u16(1);
+    str("TERM=xterm-256color");
+    str("/");
+    u16(24);
+    u16(80);
+    return p;
+}
+
+// The measurement window opens once every client has created its sessions
+static std::atomic<int> g_clients_ready{0};
+static std::atomic<uint64_t> g_window_start{0};
+
+static void run_client(const BenchConfig &cfg, const std::string &socket, int index,
+                       ClientResult *out) {
+    SyncClient sc;
+    bool ready = false;
+    auto fail = [out, &sc, &ready](const char *what) {
+        out->failed = true;
+        out->error = what;
+        sync_close(&sc);
+        if (!ready)
+            g_clients_ready++;
+    };
+    if (!sync_connect(&sc, socket, DAEMON_CAPABILITIES))
+        return fail("connect");
+
+    // CREATE auto-attaches the session to this client
+    std::vector<uint8_t> payload;
+    for (int s = index; s < cfg.sessions; s += cfg.clients) {
+        BenchSession session;
+        session.producer = cfg.producers[static_cast<size_t>(s) % cfg.producers.size()];
+        std::vector<uint8_t> req = create_payload(cfg, session.producer);
+        if (!sync_send(&sc, MSG_CREATE, req.data(), static_cast<uint32_t>(req.size())) ||
+            !wait_for(&sc, MSG_CREATE_OK, &payload, 5000) || payload.size() < SESSION_ID_LEN)
+            return fail("create");
+        session.uuid.assign(reinterpret_cast<const char *>(payload.data()), SESSION_ID_LEN);
+        out->sessions.push_back(session);
+    }
+
+    // Keep draining output until the window is set
+    ready = true;
+    g_clients_ready++;
+    uint8_t type;
+    while (!g_window_start.load()) {
+        if (!sync_recv(&sc, &type, &payload, 10) && sc.fd < 0)
+            return fail("disconnected");
+    }
+    uint64_t window_start = g_window_start.load();
+    uint64_t window_end = window_start + static_cast<uint64_t>(cfg.duration * 1e9);
+
+    // Load phase: read output (rate-limited), probe echo sessions
+    uint64_t received = 0;
+    uint64_t started = monotonic_ns();
+    uint64_t probe_seq = 0;
+    struct Probe { std::string token; uint64_t sent_at = 0; };
+    std::vector<Probe> probes(out->sessions.size());
+    std::vector<uint64_t> next_probe(out->sessions.size(), window_start);
+
+    while (true) {
+        uint64_t now = monotonic_ns();
+        if (now >= window_end)
+            break;
+
+        for (size_t i = 0; i < out->sessions.size(); i++) {
+            if (out->sessions[i].producer != "echo") continue;
+            Probe &probe = probes[i];
+            if (probe.sent_at && now - probe.sent_at > 2000000000ull) {
+                out->echo_lost++;
+                probe.sent_at = 0;
+            }
+            if (probe.sent_at || now < next_probe[i]) continue;
+            probe.token = "<" + std::to_string(index) + ":" + std::to_string(probe_seq++) + ">";
+            std::vector<uint8_t> input(out->sessions[i].uuid.begin(), out->sessions[i].uuid.end());
+            input.insert(input.end(), probe.token.begin(), probe.token.end());
+            probe.sent_at = monotonic_ns();
+            next_probe[i] = probe.sent_at + cfg.probe_interval_ns;
+            if (!sync_send(&sc, MSG_INPUT, input.data(), static_cast<uint32_t>(input.size())))
+                return fail("input");
+        }
+
+        if (!sync_recv(&sc, &type, &payload, 10)) {
+            if (sc.fd < 0)
+                return fail("disconnected");
+            continue;
+        }
+        received += payload.size() + HEADER_SIZE;
+        now = monotonic_ns();
+
+        if (type == MSG_OUTPUT && payload.size() >= SESSION_ID_LEN) {
+            std::string uuid(reinterpret_cast<const char *>(payload.data()), SESSION_ID_LEN);
+            for (size_t i = 0; i < out->sessions.size(); i++) {
+                BenchSession &session = out->sessions[i];
+                if (session.uuid != uuid) continue;
+                if (now >= window_start)
+                    session.bytes += payload.size() - SESSION_ID_LEN;
+                if (session.producer == "echo" && probes[i].sent_at) {
+                    session.tail.append(reinterpret_cast<const char *>(payload.data()) + SESSION_ID_LEN,
+                                        payload.size() - SESSION_ID_LEN);
+                    if (session.tail.find(probes[i].token) != std::string::npos) {
+                        if (probes[i].sent_at >= window_start)
+                            out->echo_ns.push_back(now - probes[i].sent_at);
+                        probes[i].sent_at = 0;
+                        session.tail.clear();
+                    } else if (session.tail.size() > 256) {
+                        session.tail.erase(0, session.tail.size() - 64);
+                    }
+                }
+                break;
+            }
+        }
+
+        // Slow reader: stay at or below read_rate by sleeping off the excess
+        if (cfg.read_rate) {
+            uint64_t allowed = static_cast<uint64_t>(
+                static_cast<double>(now - started) / 1e9 * static_cast<double>(cfg.read_rate));
+            if (received > allowed) {
+                uint64_t excess_us = (received - allowed) * 1000000 / cfg.read_rate;
+                usleep(static_cast<useconds_t>(std::min<uint64_t>(excess_us, 100000)));
+            }
+        }
+    }
+
+    // Replay phase: detach, then time a full reattach replay per session
+    for (auto &session : out->sessions) {
+        const uint8_t *id = reinterpret_cast<const uint8_t *>(session.uuid.data());
+        if (!sync_send(&sc, MSG_DETACH, id, SESSION_ID_LEN) ||
+            !wait_for(&sc, MSG_DETACH_OK, &payload, 10000))
+            return fail("detach");
+        uint64_t t0 = monotonic_ns();
+        if (!sync_send(&sc, MSG_ATTACH, id, SESSION_ID_LEN))
+            return fail("attach");
+        do {
+            if (!sync_recv(&sc, &type, &payload, 30000) || type == MSG_ERROR)
+                return fail("replay");
+            if (type == MSG_REPLAY_DATA)
+                session.replay_bytes += payload.size() - SESSION_ID_LEN;
+        } while (type != MSG_REPLAY_END);
+        session.replay_ns = monotonic_ns() - t0;
+    }
+
+    for (auto &session : out->sessions) {
+        const uint8_t *id = reinterpret_cast<const uint8_t *>(session.uuid.data());
+        if (!sync_send(&sc, MSG_DESTROY, id, SESSION_ID_LEN) ||
+            !wait_for(&sc, MSG_DESTROY_OK, &payload, 10000))
+            return fail("destroy");
+    }
+    sync_close(&sc);
+}
+
+// -------------------------------------------------------------------
+// Daemon process
+// -------------------------------------------------------------------
+
+static std::string socket_path_for(const std::string &runtime_dir) {
+#if defined(__APPLE__)
+    return runtime_dir + "/crt-plus-" + std::to_string(getuid()) + "/sessiond.sock";
+#else
+    return runtime_dir + "/crt-plus/sessiond.sock";
+#endif
+}
+
+static pid_t start_daemon(const BenchConfig &cfg, const std::string &runtime_dir) {
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+    setenv("XDG_RUNTIME_DIR", runtime_dir.c_str(), 1);
+    setenv("TMPDIR", runtime_dir.c_str(), 1);
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(cfg.daemon.c_str()));
+    argv.push_back(const_cast<char *>("--foreground"));
+    std::string max_sessions = std::to_string(cfg.sessions);
+    if (cfg.synthetic)
+        argv.push_back(const_cast<char *>("--synthetic"));
+    if (cfg.sessions > MAX_SESSIONS) {
+        argv.push_back(const_cast<char *>("--max-sessions"));
+        argv.push_back(const_cast<char *>(max_sessions.c_str()));
+    }
+    for (const auto &a : cfg.daemon_args)
+        argv.push_back(const_cast<char *>(a.c_str()));
+    argv.push_back(nullptr);
+    execv(argv[0], argv.data());
+    perror("exec crt-sessiond");
+    _exit(127);
+}
+
+// Daemon-reported RSS from STATS (0 if unavailable)
+static uint64_t daemon_rss(const std::string &socket) {
+    SyncClient sc;
+    uint8_t type;
+    std::vector<uint8_t> resp;
+    uint64_t rss = 0;
+    if (sync_connect(&sc, socket, CAP_STATS) && (sc.capabilities & CAP_STATS) &&
+        sync_send(&sc, MSG_STATS, nullptr, 0) &&
+        sync_recv(&sc, &type, &resp, 5000) && type == MSG_STATS_OK &&
+        resp.size() >= 2 + 24)
+        rss = read_u64_le(resp.data() + 2 + 16);
+    sync_close(&sc);
+    return rss;
+}
+
+// -------------------------------------------------------------------
+// Report
+// -------------------------------------------------------------------
+
+static double percentile_us(std::vector<uint64_t> &v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(p / 100.0 * static_cast<double>(v.size() - 1) + 0.5);
+    return static_cast<double>(v[std::min(i, v.size() - 1)]) / 1000.0;
+}
+
+static double seconds(const struct timeval &tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: crt-sessiond-bench [--daemon PATH] [--sessions N] [--clients M]\n"
+            "                          [--producers LIST] [--rate B/s] [--read-rate B/s]\n"
+            "                          [--duration SECS] [--synthetic] [--daemon-arg ARG]...\n"
+            "  producers: flood, fixed, burst, echo (assigned to sessions in turn);\n"
+            "             with --synthetic also ansi and utf8\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig cfg;
+    const char *produce = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(a, "--produce") == 0 && v) { produce = v; i++; }
+        else if (strcmp(a, "--daemon") == 0 && v) { cfg.daemon = v; i++; }
+        else if (strcmp(a, "--daemon-arg") == 0 && v) { cfg.daemon_args.push_back(v); i++; }
+        else if (strcmp(a, "--sessions") == 0 && v) { cfg.sessions = atoi(v); i++; }
+        else if (strcmp(a, "--clients") == 0 && v) { cfg.clients = atoi(v); i++; }
+        else if (strcmp(a, "--rate") == 0 && v) { cfg.rate = strtoull(v, nullptr, 10); i++; }
+        else if (strcmp(a, "--read-rate") == 0 && v) { cfg.read_rate = strtoull(v, nullptr, 10); i++; }
+        else if (strcmp(a, "--duration") == 0 && v) { cfg.duration = atof(v); i++; }
+        else if (strcmp(a, "--synthetic") == 0) { cfg.synthetic = true; }
+        else if (strcmp(a, "--producers") == 0 && v) {
+            cfg.producers.clear();
+            std::string list = v;
+            for (size_t pos = 0; pos <= list.size();) {
+                size_t comma = std::min(list.find(',', pos), list.size());
+                if (comma > pos)
+                    cfg.producers.push_back(list.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+            i++;
+        } else {
+            usage();
+        }
+    }
+    if (produce)
+        return run_producer(produce, cfg.rate);
+    for (const auto &p : cfg.producers)
+        if (!cfg.synthetic && (p == "ansi" || p == "utf8"))
+            usage();
+    if (cfg.sessions < 1 || cfg.clients < 1 || cfg.clients > cfg.sessions ||
+        cfg.producers.empty() || cfg.duration <= 0)
+        usage();
+
+    char self[PATH_MAX], daemon[PATH_MAX];
+    if (!realpath(argv[0], self) || !realpath(cfg.daemon.c_str(), daemon)) {
+        fprintf(stderr, "cannot resolve %s or %s\n", argv[0], cfg.daemon.c_str());
+        return 1;
+    }
+    cfg.self = self;
+    cfg.daemon = daemon;
+
+    // Private daemon in its own runtime dir
+    char runtime_template[] = "/tmp/crt-sessiond-bench-XXXXXX";
+    if (!mkdtemp(runtime_template)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string runtime_dir = runtime_template;
+    std::string socket = socket_path_for(runtime_dir);
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t t_start = monotonic_ns();
+    pid_t daemon_pid = start_daemon(cfg, runtime_dir);
+    if (daemon_pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    struct stat st;
+    for (int i = 0; i < 200 && stat(socket.c_str(), &st) != 0; i++)
+        usleep(10000);
+
+    std::vector<ClientResult> results(static_cast<size_t>(cfg.clients));
+    std::vector<std::thread> threads;
+    for (int c = 0; c < cfg.clients; c++)
+        threads.emplace_back(run_client, std::cref(cfg), std::cref(socket), c,
+                             &results[static_cast<size_t>(c)]);
+    uint64_t create_start = monotonic_ns();
+    while (g_clients_ready.load() < cfg.clients)
+        usleep(1000);
+    double create_s = static_cast<double>(monotonic_ns() - create_start) / 1e9;
+    uint64_t window_start = monotonic_ns() + static_cast<uint64_t>(cfg.warmup * 1e9);
+    uint64_t window_end = window_start + static_cast<uint64_t>(cfg.duration * 1e9);
+    g_window_start.store(window_start);
+
+    // Sample RSS at the end of the load window, before teardown
+    uint64_t now = monotonic_ns();
+    if (window_end > now)
+        usleep(static_cast<useconds_t>((window_end - now) / 1000));
+    uint64_t rss = daemon_rss(socket);
+
+    for (auto &t : threads)
+        t.join();
+
+    kill(daemon_pid, SIGTERM);
+    int status;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(daemon_pid, &status, 0, &usage);
+    double wall = static_cast<double>(monotonic_ns() - t_start) / 1e9;
+    std::string cleanup = "rm -rf '" + runtime_dir + "'";
+    if (system(cleanup.c_str()) != 0) {}
+
+    // Aggregate
+    std::vector<uint64_t> echo;
+    uint64_t echo_lost = 0, total_bytes = 0, replay_bytes = 0, replay_ns = 0, replay_max = 0;
+    std::vector<std::pair<std::string, uint64_t>> per_producer;
+    int failed = 0;
+    for (auto &r : results) {
+        if (r.failed) {
+            fprintf(stderr, "client failed: %s\n", r.error.c_str());
+            failed++;
+        }
+        echo.insert(echo.end(), r.echo_ns.begin(), r.echo_ns.end());
+        echo_lost += r.echo_lost;
+        for (const auto &s : r.sessions) {
+            total_bytes += s.bytes;
+            replay_bytes += s.replay_bytes;
+            replay_ns += s.replay_ns;
+            replay_max = std::max(replay_max, s.replay_ns);
+            auto it = std::find_if(per_producer.begin(), per_producer.end(),
+                                   [&s](const auto &e) { return e.first == s.producer; });
+            if (it == per_producer.end())
+                per_producer.emplace_back(s.producer, s.bytes);
+            else
+                it->second += s.bytes;
+        }
+    }
+#if defined(__APPLE__)
+    uint64_t max_rss = static_cast<uint64_t>(usage.ru_maxrss);          // bytes
+#else
+    uint64_t max_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // KB
+#endif
+    double cpu_user = seconds(usage.ru_utime), cpu_sys = seconds(usage.ru_stime);
+
+    printf("{\n");
+    printf("  \"config\": {\"sessions\": %d, \"clients\": %d, \"producers\": [",
+           cfg.sessions, cfg.clients);
+    for (size_t i = 0; i < cfg.producers.size(); i++)
+        printf("%s\"%s\"", i ? ", " : "", cfg.producers[i].c_str());
+    printf("], \"rate\": %llu, \"read_rate\": %llu, \"duration_s\": %.3f, \"synthetic\": %s},\n",
+           static_cast<unsigned long long>(cfg.rate),
+           static_cast<unsigned long long>(cfg.read_rate), cfg.duration,
+           cfg.synthetic ? "true" : "false");
+    printf("  \"create_s\": %.3f,\n", create_s);
+    printf("  \"throughput\": {\"bytes\": %llu, \"mb_per_s\": %.2f, \"by_producer\": {",
+           static_cast<unsigned long long>(total_bytes),
+           static_cast<double>(total_bytes) / cfg.duration / 1e6);
+    for (size_t i = 0; i < per_producer.size(); i++)
+        printf("%s\"%s\": %llu", i ? ", " : "", per_producer[i].first.c_str(),
+               static_cast<unsigned long long>(per_producer[i].second));
+    printf("}},\n");
+    printf("  \"echo_latency_us\": {\"samples\": %zu, \"lost\": %llu, \"p50\": %.1f, "
+           "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f},\n",
+           echo.size(), static_cast<unsigned long long>(echo_lost),
+           percentile_us(echo, 50), percentile_us(echo, 99),
+           percentile_us(echo, 99.9), percentile_us(echo, 100));
+    printf("  \"replay\": {\"bytes\": %llu, \"total_ms\": %.2f, \"max_ms\": %.2f, "
+           "\"mb_per_s\": %.2f},\n",
+           static_cast<unsigned long long>(replay_bytes),
+           static_cast<double>(replay_ns) / 1e6, static_cast<double>(replay_max) / 1e6,
+           replay_ns ? static_cast<double>(replay_bytes) / (static_cast<double>(replay_ns) / 1e9) / 1e6 : 0.0);
+    printf("  \"daemon\": {\"cpu_user_s\": %.3f, \"cpu_sys_s\": %.3f, \"cpu_percent\": %.1f, "
+           "\"rss_bytes\": %llu, \"max_rss_bytes\": %llu},\n",
+           cpu_user, cpu_sys, (cpu_user + cpu_sys) / wall * 100.0,
+           static_cast<unsigned long long>(rss), static_cast<unsigned long long>(max_rss));
+    printf("  \"failed_clients\": %d\n}\n", failed);
+    return failed ? 1 : 0;
+}
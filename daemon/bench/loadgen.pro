@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = crt-sessiond-bench
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+QT -= gui core
+
+QMAKE_CXXFLAGS += -O2
+
+INCLUDEPATH += ..
+HEADERS += ../clock.h ../protocol.h ../sync_client.h
+SOURCES += loadgen.cpp ../sync_client.cpp
+
+# Benchmarks ./crt-sessiond unless --daemon PATH names another build
@@ -0,0 +1,535 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Microbenchmarks for the daemon's hot paths, no terminal or Qt needed:
+//
+//   scan      newline counting, substring search and the full SEARCH scan
+//             over a synthetic scrollback buffer (default 64 MB)
+//   datapath  RingBuffer write/readAll/findUtf8Boundary, output trigger
+//             scanning, message framing and parsing, read_string and the
+//             UUID helpers, at keystroke, 8 KB PTY read and 64 KB replay
+//             chunk sizes
+//
+// Each line is the best of several runs: throughput, ns and cycles per op,
+// cycles per byte and heap allocations per op. Cycles are estimated from
+// a calibration loop, so they track the actual core clock.
+//
+//   crt-sessiond-microbench [--suite scan|datapath|all] [--size MB]
+//                           [--runs N] [--json]
+
+#include "../newline_scan.h"
+#include "../protocol.h"
+#include "../ring_buffer.h"
+#include "../search.h"
+#include "../server.h"
+#include "../trigger.h"
+#include "../uuid.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// Declared extern in log.h
+bool g_debug_mode = false;
+
+// -------------------------------------------------------------------
+// Allocation counting
+// -------------------------------------------------------------------
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// -------------------------------------------------------------------
+// Synthetic scrollback
+// -------------------------------------------------------------------
+
+// Deterministic text that looks like build logs: words, paths, numbers,
+// the occasional SGR colour sequence, CRLF line endings.
+static std::vector<uint8_t> make_scrollback(size_t size) {
+    static const char *words[] = {
+        "compiling", "src/session.cpp", "warning:", "unused", "variable", "[", "]",
+        "error", "0x7ffd3c2a", "linking", "crt-sessiond", "done", "ms", "ok", "->",
+        "\x1b[32m", "\x1b[0m", "test", "passed", "12345", "/usr/include/c++/11",
+    };
+    const size_t nwords = sizeof(words) / sizeof(words[0]);
+
+    std::vector<uint8_t> buf;
+    buf.reserve(size + 256);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    while (buf.size() < size) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t words_on_line = 3 + state % 12;
+        for (size_t w = 0; w < words_on_line; w++) {
+            const char *word = words[(state >> (w % 48)) % nwords];
+            buf.insert(buf.end(), word, word + strlen(word));
+            buf.push_back(' ');
+        }
+        buf.push_back('\r');
+        buf.push_back('\n');
+    }
+    buf.resize(size);
+    return buf;
+}
+
+// -------------------------------------------------------------------
+// Harness
+// -------------------------------------------------------------------
+
+struct BenchResult {
+    std::string name;
+    uint64_t bytes;      // Per run (0 = not a byte-throughput benchmark)
+    uint64_t ops;        // Per run
+    double seconds;      // Best run
+    double allocs;       // Per op, averaged over all runs
+};
+
+static std::vector<BenchResult> g_results;
+static double g_ghz = 0;
+static bool g_json = false;
+static volatile uint64_t g_sink;  // keeps results alive
+
+// One add the compiler cannot fold into its neighbours
+static inline void dependent_add(uint64_t &x, uint64_t v) {
+    x += v;
+    __asm__ volatile("" : "+r"(x));
+}
+
+// Core clock estimate: a chain of dependent adds retires one per cycle on
+// every core we care about; the loop overhead runs alongside it.
+static double calibrate_ghz() {
+    const uint64_t iters = 50000000;
+    double best = 1e30;
+    for (int r = 0; r < 3; r++) {
+        uint64_t x = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            dependent_add(x, i); dependent_add(x, i); dependent_add(x, i); dependent_add(x, i);
+            dependent_add(x, i); dependent_add(x, i); dependent_add(x, i); dependent_add(x, i);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        g_sink = x;
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return static_cast<double>(iters * 8) / best / 1e9;
+}
+
+static void run(const char *name, uint64_t bytes, uint64_t ops, int runs,
+                const std::function<uint64_t()> &fn) {
+    double best = 1e30;
+    uint64_t result = 0;
+    uint64_t allocs_before = g_allocations.load(std::memory_order_relaxed);
+    for (int r = 0; r < runs; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        result = fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    uint64_t allocs = g_allocations.load(std::memory_order_relaxed) - allocs_before;
+    g_sink = result;
+
+    BenchResult res = {name, bytes, ops, best,
+                       static_cast<double>(allocs) / static_cast<double>(ops * runs)};
+    g_results.push_back(res);
+    if (g_json)
+        return;
+    double cycles = best * g_ghz * 1e9;
+    char gbps[16] = "-", cpb[16] = "-";
+    if (bytes) {
+        snprintf(gbps, sizeof(gbps), "%.2f", static_cast<double>(bytes) / best / 1e9);
+        snprintf(cpb, sizeof(cpb), "%.3f", cycles / static_cast<double>(bytes));
+    }
+    printf("%-40s %8s %12.1f %12.1f %8s %9.2f\n", name, gbps,
+           best * 1e9 / static_cast<double>(ops), cycles / static_cast<double>(ops),
+           cpb, res.allocs);
+}
+
+static void print_json() {
+    printf("{\n  \"ghz\": %.3f,\n  \"results\": [\n", g_ghz);
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const BenchResult &r = g_results[i];
+        double cycles = r.seconds * g_ghz * 1e9;
+        printf("    {\"name\": \"%s\", \"bytes\": %llu, \"ops\": %llu, \"seconds\": %.9f, "
+               "\"ns_per_op\": %.3f, \"cycles_per_op\": %.3f, ",
+               r.name.c_str(), static_cast<unsigned long long>(r.bytes),
+               static_cast<unsigned long long>(r.ops), r.seconds,
+               r.seconds * 1e9 / static_cast<double>(r.ops),
+               cycles / static_cast<double>(r.ops));
+        if (r.bytes)
+            printf("\"gb_per_s\": %.4f, \"cycles_per_byte\": %.4f, ",
+                   static_cast<double>(r.bytes) / r.seconds / 1e9,
+                   cycles / static_cast<double>(r.bytes));
+        else
+            printf("\"gb_per_s\": null, \"cycles_per_byte\": null, ");
+        printf("\"allocs_per_op\": %.4f}%s\n", r.allocs, i + 1 < g_results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+// -------------------------------------------------------------------
+// Scan suite
+// -------------------------------------------------------------------
+
+static uint64_t count_occurrences(const std::vector<uint8_t> &buf, const char *needle) {
+    const uint8_t *n = reinterpret_cast<const uint8_t *>(needle);
+    size_t nlen = strlen(needle);
+    uint64_t hits = 0;
+    const uint8_t *p = buf.data(), *end = buf.data() + buf.size();
+    while ((p = find_substring(p, static_cast<size_t>(end - p), n, nlen)) != nullptr) {
+        hits++;
+        p += nlen;
+    }
+    return hits;
+}
+
+static uint64_t scan_source(const SearchSource &source, const char *pattern, uint8_t flags) {
+    SearchMatcher matcher;
+    std::string error;
+    if (!matcher.compile(pattern, flags, &error)) {
+        fprintf(stderr, "bad pattern %s: %s\n", pattern, error.c_str());
+        exit(1);
+    }
+    std::vector<SearchMatch> out;
+    search_scan(matcher, source, 32, SIZE_MAX, out);
+    return out.size();
+}
+
+static void scan_suite(size_t size_mb, int runs) {
+    SearchSource source;
+    source.tail = make_scrollback(size_mb * 1024 * 1024);
+    const std::vector<uint8_t> &buf = source.tail;
+    const size_t n = buf.size();
+
+    // Baselines: libc byte search
+    run("memchr (absent byte)", n, 1, runs, [&] {
+        return static_cast<uint64_t>(memchr(buf.data(), 0x01, n) != nullptr);
+    });
+    run("memmem (absent needle)", n, 1, runs, [&] {
+        return static_cast<uint64_t>(memmem(buf.data(), n, "segfault", 8) != nullptr);
+    });
+
+    // Kernels
+    run("count_newlines", n, 1, runs, [&] { return count_newlines(buf.data(), n); });
+    run("find_substring (absent)", n, 1, runs, [&] { return count_occurrences(buf, "segfault"); });
+    run("find_substring (frequent)", n, 1, runs, [&] { return count_occurrences(buf, "error"); });
+    run("find_substring (long needle)", n, 1, runs, [&] {
+        return count_occurrences(buf, "/usr/include/c++/11 segfault");
+    });
+
+    // Full SEARCH path: line framing, matching, context extraction
+    run("search literal (absent)", n, 1, runs, [&] { return scan_source(source, "segfault", 0); });
+    run("search literal (frequent)", n, 1, runs, [&] { return scan_source(source, "warning:", 0); });
+    run("search literal, ignore case", n, 1, runs, [&] {
+        return scan_source(source, "SEGFAULT", SEARCH_IGNORE_CASE);
+    });
+    run("search regex", n, 1, runs, [&] {
+        return scan_source(source, "error [0-9]+", SEARCH_REGEX);
+    });
+}
+
+// -------------------------------------------------------------------
+// Datapath suite
+// -------------------------------------------------------------------
+
+// Writes total bytes into a 1 MB ring in chunk-sized pieces. Chunks that
+// do not divide the capacity split at the wrap point.
+static void bench_ring_write(const char *name, const std::vector<uint8_t> &text,
+                             size_t chunk, uint64_t total, int runs) {
+    RingBuffer ring(1024 * 1024);
+    uint64_t ops = total / chunk;
+    run(name, ops * chunk, ops, runs, [&] {
+        size_t pos = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            ring.write(text.data() + pos, chunk);
+            pos = (pos + chunk) % (text.size() - chunk);
+        }
+        return ring.sequence();
+    });
+}
+
+// Scans total bytes in 8 KB PTY reads, as run_triggers does after each
+// ring write. Events are built but (past the first) cooled down.
+static void bench_trigger_scan(const char *name, const std::vector<uint8_t> &text,
+                               const std::vector<TriggerSpec> &specs, uint64_t total,
+                               int runs) {
+    TriggerMatcher matcher;
+    size_t bad_index;
+    std::string error;
+    if (matcher.compile(specs, &bad_index, &error) != TRIGGERS_OK) {
+        fprintf(stderr, "%s: trigger %zu: %s\n", name, bad_index, error.c_str());
+        return;
+    }
+    const size_t chunk = 8192;
+    uint64_t ops = total / chunk;
+    std::vector<TriggerHit> hits;
+    run(name, ops * chunk, ops, runs, [&] {
+        size_t pos = 0;
+        uint64_t seq = 0;
+        hits.clear();
+        for (uint64_t i = 0; i < ops; i++) {
+            matcher.scan(text.data() + pos, chunk, seq, 1, nullptr, nullptr, hits);
+            seq += chunk;
+            pos = (pos + chunk) % (text.size() - chunk);
+        }
+        return seq + hits.size();
+    });
+}
+
+// Frames as a client sends them, back to back in one buffer
+static std::vector<uint8_t> frames(uint8_t type, size_t payload_len, size_t count) {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> payload(payload_len, 'x');
+    memcpy(payload.data(), "00000000-0000-4000-8000-000000000000",
+           std::min<size_t>(payload_len, SESSION_ID_LEN));
+    for (size_t i = 0; i < count; i++) {
+        uint8_t hdr[HEADER_SIZE];
+        write_header(hdr, type, static_cast<uint32_t>(payload_len));
+        out.insert(out.end(), hdr, hdr + HEADER_SIZE);
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+    return out;
+}
+
+// Parse and consume every frame in one read, the way
+// process_client_messages() does
+static void bench_parse(const char *name, const std::vector<uint8_t> &read_buf,
+                        size_t count, uint64_t reads, int runs) {
+    Client client = {};
+    run(name, reads * read_buf.size(), reads * count, runs, [&] {
+        uint64_t parsed = 0;
+        for (uint64_t r = 0; r < reads; r++) {
+            client.recv_buf.insert(client.recv_buf.end(), read_buf.begin(), read_buf.end());
+            ParsedMessage msg;
+            bool error;
+            while (try_parse_message(client.recv_buf, &msg, &error)) {
+                parsed += msg.payload_len;
+                size_t total = HEADER_SIZE + msg.payload_len;
+                client.recv_buf.erase(client.recv_buf.begin(),
+                                      client.recv_buf.begin() + static_cast<ptrdiff_t>(total));
+            }
+        }
+        return parsed;
+    });
+}
+
+// Queue messages, draining the send buffer every 16 the way a writable
+// socket would
+static void bench_queue(const char *name, uint8_t type, size_t payload_len,
+                        uint64_t ops, int runs) {
+    Client client = {};
+    std::vector<uint8_t> payload(payload_len, 'x');
+    run(name, ops * (HEADER_SIZE + payload_len), ops, runs, [&] {
+        for (uint64_t i = 0; i < ops; i++) {
+            queue_message(&client, type, payload.data(), static_cast<uint32_t>(payload_len));
+            if ((i & 15) == 15)
+                client.send_buf.clear();
+        }
+        return client.send_buf_high_water;
+    });
+}
+
+static void datapath_suite(int runs) {
+    std::vector<uint8_t> text = make_scrollback(256 * 1024);
+
+    // RingBuffer::write, including line indexing and wrap-around
+    bench_ring_write("ring write 1 B (keystroke echo)", text, 1, 8 << 20, runs);
+    bench_ring_write("ring write 8 KB (PTY read)", text, 8192, 256 << 20, runs);
+    bench_ring_write("ring write 8191 B (split at wrap)", text, 8191, 256 << 20, runs);
+    bench_ring_write("ring write 64 KB (replay chunk)", text, 65536, 256 << 20, runs);
+
+    // Output triggers over the same 8 KB reads, to set against ring write
+    bench_trigger_scan("trigger scan 8 KB (1 literal)", text,
+                       {{1, 0, "build finished"}}, 256 << 20, runs);
+    bench_trigger_scan("trigger scan 8 KB (4 mixed)", text,
+                       {{1, 0, "build finished"},
+                        {2, TRIGGER_IGNORE_CASE, "FAILED"},
+                        {3, TRIGGER_REGEX | TRIGGER_IGNORE_CASE, "error: .*not found"},
+                        {4, TRIGGER_REGEX, "[a-z]+@host\\$ $"}}, 256 << 20, runs);
+    bench_trigger_scan("trigger scan 8 KB (hot prefix \"error\")", text,
+                       {{1, TRIGGER_IGNORE_CASE, "error"}}, 256 << 20, runs);
+
+    // readAll on a full, wrapped ring, copying both segments out
+    {
+        RingBuffer ring(1024 * 1024);
+        for (size_t i = 0; i < 5; i++)
+            ring.write(text.data(), 300 * 1024);
+        std::vector<uint8_t> out(ring.capacity());
+        const uint64_t ops = 256;
+        run("ring readAll + copy (1 MB, wrapped)", ops * ring.used(), ops, runs, [&] {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < ops; i++) {
+                const uint8_t *p1, *p2;
+                size_t l1, l2;
+                ring.readAll(&p1, &l1, &p2, &l2);
+                memcpy(out.data(), p1, l1);
+                memcpy(out.data() + l1, p2, l2);
+                sum += out[i % out.size()];
+            }
+            return sum;
+        });
+    }
+
+    // findUtf8Boundary at arbitrary offsets into multi-byte text
+    {
+        std::string utf8;
+        while (utf8.size() < 1536 * 1024)
+            utf8 += "h\xc3\xa9llo w\xc3\xb6rld \xe2\x80\x94 \xe2\x9c\x93 \xf0\x9f\x99\x82\r\n";
+        RingBuffer ring(1024 * 1024);
+        ring.write(reinterpret_cast<const uint8_t *>(utf8.data()), utf8.size());
+        const uint64_t ops = 4 << 20;
+        run("ring findUtf8Boundary (random offset)", 0, ops, runs, [&] {
+            uint64_t sum = 0, state = 0x9E3779B97F4A7C15ULL;
+            for (uint64_t i = 0; i < ops; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                sum += ring.findUtf8Boundary(state % ring.used());
+            }
+            return sum;
+        });
+    }
+
+    // Framing: queue_message() into a client's send buffer
+    bench_queue("queue_message INPUT keystroke", MSG_INPUT, SESSION_ID_LEN + 1, 8 << 20, runs);
+    bench_queue("queue_message OUTPUT 8 KB", MSG_OUTPUT, SESSION_ID_LEN + 8192, 64 << 10, runs);
+    bench_queue("queue_message REPLAY_DATA 64 KB", MSG_REPLAY_DATA,
+                SESSION_ID_LEN + REPLAY_CHUNK_SIZE, 8 << 10, runs);
+
+    // Parsing: try_parse_message() plus consuming from recv_buf
+    const size_t keys_per_read = 8192 / (HEADER_SIZE + SESSION_ID_LEN + 1);
+    bench_parse("parse INPUT keystrokes (8 KB read)",
+                frames(MSG_INPUT, SESSION_ID_LEN + 1, keys_per_read), keys_per_read, 16 << 10, runs);
+    bench_parse("parse single keystroke", frames(MSG_INPUT, SESSION_ID_LEN + 1, 1), 1,
+                4 << 20, runs);
+    bench_parse("parse INPUT 64 KB paste", frames(MSG_INPUT, SESSION_ID_LEN + 65536, 1), 1,
+                4 << 10, runs);
+
+    // read_string over a CREATE-style payload
+    {
+        std::vector<uint8_t> payload;
+        const char *strings[] = {"/bin/zsh", "-l", "TERM=xterm-256color",
+                                 "LANG=en_US.UTF-8", "/home/user/src/crt-plus"};
+        for (const char *s : strings) {
+            uint8_t len[2];
+            write_u16_le(len, static_cast<uint16_t>(strlen(s)));
+            payload.insert(payload.end(), len, len + 2);
+            payload.insert(payload.end(), s, s + strlen(s));
+        }
+        const uint64_t ops = 8 << 20;
+        run("read_string (5-string payload)", ops * payload.size(), ops, runs, [&] {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < ops; i++) {
+                size_t pos = 0, consumed;
+                const char *str;
+                uint16_t len;
+                while (read_string(payload.data() + pos, payload.size() - pos,
+                                   &str, &len, &consumed)) {
+                    sum += len;
+                    pos += consumed;
+                }
+            }
+            return sum;
+        });
+    }
+
+    // UUID helpers
+    {
+        char id[UUID_STR_LEN];
+        run("uuid_generate", 0, 64 << 10, runs, [&] {
+            uint64_t ok = 0;
+            for (uint64_t i = 0; i < (64 << 10); i++)
+                ok += uuid_generate(id, sizeof(id));
+            return ok;
+        });
+        run("uuid_validate", 0, 8 << 20, runs, [&] {
+            uint64_t ok = 0;
+            for (uint64_t i = 0; i < (8 << 20); i++)
+                ok += uuid_validate(id, SESSION_ID_LEN);
+            return ok;
+        });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = 64;
+    int runs = 5;
+    std::string suite = "all";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size_mb = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--suite") == 0 && i + 1 < argc)
+            suite = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0)
+            g_json = true;
+        else {
+            fprintf(stderr, "usage: %s [--suite scan|datapath|all] [--size MB] [--runs N] [--json]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (size_mb == 0 || runs <= 0 ||
+        (suite != "all" && suite != "scan" && suite != "datapath"))
+        return 1;
+
+    g_ghz = calibrate_ghz();
+    if (!g_json) {
+        printf("best of %d runs, core clock ~%.2f GHz (calibrated)\n\n", runs, g_ghz);
+        printf("%-40s %8s %12s %12s %8s %9s\n", "", "GB/s", "ns/op", "cycles/op",
+               "cyc/B", "allocs/op");
+    }
+    if (suite != "datapath") {
+        if (!g_json)
+            printf("-- scan: %zu MB synthetic scrollback\n", size_mb);
+        scan_suite(size_mb, runs);
+    }
+    if (suite != "scan") {
+        if (!g_json)
+            printf("-- datapath\n");
+        datapath_suite(runs);
+    }
+    if (g_json)
+        print_json();
+    return 0;
+}
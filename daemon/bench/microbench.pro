@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = crt-sessiond-microbench
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+QT -= gui core
+
+# Benchmarks want optimised code even in debug builds
+QMAKE_CXXFLAGS += -O2
+
+INCLUDEPATH += ..
+HEADERS += ../newline_scan.h ../protocol.h ../ring_buffer.h ../search.h ../scrollback_history.h \
+           ../server.h ../spill_store.h ../trigger.h ../uuid.h
+SOURCES += microbench.cpp ../search.cpp ../scrollback_history.cpp ../spill_store.cpp \
+           ../ring_buffer.cpp ../server.cpp ../lz_codec.cpp ../worker.cpp ../uuid.cpp \
+           ../trigger.cpp
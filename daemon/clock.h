@@ -0,0 +1,42 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Monotonic clock helpers for durations and rates (immune to wall-clock
+// changes, unlike the time_t timestamps used for session metadata).
+
+#ifndef CRT_SESSIOND_CLOCK_H
+#define CRT_SESSIOND_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+
+inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+           static_cast<uint64_t>(ts.tv_nsec);
+}
+
+inline uint64_t monotonic_ms() {
+    return monotonic_ns() / 1000000ULL;
+}
+
+#endif // CRT_SESSIOND_CLOCK_H
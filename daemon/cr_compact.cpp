@@ -0,0 +1,216 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cr_compact.h"
+
+namespace {
+
+enum EscState : uint8_t {
+    ESC_NONE,
+    ESC_START,          // After ESC
+    ESC_INTERMEDIATE,   // ESC then intermediate bytes (charset designations)
+    ESC_CSI,            // ESC [ and parameters
+    ESC_STRING,         // OSC, DCS, APC, PM or SOS body
+    ESC_STRING_ESC,     // ESC within a string, maybe its terminator
+};
+
+using Cuts = std::vector<std::pair<uint64_t, uint64_t>>;
+
+void start_drawing(CrCompactor &c, uint64_t seq, bool column0) {
+    c.cur = CrLineState();
+    c.cur.start = seq;
+    c.cur.attrs_default = c.attrs_default;
+    c.cur.unsafe = !column0;
+}
+
+// Whether the drawing in progress already hides everything prev did
+bool covers(const CrCompactor &c) {
+    const CrLineState &p = c.prev;
+    const CrLineState &n = c.cur;
+    if (!c.have_prev || p.unsafe || p.sticky || n.unsafe)
+        return false;
+    // Without prev, n must start with the attributes it had
+    if (p.sgr && !(p.attrs_default && n.attrs_default))
+        return false;
+    return n.erases || (!p.erases && n.min_width >= p.max_width);
+}
+
+void try_cut(CrCompactor &c, Cuts *cuts) {
+    if (!covers(c))
+        return;
+    // prev and the CR that ended it; the CR before it stays
+    cuts->emplace_back(c.prev.start, c.prev.end + 1);
+    c.have_prev = false;
+}
+
+bool params_are(const CrCompactor &c, const char *s) {
+    size_t i = 0;
+    for (; s[i]; i++) {
+        if (i >= c.params_len || c.params[i] != static_cast<uint8_t>(s[i]))
+            return false;
+    }
+    return i == c.params_len;
+}
+
+void control_sequence(CrCompactor &c, uint8_t final, Cuts *cuts) {
+    CrLineState &s = c.cur;
+    if (c.params_len > CR_COMPACT_MAX_PARAMS) {
+        s.unsafe = true;
+        if (final == 'm')
+            c.attrs_default = false;
+        return;
+    }
+    bool private_params = c.params_len > 0 && c.params[0] >= '<' && c.params[0] <= '?';
+
+    if (final == 'm' && !private_params) {
+        // SGR: the defaults again only if every parameter is a reset
+        s.sgr = true;
+        c.attrs_default = true;
+        for (size_t i = 0; i < c.params_len; i++) {
+            if (c.params[i] != '0' && c.params[i] != ';')
+                c.attrs_default = false;
+        }
+    } else if (final == 'K' && (params_are(c, "") || params_are(c, "0") ||
+                                params_are(c, "2"))) {
+        s.erases = true;
+        try_cut(c, cuts);
+    } else if (final == 'K' && params_are(c, "1")) {
+        // Erasing cells it already counts changes nothing
+    } else if ((final == 'h' || final == 'l') && params_are(c, "?25")) {
+        s.sticky = true;   // Cursor visibility
+    } else {
+        s.unsafe = true;
+    }
+}
+
+void printable(CrCompactor &c, uint8_t b, uint16_t cols, Cuts *cuts) {
+    if ((b & 0xC0) == 0x80)
+        return;   // UTF-8 continuation
+    CrLineState &s = c.cur;
+    // A non-ASCII character may take no cell (combining marks, joiners,
+    // variation selectors) or, from U+1100 on, two
+    if (b < 0x80)
+        s.min_width++;
+    s.max_width += b >= 0xE1 ? 2 : 1;
+    if (s.max_width >= cols)
+        s.unsafe = true;   // May wrap to the next row
+    try_cut(c, cuts);
+}
+
+} // namespace
+
+void cr_compact_scan(CrCompactor &c, const uint8_t *data, size_t len, uint64_t seq,
+                     uint16_t cols, Cuts *cuts) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        uint64_t pos = seq + i;
+        bool after_cr = c.cr;
+
+        if (c.cr) {
+            c.cr = false;
+            if (b != '\n') {
+                // A bare CR: the drawing is done and the next starts at column 0
+                c.cur.end = c.cr_seq;
+                c.prev = c.cur;
+                c.have_prev = true;
+                start_drawing(c, pos, true);
+            }
+        }
+
+        switch (c.esc) {
+        case ESC_NONE:
+            break;
+        case ESC_STRING:
+            if (b == 0x07 || b == 0x18 || b == 0x1A)
+                c.esc = ESC_NONE;
+            else if (b == 0x1B)
+                c.esc = ESC_STRING_ESC;
+            continue;
+        case ESC_STRING_ESC:
+            if (b != 0x1B)
+                c.esc = b == '\\' ? ESC_NONE : ESC_STRING;
+            continue;
+        default:
+            if (b < 0x20) {
+                // A control inside a sequence: too odd to reason about
+                c.cur.unsafe = true;
+                c.esc = ESC_NONE;
+                break;
+            }
+            if (c.esc == ESC_START) {
+                if (b == '[') {
+                    c.esc = ESC_CSI;
+                    c.params_len = 0;
+                } else if (b == ']' || b == 'P' || b == '_' || b == '^' || b == 'X') {
+                    c.esc = ESC_STRING;
+                    c.cur.sticky = true;   // Titles, hyperlinks, ...
+                } else if (b >= 0x20 && b <= 0x2F) {
+                    c.esc = ESC_INTERMEDIATE;
+                    c.cur.unsafe = true;
+                } else {
+                    c.esc = ESC_NONE;
+                    c.cur.unsafe = true;   // Cursor save/restore, index, reset, ...
+                }
+            } else if (c.esc == ESC_INTERMEDIATE) {
+                if (b >= 0x30)
+                    c.esc = ESC_NONE;
+            } else if (b >= 0x40 && b <= 0x7E) {
+                c.esc = ESC_NONE;
+                control_sequence(c, b, cuts);
+            } else if (b >= 0x20 && b <= 0x3F) {
+                if (c.params_len < CR_COMPACT_MAX_PARAMS)
+                    c.params[c.params_len] = b;
+                if (c.params_len <= CR_COMPACT_MAX_PARAMS)
+                    c.params_len++;
+            } else {
+                c.esc = ESC_NONE;
+                c.cur.unsafe = true;
+            }
+            continue;
+        }
+
+        if (b == '\r') {
+            c.cr = true;
+            c.cr_seq = pos;
+        } else if (b == '\n') {
+            // The line is done. Only after CR LF is the next at column 0.
+            c.have_prev = false;
+            start_drawing(c, pos + 1, after_cr);
+        } else if (b == 0x1B) {
+            c.esc = ESC_START;
+        } else if (b < 0x20 || b == 0x7F) {
+            c.cur.unsafe = true;   // Backspace, tab, bell, ...
+        } else {
+            printable(c, b, cols, cuts);
+        }
+    }
+}
+
+void cr_compact_shift(CrCompactor &c, uint64_t removed) {
+    c.cur.start -= removed;
+    if (c.have_prev) {
+        c.prev.start -= removed;
+        c.prev.end -= removed;
+    }
+    if (c.cr)
+        c.cr_seq -= removed;
+    c.removed += removed;
+}
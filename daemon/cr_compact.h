@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Carriage-return compaction: progress bars and spinners redraw one line
+// by returning to its start with a bare CR, thousands of times. Each
+// redraw that a later one on the same line fully covers can be dropped
+// from scrollback without changing what the screen ends up showing.
+//
+// The scan runs over each PTY read before it is stored and reports the
+// byte ranges that can go; the event loop cuts those that lie within the
+// read, so clients never see the bytes and sequence numbers stay exact.
+// A redraw is only dropped when that is exact: it stays on one row (no
+// cursor movement, tabs or wrapping), leaves the graphic attributes and
+// modes as it found them, and the covering redraw writes at least as many
+// cells or erases to the end of the line.
+
+#ifndef CRT_SESSIOND_CR_COMPACT_H
+#define CRT_SESSIOND_CR_COMPACT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Longest CSI parameter string looked at; longer ones are taken as unsafe
+inline constexpr size_t CR_COMPACT_MAX_PARAMS = 16;
+
+// One drawing of a line: the bytes after a CR (or the line start) up to
+// the next bare CR
+struct CrLineState {
+    uint64_t start = 0;           // Sequence number of its first byte
+    uint64_t end = 0;             // ... and of the CR that ended it
+    uint32_t min_width = 0;       // Cells it surely wrote
+    uint32_t max_width = 0;       // Cells it may have written
+    bool     erases = false;      // Erased to the end of the line
+    bool     attrs_default = false;  // Graphic attributes were the defaults at its start
+    bool     sgr = false;         // Changed graphic attributes
+    bool     sticky = false;      // Changed modes or titles; must be kept
+    bool     unsafe = true;       // Not known to stay on one row starting at column 0
+};
+
+struct CrCompactor {
+    CrLineState cur;              // Drawing in progress
+    CrLineState prev;             // Last finished drawing on this line
+    bool        have_prev = false;
+    bool        cr = false;       // Last byte was a CR; a bare one unless LF follows
+    uint64_t    cr_seq = 0;
+    bool        attrs_default = true;  // Graphic attributes are the defaults now
+
+    uint8_t     esc = 0;          // Escape sequence parser state
+    uint8_t     params[CR_COMPACT_MAX_PARAMS];
+    size_t      params_len = 0;
+
+    uint64_t    removed = 0;      // Bytes compacted away
+};
+
+// Scan one PTY read that is to be stored at [seq, seq + len), appending
+// the ranges that can be cut to cuts, oldest first (the first ones may
+// start in earlier reads). cols is the terminal width.
+void cr_compact_scan(CrCompactor &c, const uint8_t *data, size_t len, uint64_t seq,
+                     uint16_t cols, std::vector<std::pair<uint64_t, uint64_t>> *cuts);
+
+// After cuts were removed from the read, `removed` bytes in total: move
+// the positions held, which all lie beyond them.
+void cr_compact_shift(CrCompactor &c, uint64_t removed);
+
+#endif // CRT_SESSIOND_CR_COMPACT_H
@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = crt-sessionctl
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+QT -= gui core
+
+# Next to crt-sessiond
+DESTDIR = $$OUT_PWD/../../
+
+INCLUDEPATH += ..
+HEADERS += ../clock.h ../log.h ../protocol.h ../server.h ../stats_report.h ../sync_client.h
+SOURCES += sessionctl.cpp ../server.cpp ../stats_report.cpp ../sync_client.cpp
@@ -0,0 +1,534 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Command-line client for crt-sessiond: scripting, diagnostics, and a
+// lightweight client for benchmarks. Speaks the protocol directly over
+// the daemon's socket, so no app is needed.
+//
+//   crt-sessionctl [--socket PATH] list
+//   crt-sessionctl [--socket PATH] tail [-f] [-n LINES] <id>
+//   crt-sessionctl [--socket PATH] dump [-o FILE] <id>
+//   crt-sessionctl [--socket PATH] send [-n] <id> [TEXT...]
+//   crt-sessionctl [--socket PATH] kill <id>...
+//   crt-sessionctl [--socket PATH] stats
+//
+// <id> may be any unique prefix of a session UUID. `tail -f` watches as a
+// read-only observer, so it never takes a session away from the app.
+
+#include "../clock.h"
+#include "../protocol.h"
+#include "../server.h"
+#include "../stats_report.h"
+#include "../sync_client.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+// Declared in log.h, which server.cpp logs through
+bool g_debug_mode = false;
+
+static constexpr uint32_t CTL_CAPABILITIES =
+    CAP_LIST_EXTENDED | CAP_REPLAY_RANGE | CAP_STATS | CAP_OBSERVE;
+
+// A long tail -f keeps the daemon's heartbeat timeout at bay with PINGs
+static constexpr uint64_t PING_INTERVAL_NS =
+    CLIENT_HEARTBEAT_TIMEOUT_SECS / 3 * 1000000000ull;
+
+static constexpr int REPLY_TIMEOUT_MS = 5000;
+static constexpr uint16_t DEFAULT_TAIL_LINES = 10;
+
+// -------------------------------------------------------------------
+// Output
+// -------------------------------------------------------------------
+
+// Gathers slices of received frames and writes them with one writev():
+// the payloads go from the socket buffer to fd without another copy.
+// flush() before the frames' views are invalidated (sync_fill).
+struct OutputStream {
+    int fd;
+    struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+    int count = 0;
+    uint64_t total = 0;
+    bool failed = false;
+
+    explicit OutputStream(int out_fd) : fd(out_fd) {}
+
+    void add(const uint8_t *data, size_t len) {
+        if (len == 0)
+            return;
+        if (count == static_cast<int>(sizeof(iov) / sizeof(iov[0])))
+            flush();
+        iov[count].iov_base = const_cast<uint8_t *>(data);
+        iov[count].iov_len = len;
+        count++;
+        total += len;
+    }
+
+    bool flush() {
+        struct iovec *v = iov;
+        int left = count;
+        count = 0;
+        while (left > 0 && !failed) {
+            ssize_t n = writev(fd, v, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                failed = true;
+                break;
+            }
+            // Skip what went out, resume mid-slice after a short write
+            size_t done = static_cast<size_t>(n);
+            while (left > 0 && done >= v->iov_len) {
+                done -= v->iov_len;
+                v++;
+                left--;
+            }
+            if (left > 0) {
+                v->iov_base = static_cast<uint8_t *>(v->iov_base) + done;
+                v->iov_len -= done;
+            }
+        }
+        return !failed;
+    }
+};
+
+// -------------------------------------------------------------------
+// Requests
+// -------------------------------------------------------------------
+
+static void print_error(const uint8_t *payload, uint32_t len) {
+    // ERROR: [1B code][2B len][message]
+    if (len < 3) {
+        fprintf(stderr, "crt-sessionctl: daemon error\n");
+        return;
+    }
+    uint16_t msg_len = read_u16_le(payload + 1);
+    if (msg_len > len - 3)
+        msg_len = static_cast<uint16_t>(len - 3);
+    fprintf(stderr, "crt-sessionctl: %.*s (error %u)\n", msg_len,
+            reinterpret_cast<const char *>(payload + 3), payload[0]);
+}
+
+// Wait for a reply of type want, skipping anything else. An ERROR is
+// printed and ends the wait.
+static bool wait_reply(SyncClient *sc, uint8_t want, std::vector<uint8_t> *payload) {
+    uint8_t type;
+    while (sync_recv(sc, &type, payload, REPLY_TIMEOUT_MS)) {
+        if (type == want)
+            return true;
+        if (type == MSG_ERROR) {
+            print_error(payload->data(), static_cast<uint32_t>(payload->size()));
+            return false;
+        }
+    }
+    fprintf(stderr, "crt-sessionctl: no reply from daemon\n");
+    return false;
+}
+
+struct ListEntry {
+    std::string id;
+    bool alive;
+    bool attached;
+    uint16_t rows, cols;
+    std::string shell;
+    std::string cwd;
+    uint64_t ring_used = 0;
+    uint64_t last_output_at = 0;
+    std::string title;
+};
+
+static bool read_string(const uint8_t *&p, const uint8_t *end, std::string *out) {
+    if (end - p < 2) return false;
+    uint16_t len = read_u16_le(p);
+    if (end - p < 2 + len) return false;
+    out->assign(reinterpret_cast<const char *>(p + 2), len);
+    p += 2 + len;
+    return true;
+}
+
+static bool fetch_list(SyncClient *sc, std::vector<ListEntry> *entries) {
+    std::vector<uint8_t> resp;
+    if (!sync_send(sc, MSG_LIST, nullptr, 0) || !wait_reply(sc, MSG_LIST_OK, &resp))
+        return false;
+
+    // LIST_OK: [2B count] then per session
+    //   [36B id][1B alive][2B rows][2B cols][2B shell_len][shell]
+    //   [2B cwd_len][cwd][8B created_at][8B detached_at][1B has_client]
+    //   [2B ext_len][ext] (CAP_LIST_EXTENDED)
+    bool extended = (sc->capabilities & CAP_LIST_EXTENDED) != 0;
+    const uint8_t *p = resp.data(), *end = resp.data() + resp.size();
+    if (end - p < 2) return false;
+    uint16_t count = read_u16_le(p);
+    p += 2;
+    for (uint16_t i = 0; i < count; i++) {
+        ListEntry e;
+        if (end - p < static_cast<ptrdiff_t>(SESSION_ID_LEN + 5)) return false;
+        e.id.assign(reinterpret_cast<const char *>(p), SESSION_ID_LEN);
+        e.alive = p[SESSION_ID_LEN] != 0;
+        e.rows = read_u16_le(p + SESSION_ID_LEN + 1);
+        e.cols = read_u16_le(p + SESSION_ID_LEN + 3);
+        p += SESSION_ID_LEN + 5;
+        if (!read_string(p, end, &e.shell) || !read_string(p, end, &e.cwd) || end - p < 17)
+            return false;
+        e.attached = p[16] != 0;
+        p += 17;
+        if (extended) {
+            if (end - p < 2) return false;
+            uint16_t ext_len = read_u16_le(p);
+            const uint8_t *ext = p + 2, *ext_end = ext + ext_len;
+            if (ext_end > end) return false;
+            if (ext_len >= LIST_EXT_SIZE) {
+                e.ring_used = read_u64_le(ext + 8);
+                e.last_output_at = read_u64_le(ext + 56);
+                const uint8_t *s = ext + LIST_EXT_SIZE;
+                read_string(s, ext_end, &e.title);
+            }
+            p = ext_end;
+        }
+        entries->push_back(std::move(e));
+    }
+    return true;
+}
+
+// Full UUID for a unique prefix of one
+static bool resolve_id(SyncClient *sc, const char *arg, std::string *uuid) {
+    size_t len = strlen(arg);
+    if (len == SESSION_ID_LEN) {
+        uuid->assign(arg, len);
+        return true;
+    }
+    std::vector<ListEntry> entries;
+    if (len == 0 || !fetch_list(sc, &entries))
+        return false;
+    int matches = 0;
+    for (const auto &e : entries) {
+        if (e.id.compare(0, len, arg) == 0) {
+            *uuid = e.id;
+            matches++;
+        }
+    }
+    if (matches == 1)
+        return true;
+    fprintf(stderr, "crt-sessionctl: %s session matches '%s'\n",
+            matches ? "more than one" : "no", arg);
+    return false;
+}
+
+// -------------------------------------------------------------------
+// Commands
+// -------------------------------------------------------------------
+
+static int cmd_list(SyncClient *sc) {
+    std::vector<ListEntry> entries;
+    if (!fetch_list(sc, &entries))
+        return 1;
+    if (entries.empty())
+        return 0;
+
+    time_t now = time(nullptr);
+    printf("%-36s %-8s %9s %9s %7s  %s\n", "session", "state", "size", "ring KB",
+           "idle", "title / cwd");
+    for (const auto &e : entries) {
+        char size[16], idle[24];
+        snprintf(size, sizeof(size), "%ux%u", e.cols, e.rows);
+        if (e.last_output_at == 0 || static_cast<uint64_t>(now) < e.last_output_at)
+            snprintf(idle, sizeof(idle), "-");
+        else if (now - static_cast<time_t>(e.last_output_at) < 3600)
+            snprintf(idle, sizeof(idle), "%lds", static_cast<long>(now - e.last_output_at));
+        else
+            snprintf(idle, sizeof(idle), "%ldh", static_cast<long>((now - e.last_output_at) / 3600));
+        printf("%-36s %-8s %9s %9llu %7s  %s\n", e.id.c_str(),
+               !e.alive ? "exited" : e.attached ? "attached" : "detached", size,
+               static_cast<unsigned long long>(e.ring_used / 1024), idle,
+               e.title.empty() ? e.cwd.c_str() : e.title.c_str());
+    }
+    return 0;
+}
+
+// Stream a REPLAY_RANGE to out: RANGE_DATA payloads until RANGE_END
+static bool stream_range(SyncClient *sc, const std::string &uuid, uint8_t mode,
+                         uint64_t value, OutputStream &out) {
+    // REPLAY_RANGE: [36B id][1B mode][8B value][8B end_seq][4B max_bytes]
+    uint8_t req[SESSION_ID_LEN + 1 + 8 + 8 + 4] = {};
+    memcpy(req, uuid.data(), SESSION_ID_LEN);
+    req[SESSION_ID_LEN] = mode;
+    write_u64_le(req + SESSION_ID_LEN + 1, value);
+    if (!sync_send(sc, MSG_REPLAY_RANGE, req, sizeof(req)))
+        return false;
+
+    while (true) {
+        uint8_t type;
+        const uint8_t *p;
+        uint32_t len;
+        while (sync_next_frame(sc, &type, &p, &len)) {
+            if (type == MSG_RANGE_DATA && len >= SESSION_ID_LEN + 8) {
+                out.add(p + SESSION_ID_LEN + 8, len - SESSION_ID_LEN - 8);
+            } else if (type == MSG_RANGE_END) {
+                return out.flush();
+            } else if (type == MSG_ERROR) {
+                print_error(p, len);
+                return false;
+            }
+        }
+        if (!out.flush() || !sync_fill(sc, REPLY_TIMEOUT_MS))
+            return false;
+    }
+}
+
+static int cmd_tail(SyncClient *sc, const std::string &uuid, uint16_t lines, bool follow) {
+    OutputStream out(STDOUT_FILENO);
+    if (!follow)
+        return stream_range(sc, uuid, REPLAY_TAIL_LINES, lines, out) ? 0 : 1;
+
+    if (!(sc->capabilities & CAP_OBSERVE) || !(sc->capabilities & CAP_REPLAY_RANGE)) {
+        fprintf(stderr, "crt-sessionctl: daemon cannot observe sessions\n");
+        return 1;
+    }
+
+    // ATTACH: [36B id][1B replay_mode][8B value][1B attach_flags]
+    uint8_t req[SESSION_ID_LEN + 1 + 8 + 1];
+    memcpy(req, uuid.data(), SESSION_ID_LEN);
+    req[SESSION_ID_LEN] = REPLAY_TAIL_LINES;
+    write_u64_le(req + SESSION_ID_LEN + 1, lines);
+    req[SESSION_ID_LEN + 9] = ATTACH_OBSERVE;
+    if (!sync_send(sc, MSG_ATTACH, req, sizeof(req)))
+        return 1;
+
+    uint64_t next_ping = monotonic_ns() + PING_INTERVAL_NS;
+    while (true) {
+        uint8_t type;
+        const uint8_t *p;
+        uint32_t len;
+        while (sync_next_frame(sc, &type, &p, &len)) {
+            switch (type) {
+            case MSG_REPLAY_DATA:
+            case MSG_OUTPUT:
+                if (len > SESSION_ID_LEN)
+                    out.add(p + SESSION_ID_LEN, len - SESSION_ID_LEN);
+                break;
+            case MSG_OUTPUT_GAP:
+                if (len >= SESSION_ID_LEN + 16) {
+                    out.flush();
+                    fprintf(stderr, "\ncrt-sessionctl: %llu bytes of output skipped\n",
+                            static_cast<unsigned long long>(
+                                read_u64_le(p + SESSION_ID_LEN + 8) -
+                                read_u64_le(p + SESSION_ID_LEN)));
+                }
+                break;
+            case MSG_SESSION_EXITED:
+                return out.flush() ? 0 : 1;
+            case MSG_ERROR:
+                out.flush();
+                print_error(p, len);
+                return 1;
+            }
+        }
+        if (!out.flush())
+            return 1;
+
+        uint64_t now = monotonic_ns();
+        int wait_ms = next_ping > now ? static_cast<int>((next_ping - now) / 1000000) + 1 : 0;
+        if (!sync_fill(sc, wait_ms)) {
+            // Returning early means the daemon went away, not a timeout
+            if (monotonic_ns() < next_ping)
+                return 1;
+            uint8_t stamp[8];
+            write_u64_le(stamp, monotonic_ns());
+            if (!sync_send(sc, MSG_PING, stamp, sizeof(stamp)))
+                return 1;
+            next_ping = monotonic_ns() + PING_INTERVAL_NS;
+        }
+    }
+}
+
+static int cmd_dump(SyncClient *sc, const std::string &uuid, const char *path) {
+    int fd = STDOUT_FILENO;
+    if (path) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            fprintf(stderr, "crt-sessionctl: %s: %s\n", path, strerror(errno));
+            return 1;
+        }
+    }
+    OutputStream out(fd);
+    bool ok = stream_range(sc, uuid, REPLAY_FULL, 0, out);
+    if (out.failed)
+        fprintf(stderr, "crt-sessionctl: write failed: %s\n", strerror(errno));
+    if (path && close(fd) != 0)
+        ok = false;
+    return ok ? 0 : 1;
+}
+
+static int cmd_send(SyncClient *sc, const std::string &uuid, char **text, int count,
+                    bool newline) {
+    // INPUT: [36B id][bytes], read or copied straight in after the id
+    static constexpr size_t INPUT_CHUNK = 64 * 1024;
+    std::vector<uint8_t> msg(uuid.begin(), uuid.end());
+    auto send_input = [&]() {
+        return sync_send(sc, MSG_INPUT, msg.data(), static_cast<uint32_t>(msg.size()));
+    };
+
+    if (count > 0) {
+        std::string typed;
+        for (int i = 0; i < count; i++) {
+            if (i > 0) typed += ' ';
+            typed += text[i];
+        }
+        if (newline)
+            typed += '\r';
+        for (size_t off = 0; off < typed.size(); off += INPUT_CHUNK) {
+            size_t n = std::min(INPUT_CHUNK, typed.size() - off);
+            msg.resize(SESSION_ID_LEN);
+            msg.insert(msg.end(), typed.begin() + off, typed.begin() + off + n);
+            if (!send_input())
+                return 1;
+        }
+    } else {
+        // No TEXT: forward stdin as is
+        while (true) {
+            msg.resize(SESSION_ID_LEN + INPUT_CHUNK);
+            ssize_t n = read(STDIN_FILENO, msg.data() + SESSION_ID_LEN, INPUT_CHUNK);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            msg.resize(SESSION_ID_LEN + static_cast<size_t>(n));
+            if (!send_input())
+                return 1;
+        }
+    }
+
+    // INPUT has no reply; a PING round trip surfaces any ERROR
+    uint8_t stamp[8];
+    write_u64_le(stamp, monotonic_ns());
+    std::vector<uint8_t> resp;
+    return sync_send(sc, MSG_PING, stamp, sizeof(stamp)) && wait_reply(sc, MSG_PONG, &resp)
+           ? 0 : 1;
+}
+
+static int cmd_kill(SyncClient *sc, char **ids, int count) {
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        std::string uuid;
+        std::vector<uint8_t> resp;
+        if (!resolve_id(sc, ids[i], &uuid) ||
+            !sync_send(sc, MSG_DESTROY, reinterpret_cast<const uint8_t *>(uuid.data()),
+                       SESSION_ID_LEN) ||
+            !wait_reply(sc, MSG_DESTROY_OK, &resp))
+            status = 1;
+    }
+    return status;
+}
+
+// -------------------------------------------------------------------
+// Main
+// -------------------------------------------------------------------
+
+static int usage() {
+    fprintf(stderr,
+            "Usage: crt-sessionctl [--socket PATH] COMMAND [ARGS]\n"
+            "\n"
+            "Commands:\n"
+            "  list                      Sessions with state, size and title\n"
+            "  tail [-f] [-n LINES] ID   Last lines of output; -f keeps following\n"
+            "  dump [-o FILE] ID         All retained scrollback to FILE or stdout\n"
+            "  send [-n] ID [TEXT...]    Type TEXT and Enter (-n: no Enter);\n"
+            "                            without TEXT, send stdin as is\n"
+            "  kill ID...                Destroy sessions\n"
+            "  stats                     Daemon, session and client counters\n"
+            "\n"
+            "ID may be any unique prefix of a session UUID.\n");
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    std::string socket_path;
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "--socket") == 0) {
+        socket_path = argv[i + 1];
+        i += 2;
+    }
+    if (i >= argc)
+        return usage();
+    if (socket_path.empty())
+        socket_path = get_socket_path();
+    const char *cmd = argv[i++];
+
+    if (strcmp(cmd, "stats") == 0)
+        return print_stats(socket_path);
+
+    // Options before the arguments
+    bool follow = false, no_newline = false;
+    uint16_t lines = DEFAULT_TAIL_LINES;
+    const char *out_path = nullptr;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+        if (strcmp(argv[i], "-f") == 0 && strcmp(cmd, "tail") == 0) {
+            follow = true;
+        } else if (strcmp(argv[i], "-n") == 0 && strcmp(cmd, "tail") == 0 && i + 1 < argc) {
+            lines = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-o") == 0 && strcmp(cmd, "dump") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && strcmp(cmd, "send") == 0) {
+            no_newline = true;
+        } else {
+            return usage();
+        }
+    }
+
+    bool takes_id = strcmp(cmd, "list") != 0;
+    if (takes_id ? i >= argc : i != argc)
+        return usage();
+    if (strcmp(cmd, "list") && strcmp(cmd, "tail") && strcmp(cmd, "dump") &&
+        strcmp(cmd, "send") && strcmp(cmd, "kill"))
+        return usage();
+
+    SyncClient sc;
+    if (!sync_connect(&sc, socket_path, CTL_CAPABILITIES)) {
+        fprintf(stderr, "crt-sessionctl: cannot connect to daemon at %s\n", socket_path.c_str());
+        return 1;
+    }
+
+    int status = 1;
+    std::string uuid;
+    if (strcmp(cmd, "list") == 0)
+        status = cmd_list(&sc);
+    else if (strcmp(cmd, "kill") == 0)
+        status = cmd_kill(&sc, argv + i, argc - i);
+    else if (!resolve_id(&sc, argv[i], &uuid))
+        status = 1;
+    else if (strcmp(cmd, "tail") == 0)
+        status = i + 1 == argc ? cmd_tail(&sc, uuid, lines, follow) : usage();
+    else if (strcmp(cmd, "dump") == 0)
+        status = i + 1 == argc ? cmd_dump(&sc, uuid, out_path) : usage();
+    else
+        status = cmd_send(&sc, uuid, argv + i + 1, argc - i - 1, !no_newline);
+
+    sync_close(&sc);
+    return status;
+}
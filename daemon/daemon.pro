@@ -1,13 +1,19 @@
 TEMPLATE = app
 TARGET = crt-sessiond
-CONFIG += console c++17
+CONFIG += console c++17 thread
 CONFIG -= app_bundle  # no .app bundle on macOS
 QT -= gui core        # pure POSIX, no Qt at all
 
 DESTDIR = $$OUT_PWD/../
 
-HEADERS += log.h protocol.h uuid.h ring_buffer.h session.h server.h event_loop.h
-SOURCES += main.cpp uuid.cpp ring_buffer.cpp session.cpp server.cpp event_loop.cpp
+HEADERS += log.h protocol.h uuid.h clock.h secure_mem.h newline_scan.h lz_codec.h worker.h latency.h \
+           ring_buffer.h scrollback_history.h spill_store.h search.h synthetic.h \
+           session.h server.h event_loop.h sync_client.h trigger.h osc_tracker.h \
+           stats_report.h screen_marks.h cr_compact.h
+SOURCES += main.cpp uuid.cpp lz_codec.cpp worker.cpp latency.cpp \
+           ring_buffer.cpp scrollback_history.cpp spill_store.cpp search.cpp synthetic.cpp \
+           session.cpp server.cpp event_loop.cpp sync_client.cpp trigger.cpp osc_tracker.cpp \
+           stats_report.cpp screen_marks.cpp cr_compact.cpp
 
 macx: LIBS += -lutil   # for openpty() on macOS
 linux: LIBS += -lutil   # for openpty() on Linux
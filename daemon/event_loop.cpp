@@ -20,16 +20,28 @@
 */
 
 #include "event_loop.h"
+#include "clock.h"
+#include "latency.h"
 #include "log.h"
 #include "protocol.h"
+#include "search.h"
+#include "spill_store.h"
+#include "synthetic.h"
+#include "trigger.h"
 #include "uuid.h"
+#include "worker.h"
 
 #include <algorithm>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
+#include <dirent.h>
 #include <fcntl.h>
+#include <memory>
+#include <mutex>
 #include <poll.h>
 #include <signal.h>
 #include <sys/ioctl.h>
@@ -38,6 +50,10 @@
 #include <unistd.h>
 #include <vector>
 
+#ifdef __APPLE__
+#include <mach/mach.h>   // task_info for RSS
+#endif
+
 // -------------------------------------------------------------------
 // Self-pipe for signal handling
 // -------------------------------------------------------------------
@@ -88,11 +104,111 @@ static std::vector<Client *> g_clients;
 volatile sig_atomic_t g_shutdown_requested = 0;
 static size_t g_ring_capacity = DEFAULT_RING_BUFFER_SIZE;
 static time_t g_last_activity = 0;  // Last time any session or client was active
+static bool g_persist_scrollback = false;
+static bool g_compact_cr = false;
+static size_t g_history_limit = 0;
+static bool g_spill_history = false;
+static size_t g_spill_quota = 0;
+static uint64_t g_started_at_ns = 0;      // monotonic_ns() at loop start
+static uint64_t g_loop_iterations = 0;
+static unsigned g_trace_seconds = 0;
+static bool g_synthetic_sessions = false;
+static size_t g_max_sessions = MAX_SESSIONS;
+static size_t g_ring_budget = 0;         // Total ring capacity cap, 0 = unlimited
+static int g_psi_fd = -1;                // Memory pressure trigger (Linux PSI)
+static unsigned g_resize_debounce_ms = DEFAULT_RESIZE_DEBOUNCE_MS;
+static size_t g_resizes_pending = 0;
+static uint64_t g_boost_until_ns = 0;   // Latest boost_until_ns of any session
+
+// Latency histograms (reported in STATS)
+static LatencyHistogram g_lat_poll_wait;
+static LatencyHistogram g_lat_loop_work;
+static LatencyHistogram g_lat_output;
+static LatencyHistogram g_lat_replay;
+static LatencyHistogram g_lat_create;
+static LatencyHistogram g_lat_destroy_kill;
+static LatencyHistogram g_lat_interactive;
+static std::unique_ptr<LatencyHistogram> g_lat_handlers[MSG_TYPE_SLOTS];  // By message type
 
 void set_ring_buffer_capacity(size_t capacity) {
     g_ring_capacity = capacity;
 }
 
+void set_history_limit(size_t limit) {
+    g_history_limit = limit;
+}
+
+void set_history_spill(bool enabled, size_t session_quota, size_t global_quota) {
+    g_spill_history = enabled;
+    g_spill_quota = session_quota;
+    SpillStore::setGlobalQuota(global_quota);
+}
+
+void set_synthetic_sessions(bool enabled) {
+    g_synthetic_sessions = enabled;
+}
+
+void set_max_sessions(size_t max) {
+    g_max_sessions = max;
+}
+
+void set_ring_budget(size_t bytes) {
+    g_ring_budget = bytes;
+}
+
+void set_resize_debounce(unsigned ms) {
+    g_resize_debounce_ms = ms;
+}
+
+void set_trace_window(unsigned seconds) {
+    g_trace_seconds = seconds;
+}
+
+void set_scrollback_persistence(bool enabled) {
+    g_persist_scrollback = enabled;
+}
+
+void set_cr_compaction(bool enabled) {
+    g_compact_cr = enabled;
+}
+
+// -------------------------------------------------------------------
+// Crash recovery: rebuild dead sessions from leftover ring files
+// -------------------------------------------------------------------
+
+static void recover_persisted_sessions() {
+    std::string dir = get_socket_dir();
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        LOG_WARN("cannot scan %s for ring files: %s", dir.c_str(), strerror(errno));
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != nullptr) {
+        // Only <uuid>.ring — anything else in the directory is not ours
+        size_t name_len = strlen(ent->d_name);
+        if (name_len != SESSION_ID_LEN + 5 ||
+            strcmp(ent->d_name + SESSION_ID_LEN, ".ring") != 0 ||
+            !uuid_validate(ent->d_name, SESSION_ID_LEN))
+            continue;
+
+        if (g_sessions.size() >= g_max_sessions)
+            break;
+
+        std::string path = dir + "/" + ent->d_name;
+        DaemonSession *s = session_recover(path.c_str());
+        if (s) {
+            g_sessions.push_back(s);
+        } else {
+            // Unreadable leftovers would otherwise accumulate forever
+            LOG_WARN("removing unrecoverable ring file %s", ent->d_name);
+            unlink(path.c_str());
+        }
+    }
+    closedir(d);
+}
+
 // -------------------------------------------------------------------
 // Session lookup
 // -------------------------------------------------------------------
@@ -105,7 +221,120 @@ static DaemonSession *find_session(const char *uuid) {
     return nullptr;
 }
 
+// -------------------------------------------------------------------
+// Session list events
+// -------------------------------------------------------------------
+
+// Bumped on every change a SESSION_EVENT reports
+static uint64_t g_session_version = 0;
+
+// Append one LIST_OK entry for s.
+static void append_list_entry(std::vector<uint8_t> &payload, const DaemonSession *s,
+                              bool extended) {
+    size_t base = payload.size();
+    size_t shell_len = strlen(s->shell);
+    size_t cwd_len = strlen(s->cwd);
+    size_t entry_size = SESSION_ID_LEN + 1 + 2 + 2 +
+                        2 + shell_len + 2 + cwd_len +
+                        8 + 8 + 1;
+    size_t ext_len = LIST_EXT_SIZE + 2 + s->osc.title.size() + 2 + s->osc.cwd.size();
+    if (extended)
+        entry_size += 2 + ext_len;
+    payload.resize(base + entry_size);
+    uint8_t *p = payload.data() + base;
+
+    memcpy(p, s->uuid, SESSION_ID_LEN);
+    p += SESSION_ID_LEN;
+
+    *p++ = s->alive ? 1 : 0;
+
+    write_u16_le(p, s->rows); p += 2;
+    write_u16_le(p, s->cols); p += 2;
+
+    write_u16_le(p, static_cast<uint16_t>(shell_len)); p += 2;
+    memcpy(p, s->shell, shell_len); p += shell_len;
+
+    write_u16_le(p, static_cast<uint16_t>(cwd_len)); p += 2;
+    memcpy(p, s->cwd, cwd_len); p += cwd_len;
+
+    write_u64_le(p, static_cast<uint64_t>(s->created_at)); p += 8;
+    write_u64_le(p, static_cast<uint64_t>(s->detached_at)); p += 8;
+
+    *p++ = (s->client_fd >= 0) ? 1 : 0;
+
+    if (extended) {
+        write_u16_le(p, static_cast<uint16_t>(ext_len)); p += 2;
+        write_u64_le(p, s->ring ? s->ring->capacity() : 0); p += 8;
+        write_u64_le(p, s->ring ? s->ring->used() : 0); p += 8;
+        write_u64_le(p, s->history ? s->history->rawBytes() : 0); p += 8;
+        write_u64_le(p, s->history ? s->history->storedBytes() : 0); p += 8;
+        write_u64_le(p, s->history ? s->history->diskBytes() : 0); p += 8;
+        write_u64_le(p, s->ring ? s->ring->lineCount() : 0); p += 8;
+        write_u64_le(p, s->ring ? s->ring->retainedLines() : 0); p += 8;
+        write_u64_le(p, static_cast<uint64_t>(s->last_output_at)); p += 8;
+        write_u32_le(p, s->bell_count); p += 4;
+        p += write_string(p, s->osc.title.data(), s->osc.title.size());
+        write_string(p, s->osc.cwd.data(), s->osc.cwd.size());
+    }
+}
+
+// Bump the version and tell SUBSCRIBE_SESSIONS clients. CREATED events
+// carry the session's LIST_OK entry instead of data.
+static void emit_session_event(uint8_t kind, const DaemonSession *s,
+                               const uint8_t *data = nullptr, size_t len = 0) {
+    g_session_version++;
+
+    std::vector<uint8_t> msg[2];   // Indexed by CAP_LIST_EXTENDED
+    for (auto *c : g_clients) {
+        if (!c || !(c->subscriptions & SUBSCRIBE_SESSIONS))
+            continue;
+        if (send_queued(c) > SESSION_EVENT_MAX_BACKLOG)
+            continue;   // It will see the version gap and LIST again
+
+        // SESSION_EVENT: [8B version][1B kind][36B id][data]
+        bool extended = kind == SESSION_EVENT_CREATED &&
+                        (c->capabilities & CAP_LIST_EXTENDED);
+        std::vector<uint8_t> &m = msg[extended];
+        if (m.empty()) {
+            m.resize(8 + 1);
+            write_u64_le(m.data(), g_session_version);
+            m[8] = kind;
+            if (kind == SESSION_EVENT_CREATED) {
+                append_list_entry(m, s, extended);
+            } else {
+                m.insert(m.end(), s->uuid, s->uuid + SESSION_ID_LEN);
+                if (len)
+                    m.insert(m.end(), data, data + len);
+            }
+        }
+        queue_message(c, MSG_SESSION_EVENT, m.data(), static_cast<uint32_t>(m.size()));
+    }
+}
+
+// SESSION_EVENT carrying one length-prefixed string
+static void emit_session_string_event(uint8_t kind, const DaemonSession *s,
+                                      const std::string &value) {
+    std::vector<uint8_t> data(2 + value.size());
+    write_string(data.data(), value.data(), value.size());
+    emit_session_event(kind, s, data.data(), data.size());
+}
+
+// Bumped whenever a session leaves g_sessions, so loop stages holding
+// session pointers from before a handler ran know to re-validate them
+static uint64_t g_sessions_removed = 0;
+
 static void remove_session(DaemonSession *session) {
+    g_sessions_removed++;
+    emit_session_event(SESSION_EVENT_REMOVED, session);
+    if (!session->observers.empty()) {
+        std::string sid(session->uuid, SESSION_ID_LEN);
+        for (auto *c : g_clients) {
+            auto &list = c->observed_sessions;
+            list.erase(std::remove(list.begin(), list.end(), sid), list.end());
+        }
+    }
+    if (session->resize_due_ns)
+        g_resizes_pending--;
     for (auto it = g_sessions.begin(); it != g_sessions.end(); ++it) {
         if (*it == session) {
             g_sessions.erase(it);
@@ -114,6 +343,28 @@ static void remove_session(DaemonSession *session) {
     }
 }
 
+// Pause or resume PTY reads for a session, accounting the paused time.
+static void set_flow_paused(DaemonSession *session, bool paused) {
+    if (session->flow_paused == paused)
+        return;
+    uint64_t now = monotonic_ns();
+    if (paused) {
+        session->flow_pauses++;
+        session->flow_paused_since = now;
+    } else {
+        session->flow_paused_ns += now - session->flow_paused_since;
+    }
+    session->flow_paused = paused;
+}
+
+// The user just interacted with the session: service its output first
+// for a while (see INTERACTIVE_BOOST_MS).
+static void boost_session(DaemonSession *session) {
+    session->boost_until_ns = monotonic_ns() +
+        static_cast<uint64_t>(INTERACTIVE_BOOST_MS) * 1000000ull;
+    g_boost_until_ns = std::max(g_boost_until_ns, session->boost_until_ns);
+}
+
 static Client *find_client_for_session(const DaemonSession *session) {
     for (auto *c : g_clients) {
         if (!c) continue;
@@ -125,6 +376,239 @@ static Client *find_client_for_session(const DaemonSession *session) {
     return nullptr;
 }
 
+static Client *find_client_by_id(uint64_t id) {
+    for (auto *c : g_clients) {
+        if (c && c->id == id)
+            return c;
+    }
+    return nullptr;
+}
+
+// -------------------------------------------------------------------
+// Ring memory budget
+// -------------------------------------------------------------------
+
+static size_t ring_bytes_total() {
+    size_t total = 0;
+    for (auto *s : g_sessions)
+        if (s && s->ring) total += s->ring->capacity();
+    return total;
+}
+
+// Shrink the rings of unattached sessions, least recently used first (dead
+// sessions, then by detach time), until `excess` bytes are released or all
+// of them are at RING_SHRINK_FLOOR. Dropped scrollback goes to cold history
+// like any other eviction. Returns the bytes released.
+static size_t shrink_rings(size_t excess, const char *reason) {
+    std::vector<DaemonSession *> lru;
+    for (auto *s : g_sessions) {
+        if (s && s->ring && s->client_fd < 0 && s->ring->capacity() > RING_SHRINK_FLOOR)
+            lru.push_back(s);
+    }
+    std::sort(lru.begin(), lru.end(), [](const DaemonSession *a, const DaemonSession *b) {
+        if (a->alive != b->alive)
+            return !a->alive;
+        return a->detached_at < b->detached_at;
+    });
+
+    size_t released = 0;
+    size_t shrunk = 0;
+    for (auto *s : lru) {
+        if (released >= excess)
+            break;
+        size_t cap = s->ring->capacity();
+        size_t target = std::max(RING_SHRINK_FLOOR, cap - std::min(cap, excess - released));
+        if (s->ring->resize(target)) {
+            released += cap - target;
+            shrunk++;
+        }
+    }
+    if (shrunk)
+        LOG_INFO("%s: shrank %zu ring(s), released %zu KB", reason, shrunk, released / 1024);
+    return released;
+}
+
+static void enforce_ring_budget() {
+    if (!g_ring_budget)
+        return;
+    size_t total = ring_bytes_total();
+    if (total <= g_ring_budget)
+        return;
+    size_t excess = total - g_ring_budget;
+    if (shrink_rings(excess, "ring budget") < excess)
+        LOG_WARN("ring budget %zu KB exceeded by attached sessions (%zu KB in use)",
+                 g_ring_budget / 1024, ring_bytes_total() / 1024);
+}
+
+// Give an attached session back the ring it asked for; others pay for it.
+static void regrow_ring(DaemonSession *session) {
+    if (!session->ring || session->ring->capacity() >= session->ring_requested)
+        return;
+    if (session->ring->resize(session->ring_requested))
+        enforce_ring_budget();
+}
+
+// Arm a PSI trigger on /proc/pressure/memory (Linux 4.20+); -1 where absent.
+static int open_memory_pressure_trigger() {
+#ifdef __linux__
+    int fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    // 150 ms of partial stall within 2 s (unprivileged triggers need a
+    // window that is a multiple of 2 s)
+    static const char trigger[] = "some 150000 2000000";
+    if (write(fd, trigger, sizeof(trigger)) < 0) {
+        LOG_DEBUG("PSI trigger unavailable: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+// Memory is tight: release half of the unattached rings' total capacity,
+// least recently used rings first (see shrink_rings).
+static void handle_memory_pressure() {
+    size_t reclaimable = 0;
+    for (auto *s : g_sessions) {
+        if (s && s->ring && s->client_fd < 0)
+            reclaimable += s->ring->capacity();
+    }
+    shrink_rings(reclaimable / 2, "memory pressure");
+}
+
+// -------------------------------------------------------------------
+// Buffered PTY input
+// -------------------------------------------------------------------
+
+static size_t input_queued(const DaemonSession *session) {
+    return session->input_queue.size() - session->input_queue_off;
+}
+
+static void send_input_flow(Client *client, const DaemonSession *session, bool paused) {
+    if (!(client->capabilities & CAP_INPUT_FLOW))
+        return;
+    // INPUT_FLOW: [36B session_id][1B paused]
+    uint8_t msg[SESSION_ID_LEN + 1];
+    memcpy(msg, session->uuid, SESSION_ID_LEN);
+    msg[SESSION_ID_LEN] = paused ? 1 : 0;
+    queue_message(client, MSG_INPUT_FLOW, msg, sizeof(msg));
+}
+
+// Signal the queue crossing the high/low water marks to the attached client.
+static void update_input_flow(DaemonSession *session) {
+    size_t queued = input_queued(session);
+    if (!session->input_flow_paused && queued > INPUT_QUEUE_HIGH)
+        session->input_flow_paused = true;
+    else if (session->input_flow_paused && queued < INPUT_QUEUE_LOW)
+        session->input_flow_paused = false;
+    else
+        return;
+    Client *c = session->client_fd >= 0 ? find_client_for_session(session) : nullptr;
+    if (c)
+        send_input_flow(c, session, session->input_flow_paused);
+}
+
+static void drop_input_queue(DaemonSession *session) {
+    std::vector<uint8_t>().swap(session->input_queue);
+    session->input_queue_off = 0;
+    update_input_flow(session);
+}
+
+// Write to the PTY master until it would block. Returns bytes written, or
+// -1 if the fd failed (the shell is gone; SIGCHLD does the cleanup).
+static ssize_t write_pty(DaemonSession *session, const uint8_t *data, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+        ssize_t n = write(session->master_fd, data + written, len - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+            session->pty_bytes_written += static_cast<uint64_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            LOG_ERROR("write to PTY master fd=%d failed: %s",
+                      session->master_fd, strerror(errno));
+            return -1;
+        }
+    }
+    return static_cast<ssize_t>(written);
+}
+
+// Write input straight through when nothing is queued ahead of it and
+// queue whatever the PTY won't take yet; the loop drains it on POLLOUT.
+static void write_pty_input(DaemonSession *session, const uint8_t *data, size_t len) {
+    size_t written = 0;
+    if (input_queued(session) == 0) {
+        ssize_t n = write_pty(session, data, len);
+        if (n < 0)
+            return;
+        written = static_cast<size_t>(n);
+    }
+    if (written < len) {
+        session->input_queue.insert(session->input_queue.end(), data + written, data + len);
+        update_input_flow(session);
+    }
+}
+
+static void drain_input_queue(DaemonSession *session) {
+    std::vector<uint8_t> &q = session->input_queue;
+    ssize_t n = write_pty(session, q.data() + session->input_queue_off,
+                          q.size() - session->input_queue_off);
+    if (n < 0) {
+        drop_input_queue(session);
+        return;
+    }
+    session->input_queue_off += static_cast<size_t>(n);
+    if (session->input_queue_off == q.size()) {
+        // Don't hold on to a paste-sized allocation once it has gone through
+        if (q.capacity() > INPUT_QUEUE_HIGH)
+            std::vector<uint8_t>().swap(q);
+        else
+            q.clear();
+        session->input_queue_off = 0;
+    } else if (session->input_queue_off >= INPUT_QUEUE_LOW &&
+               session->input_queue_off * 2 >= q.size()) {
+        q.erase(q.begin(), q.begin() + static_cast<ptrdiff_t>(session->input_queue_off));
+        session->input_queue_off = 0;
+    }
+    update_input_flow(session);
+}
+
+// True while one of the client's sessions holds INPUT_QUEUE_MAX of unwritten
+// input; the loop stops reading the client's socket until it drains.
+static bool client_input_blocked(const Client *client) {
+    for (auto *s : g_sessions) {
+        if (s && s->client_fd == client->fd && input_queued(s) >= INPUT_QUEUE_MAX)
+            return true;
+    }
+    return false;
+}
+
+// The session's process has ended: discard input it will never read and
+// tell the attached client, if any
+static void notify_session_exited(DaemonSession *session) {
+    drop_input_queue(session);
+    uint8_t exit_code[4];
+    write_u32_le(exit_code, static_cast<uint32_t>(session->exit_code));
+    emit_session_event(SESSION_EVENT_EXITED, session, exit_code, sizeof(exit_code));
+    uint8_t exited[SESSION_ID_LEN + 4];
+    memcpy(exited, session->uuid, SESSION_ID_LEN);
+    write_u32_le(exited + SESSION_ID_LEN, static_cast<uint32_t>(session->exit_code));
+    for (const auto &o : session->observers)
+        queue_message(find_client_by_id(o.client_id), MSG_SESSION_EXITED, exited, sizeof(exited));
+    if (session->client_fd < 0)
+        return;
+    Client *c = find_client_for_session(session);
+    if (!c)
+        return;
+    queue_message(c, MSG_SESSION_EXITED, exited, sizeof(exited));
+}
+
 // -------------------------------------------------------------------
 // Detach a specific session from its client
 // -------------------------------------------------------------------
@@ -133,13 +617,14 @@ static void detach_session_from_client(DaemonSession *session, Client *client) {
     if (!session || !client) return;
 
     // Save termios
-    if (session->master_fd >= 0) {
-        if (tcgetattr(session->master_fd, &session->saved_termios) == 0)
-            session->has_saved_termios = true;
-    }
+    if (session->backend->getTermios(session, &session->saved_termios))
+        session->has_saved_termios = true;
 
     session->client_fd = -1;
     session->detached_at = time(nullptr);
+    uint8_t detached_at[8];
+    write_u64_le(detached_at, static_cast<uint64_t>(session->detached_at));
+    emit_session_event(SESSION_EVENT_DETACHED, session, detached_at, sizeof(detached_at));
 
     // Remove from client's attached list
     auto &list = client->attached_sessions;
@@ -165,6 +650,109 @@ static void detach_all_client_sessions(Client *client) {
     }
 }
 
+// -------------------------------------------------------------------
+// Read-only observers
+// -------------------------------------------------------------------
+
+static SessionObserver *find_observer(DaemonSession *session, uint64_t client_id) {
+    for (auto &o : session->observers) {
+        if (o.client_id == client_id)
+            return &o;
+    }
+    return nullptr;
+}
+
+// Watch session read-only. False if client already owns it.
+static bool observe_session(Client *client, DaemonSession *session) {
+    if (session->client_fd == client->fd)
+        return false;
+    if (!find_observer(session, client->id)) {
+        session->observers.push_back(SessionObserver{client->id, false, 0});
+        client->observed_sessions.push_back(std::string(session->uuid, SESSION_ID_LEN));
+    }
+    LOG_INFO("session %s observed by client fd=%d (%zu observers)",
+             session->uuid, client->fd, session->observers.size());
+    return true;
+}
+
+static void stop_observing(DaemonSession *session, Client *client) {
+    auto &obs = session->observers;
+    obs.erase(std::remove_if(obs.begin(), obs.end(), [client](const SessionObserver &o) {
+                  return o.client_id == client->id;
+              }),
+              obs.end());
+    auto &list = client->observed_sessions;
+    list.erase(std::remove(list.begin(), list.end(),
+                           std::string(session->uuid, SESSION_ID_LEN)),
+               list.end());
+}
+
+static void stop_all_observing(Client *client) {
+    auto sessions_copy = client->observed_sessions;
+    for (const auto &sid : sessions_copy) {
+        DaemonSession *s = find_session(sid.c_str());
+        if (s)
+            stop_observing(s, client);
+    }
+    client->observed_sessions.clear();
+}
+
+// True if client only watches session: input, resize, signals, termios
+// and DESTROY are the owner's
+static bool observes_only(const Client *client, DaemonSession *session) {
+    return session->client_fd != client->fd && find_observer(session, client->id);
+}
+
+// OUTPUT_GAP: [36B session_id][8B from_seq][8B to_seq]
+static void send_output_gap(Client *client, const DaemonSession *session,
+                            SessionObserver &o, uint64_t to_seq) {
+    uint8_t gap[SESSION_ID_LEN + 8 + 8];
+    memcpy(gap, session->uuid, SESSION_ID_LEN);
+    write_u64_le(gap + SESSION_ID_LEN, o.dropped_from);
+    write_u64_le(gap + SESSION_ID_LEN + 8, to_seq);
+    queue_message(client, MSG_OUTPUT_GAP, gap, sizeof(gap));
+    o.lagging = false;
+}
+
+// Queue a PTY read (bytes from seq on) to every observer that keeps up.
+// A backed-up observer loses output instead of pausing the session.
+static void broadcast_to_observers(DaemonSession *session, const SharedFrame &frame,
+                                   uint64_t seq) {
+    for (auto &o : session->observers) {
+        Client *c = find_client_by_id(o.client_id);
+        if (!c) continue;
+        size_t queued = send_queued(c);
+        if (o.lagging) {
+            if (queued > OBSERVER_RESUME_BACKLOG)
+                continue;
+            send_output_gap(c, session, o, seq);
+        } else if (queued > OBSERVER_MAX_BACKLOG) {
+            o.lagging = true;
+            o.dropped_from = seq;
+            LOG_DEBUG("observer fd=%d of session %s lagging, dropping output",
+                      c->fd, session->uuid);
+            continue;
+        }
+        queue_shared_frame(c, frame);
+        if (!flush_send_buf(c))
+            LOG_ERROR("flush failed for observer fd=%d (output)", c->fd);
+    }
+}
+
+// After a flush: report the gaps of lagging observations that have drained
+// without waiting for more output.
+static void resume_observations(Client *client) {
+    if (send_queued(client) > OBSERVER_RESUME_BACKLOG)
+        return;
+    for (const auto &sid : client->observed_sessions) {
+        DaemonSession *s = find_session(sid.c_str());
+        if (!s) continue;
+        SessionObserver *o = find_observer(s, client->id);
+        if (o && o->lagging)
+            send_output_gap(client, s, *o, session_scrollback_end(s));
+    }
+}
+
 // -------------------------------------------------------------------
 // Extract session UUID from payload and look up session.
 // Sends error response and returns nullptr on failure.
@@ -190,64 +778,597 @@ static DaemonSession *find_session_from_payload(Client *client,
     return s;
 }
 
-// -------------------------------------------------------------------
-// Send replay data for a session
-// -------------------------------------------------------------------
+// -------------------------------------------------------------------
+// Send replay data for a session
+// -------------------------------------------------------------------
+
+// Accumulates replay bytes into REPLAY_DATA (or RANGE_DATA) messages of
+// REPLAY_CHUNK_SIZE, each prefixed with [36B uuid] (plus [8B seq] for
+// RANGE_DATA).
+struct ReplayWriter {
+    Client *client;
+    const char *uuid;
+    uint8_t type;
+    size_t header;
+    uint64_t seq;       // Sequence number of the next byte written
+    std::vector<uint8_t> msg;
+    size_t total = 0;
+    size_t chunks = 0;
+
+    ReplayWriter(Client *c, const char *id, uint8_t msg_type, uint64_t start_seq)
+        : client(c), uuid(id), type(msg_type),
+          header(msg_type == MSG_RANGE_DATA ? SESSION_ID_LEN + 8 : SESSION_ID_LEN),
+          seq(start_seq) {
+        msg.reserve(header + REPLAY_CHUNK_SIZE);
+        msg.assign(uuid, uuid + SESSION_ID_LEN);
+        msg.resize(header);
+    }
+
+    void write(const uint8_t *data, size_t len) {
+        while (len > 0) {
+            size_t n = std::min(len, header + REPLAY_CHUNK_SIZE - msg.size());
+            msg.insert(msg.end(), data, data + n);
+            data += n;
+            len -= n;
+            total += n;
+            seq += n;
+            if (msg.size() == header + REPLAY_CHUNK_SIZE)
+                flush();
+        }
+    }
+
+    void flush() {
+        if (msg.size() == header)
+            return;
+        if (type == MSG_RANGE_DATA)
+            write_u64_le(msg.data() + SESSION_ID_LEN, seq - (msg.size() - header));
+        queue_message(client, type, msg.data(), static_cast<uint32_t>(msg.size()));
+        msg.resize(header);
+        chunks++;
+    }
+};
+
+// Advance seq past UTF-8 continuation bytes (at most 3) so a replay never
+// starts in the middle of a multi-byte character.
+static uint64_t utf8_boundary(const DaemonSession *session, uint64_t seq, uint64_t end) {
+    std::vector<uint8_t> head;
+    size_t n = session_read_scrollback(
+        session, seq, static_cast<size_t>(std::min<uint64_t>(3, end - seq)), head);
+    size_t skip = 0;
+    while (skip < n && (head[skip] & 0xC0) == 0x80)
+        skip++;
+    return seq + skip;
+}
+
+// Resolve a replay mode to a scrollback range [*start, *end). end_seq 0
+// means the current end; max_bytes 0 means no limit.
+static void resolve_replay_range(const DaemonSession *session, uint8_t mode,
+                                 uint64_t value, uint64_t end_seq, uint64_t max_bytes,
+                                 uint64_t *start, uint64_t *end) {
+    uint64_t oldest = session_scrollback_start(session);
+    uint64_t newest = session_scrollback_end(session);
+
+    *end = (end_seq == 0 || end_seq > newest) ? newest : std::max(end_seq, oldest);
+    switch (mode) {
+    case REPLAY_TAIL_LINES:
+        *start = session_find_line_start(session, *end, value);
+        break;
+    case REPLAY_TAIL_BYTES:
+        *start = *end - std::min(value, *end - oldest);
+        break;
+    case REPLAY_NONE:
+        *start = *end;
+        break;
+    case REPLAY_FROM_SEQ:
+        *start = std::min(std::max(value, oldest), *end);
+        break;
+    default:
+        *start = oldest;
+        break;
+    }
+
+    if (max_bytes > 0 && *end - *start > max_bytes) {
+        if (mode == REPLAY_FROM_SEQ)
+            *end = *start + max_bytes;
+        else
+            *start = *end - max_bytes;
+    }
+    if (*start < *end)
+        *start = utf8_boundary(session, *start, *end);
+}
+
+// What an attach replays: a preamble, then scrollback spans in order.
+// Only REPLAY_TRIMMED has more than one span or a preamble.
+struct ReplayPlan {
+    std::string preamble;
+    std::vector<SeqSpan> spans;
+    uint64_t start = 0;     // Where the spans begin (end if there are none)
+    uint64_t end = 0;
+
+    uint64_t size() const {
+        uint64_t n = preamble.size();
+        for (const SeqSpan &span : spans)
+            n += span.second - span.first;
+        return n;
+    }
+};
+
+// Move seq past the first newline within the next LINE_SCAN_LIMIT bytes,
+// or to a UTF-8 boundary if there is none.
+static uint64_t line_boundary(const DaemonSession *session, uint64_t seq, uint64_t end) {
+    static constexpr size_t LINE_SCAN_LIMIT = 4096;
+    std::vector<uint8_t> head;
+    size_t n = session_read_scrollback(
+        session, seq, static_cast<size_t>(std::min<uint64_t>(LINE_SCAN_LIMIT, end - seq)), head);
+    const void *nl = n ? memchr(head.data(), '\n', n) : nullptr;
+    if (nl)
+        return seq + (static_cast<const uint8_t *>(nl) - head.data()) + 1;
+    return utf8_boundary(session, seq, end);
+}
+
+// REPLAY_TRIMMED needs CAP_REPLAY_TRIM; without it the replay is full.
+static void plan_attach_replay(const Client *client, const DaemonSession *session,
+                               uint8_t mode, uint64_t value, ReplayPlan *plan) {
+    if (mode == REPLAY_TRIMMED && !(client->capabilities & CAP_REPLAY_TRIM))
+        mode = REPLAY_FULL;
+    if (mode != REPLAY_TRIMMED) {
+        resolve_replay_range(session, mode, value, 0, 0, &plan->start, &plan->end);
+        if (plan->start < plan->end)
+            plan->spans.push_back({plan->start, plan->end});
+        return;
+    }
+
+    plan->end = session_scrollback_end(session);
+    bool safe = screen_marks_replay(session->screen, session_scrollback_start(session),
+                                    plan->end, &plan->spans);
+    if (!safe && !plan->spans.empty()) {
+        SeqSpan &first = plan->spans.front();
+        first.first = line_boundary(session, first.first, first.second);
+        if (first.first >= first.second)
+            plan->spans.erase(plan->spans.begin());
+    }
+    screen_marks_preamble(session->screen, &plan->preamble);
+    plan->start = plan->spans.empty() ? plan->end : plan->spans.front().first;
+}
+
+// Writes replay data into a snapshot file instead of messages.
+struct SnapshotWriter {
+    int fd;
+    size_t total = 0;
+    bool failed = false;
+
+    explicit SnapshotWriter(int snapshot_fd) : fd(snapshot_fd) {}
+
+    void write(const uint8_t *data, size_t len) {
+        while (len > 0 && !failed) {
+            ssize_t n = ::write(fd, data, len);
+            if (n > 0) {
+                data += n;
+                len -= static_cast<size_t>(n);
+                total += static_cast<size_t>(n);
+            } else if (n < 0 && errno != EINTR) {
+                failed = true;
+            }
+        }
+    }
+
+    void flush() {}
+};
+
+// Stream scrollback [start, end) into writer: cold history first, one block
+// at a time, then the hot ring straight from its segments.
+template <typename Writer>
+static void stream_scrollback(const DaemonSession *session, uint64_t start, uint64_t end,
+                              Writer &writer) {
+    uint64_t seq = start;
+
+    ScrollbackHistory *history = session->history;
+    if (history && seq < history->endSeq()) {
+        std::vector<uint8_t> block;
+        while (seq < std::min(end, history->endSeq())) {
+            block.clear();
+            size_t want = static_cast<size_t>(
+                std::min<uint64_t>(HISTORY_BLOCK_SIZE, std::min(end, history->endSeq()) - seq));
+            size_t n = history->read(seq, want, block);
+            if (n == 0)
+                break;
+            writer.write(block.data(), n);
+            seq += n;
+        }
+    }
+
+    if (session->ring && seq < end) {
+        const uint8_t *p1, *p2;
+        size_t len1, len2;
+        session->ring->readRange(seq, static_cast<size_t>(end - seq), &p1, &len1, &p2, &len2);
+        writer.write(p1, len1);
+        writer.write(p2, len2);
+    }
+    writer.flush();
+}
+
+// Write a plan's preamble and spans into writer
+template <typename Writer>
+static void stream_replay_plan(const DaemonSession *session, const ReplayPlan &plan,
+                               Writer &writer) {
+    writer.write(reinterpret_cast<const uint8_t *>(plan.preamble.data()),
+                 plan.preamble.size());
+    for (const SeqSpan &span : plan.spans)
+        stream_scrollback(session, span.first, span.second, writer);
+    writer.flush();
+}
+
+static void send_replay(DaemonSession *session, Client *client, const ReplayPlan &plan) {
+    if (!session || !client)
+        return;
+
+    LatencyScope timing(g_lat_replay, "send_replay", "replay");
+    ReplayWriter writer(client, session->uuid, MSG_REPLAY_DATA, plan.start);
+    stream_replay_plan(session, plan, writer);
+
+    // Send REPLAY_END with [36B uuid], even if no data
+    queue_message(client, MSG_REPLAY_END,
+                  reinterpret_cast<const uint8_t *>(session->uuid),
+                  SESSION_ID_LEN);
+
+    LOG_DEBUG("sent replay: %zu bytes in %zu chunks for session %s",
+              writer.total, writer.chunks, session->uuid);
+}
+
+// Replay a plan as one snapshot fd (ATTACH_REPLAY_FD). Returns false,
+// having queued nothing, if the snapshot can't be made; the caller then
+// falls back to send_replay().
+static bool send_replay_fd(DaemonSession *session, Client *client, const ReplayPlan &plan) {
+    if (plan.size() == 0)
+        return false;
+
+    LatencyScope timing(g_lat_replay, "send_replay_fd", "replay");
+    int fd = create_snapshot_fd("crt-replay");
+    if (fd < 0) {
+        LOG_WARN("cannot create replay snapshot: %s", strerror(errno));
+        return false;
+    }
+    SnapshotWriter writer(fd);
+    stream_replay_plan(session, plan, writer);
+    if (writer.failed) {
+        LOG_WARN("writing replay snapshot failed: %s", strerror(errno));
+        close(fd);
+        return false;
+    }
+    seal_snapshot_fd(fd);
+
+    // REPLAY_FD: [36B session_id][8B start_seq][8B length]
+    uint8_t msg[SESSION_ID_LEN + 8 + 8];
+    memcpy(msg, session->uuid, SESSION_ID_LEN);
+    write_u64_le(msg + SESSION_ID_LEN, plan.start);
+    write_u64_le(msg + SESSION_ID_LEN + 8, writer.total);
+    queue_message_fd(client, MSG_REPLAY_FD, msg, sizeof(msg), fd);
+    queue_message(client, MSG_REPLAY_END,
+                  reinterpret_cast<const uint8_t *>(session->uuid), SESSION_ID_LEN);
+
+    LOG_DEBUG("sent replay snapshot: %zu bytes for session %s", writer.total, session->uuid);
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Scrollback search (scans run on the worker thread)
+// -------------------------------------------------------------------
+
+// A search in progress. Sessions are scanned one at a time so at most one
+// ring snapshot is alive; the loop starts the next scan when one completes.
+struct PendingSearch {
+    uint64_t client_id;
+    uint32_t request_id;
+    uint16_t context;
+    uint32_t max_matches;
+    uint32_t matches = 0;
+    std::shared_ptr<SearchMatcher> matcher;   // read-only once submitted
+    std::deque<std::string> sessions;         // still to scan
+};
+
+struct SearchCompletion {
+    std::shared_ptr<PendingSearch> search;
+    std::string uuid;
+    std::vector<SearchMatch> matches;
+    bool truncated;
+};
+
+// Filled by the worker, drained by the loop after a signal pipe wakeup
+static std::mutex g_search_mutex;
+static std::vector<SearchCompletion> g_search_done;
+
+static void finish_search(Client *client, const PendingSearch &search, uint8_t status) {
+    // SEARCH_END: [4B request_id][4B match_count][1B status]
+    uint8_t resp[4 + 4 + 1];
+    write_u32_le(resp, search.request_id);
+    write_u32_le(resp + 4, search.matches);
+    resp[8] = status;
+    queue_message(client, MSG_SEARCH_END, resp, sizeof(resp));
+    client->searching = false;
+}
+
+// Snapshot the next session that still exists and queue its scan.
+// Returns false when no sessions are left.
+static bool start_next_search(const std::shared_ptr<PendingSearch> &search) {
+    while (!search->sessions.empty()) {
+        std::string uuid = search->sessions.front();
+        search->sessions.pop_front();
+        DaemonSession *s = find_session(uuid.c_str());
+        if (!s)
+            continue;
+
+        // Sealed history is read by the worker through a snapshot; the
+        // unsealed tail and the ring are copied now
+        auto source = std::make_shared<SearchSource>();
+        if (s->history) {
+            source->history = s->history->snapshot();
+            source->tail_seq = s->history->sealedEndSeq();
+        } else {
+            source->tail_seq = session_scrollback_start(s);
+        }
+        uint64_t end = session_scrollback_end(s);
+        if (end > source->tail_seq)
+            session_read_scrollback(s, source->tail_seq,
+                                    static_cast<size_t>(end - source->tail_seq), source->tail);
+
+        uint32_t budget = search->max_matches - search->matches;
+        worker_submit([search, source, uuid, budget] {
+            SearchCompletion done;
+            done.search = search;
+            done.uuid = uuid;
+            done.truncated = search_scan(*search->matcher, *source, search->context,
+                                         budget, done.matches);
+            {
+                std::lock_guard<std::mutex> lock(g_search_mutex);
+                g_search_done.push_back(std::move(done));
+            }
+            signal_pipe_notify();
+        });
+        return true;
+    }
+    return false;
+}
+
+static void process_search_completions() {
+    std::vector<SearchCompletion> done;
+    {
+        std::lock_guard<std::mutex> lock(g_search_mutex);
+        done.swap(g_search_done);
+    }
+
+    for (auto &d : done) {
+        PendingSearch &search = *d.search;
+        Client *client = find_client_by_id(search.client_id);
+        if (!client)
+            continue;  // Client went away: the search ends here
+
+        for (const auto &m : d.matches) {
+            // SEARCH_MATCH: [4B request_id][36B session_id][8B seq][4B match_len]
+            //               [8B line][8B context_seq][2B context_len][context]
+            size_t ctx_len = std::min<size_t>(m.context.size(), UINT16_MAX);
+            std::vector<uint8_t> msg(4 + SESSION_ID_LEN + 8 + 4 + 8 + 8 + 2 + ctx_len);
+            uint8_t *p = msg.data();
+            write_u32_le(p, search.request_id); p += 4;
+            memcpy(p, d.uuid.data(), SESSION_ID_LEN); p += SESSION_ID_LEN;
+            write_u64_le(p, m.seq); p += 8;
+            write_u32_le(p, m.len); p += 4;
+            write_u64_le(p, m.line); p += 8;
+            write_u64_le(p, m.context_seq); p += 8;
+            write_u16_le(p, static_cast<uint16_t>(ctx_len)); p += 2;
+            memcpy(p, m.context.data(), ctx_len);
+            queue_message(client, MSG_SEARCH_MATCH, msg.data(), static_cast<uint32_t>(msg.size()));
+            search.matches++;
+        }
+
+        if (d.truncated)
+            finish_search(client, search, SEARCH_TRUNCATED);
+        else if (!start_next_search(d.search))
+            finish_search(client, search, SEARCH_COMPLETE);
+    }
+}
+
+// -------------------------------------------------------------------
+// Output triggers
+// -------------------------------------------------------------------
+
+// session_read_scrollback() that tolerates a start before the oldest
+// retained byte (a TriggerReadFn)
+static size_t read_scrollback_bytes(void *ctx, uint64_t seq, size_t len,
+                                 std::vector<uint8_t> &out) {
+    const DaemonSession *s = static_cast<const DaemonSession *>(ctx);
+    uint64_t start = session_scrollback_start(s);
+    if (seq < start) {
+        uint64_t gone = std::min<uint64_t>(start - seq, len);
+        seq += gone;
+        len -= static_cast<size_t>(gone);
+    }
+    return len ? session_read_scrollback(s, seq, len, out) : 0;
+}
+
+// Match freshly read output (already in the ring) against the session's
+// triggers and send any events to the client that set them.
+static void run_triggers(DaemonSession *s, const uint8_t *data, size_t len) {
+    static std::vector<TriggerHit> hits;
+    hits.clear();
+    s->triggers->scan(data, len, session_scrollback_end(s) - len, monotonic_ns(),
+                      read_scrollback_bytes, s, hits);
+    if (hits.empty())
+        return;
+
+    Client *c = find_client_by_id(s->trigger_client_id);
+    if (!c)
+        return;
+    std::vector<uint8_t> msg;
+    for (const auto &hit : hits) {
+        // TRIGGER: [36B id][4B trigger_id][8B seq][4B match_len][4B suppressed]
+        //          [8B context_seq][2B context_len][context]
+        msg.resize(SESSION_ID_LEN + 4 + 8 + 4 + 4 + 8 + 2 + hit.context.size());
+        uint8_t *p = msg.data();
+        memcpy(p, s->uuid, SESSION_ID_LEN);           p += SESSION_ID_LEN;
+        write_u32_le(p, hit.id);                      p += 4;
+        write_u64_le(p, hit.seq);                     p += 8;
+        write_u32_le(p, hit.len);                     p += 4;
+        write_u32_le(p, hit.suppressed);              p += 4;
+        write_u64_le(p, hit.context_seq);             p += 8;
+        write_u16_le(p, static_cast<uint16_t>(hit.context.size())); p += 2;
+        if (!hit.context.empty())
+            memcpy(p, hit.context.data(), hit.context.size());
+        queue_message(c, MSG_TRIGGER, msg.data(), static_cast<uint32_t>(msg.size()));
+        LOG_DEBUG("session %s trigger %u fired at seq %llu", s->uuid, hit.id,
+                  static_cast<unsigned long long>(hit.seq));
+    }
+}
+
+// A disconnecting client's triggers have no one left to notify.
+static void drop_client_triggers(const Client *client) {
+    for (auto *s : g_sessions) {
+        if (s && s->triggers && s->trigger_client_id == client->id) {
+            delete s->triggers;
+            s->triggers = nullptr;
+            s->trigger_client_id = 0;
+        }
+    }
+}
+
+// -------------------------------------------------------------------
+// Activity monitoring
+// -------------------------------------------------------------------
+
+static void send_activity(Client *client, const DaemonSession *s, uint8_t kind) {
+    // ACTIVITY: [36B id][1B kind][8B last_output_at][4B bell_count]
+    uint8_t msg[SESSION_ID_LEN + 1 + 8 + 4];
+    memcpy(msg, s->uuid, SESSION_ID_LEN);
+    msg[SESSION_ID_LEN] = kind;
+    write_u64_le(msg + SESSION_ID_LEN + 1, static_cast<uint64_t>(s->last_output_at));
+    write_u32_le(msg + SESSION_ID_LEN + 9, s->bell_count);
+    queue_message(client, MSG_ACTIVITY, msg, sizeof(msg));
+}
+
+static bool watches_activity(const Client *c, const DaemonSession *s) {
+    return c && (c->subscriptions & SUBSCRIBE_ACTIVITY) && s->client_fd != c->fd;
+}
+
+// True if the BEL at bel is the terminator of an OSC sequence (ESC ] ...
+// BEL): walk back to the nearest ESC or BEL, continuing into the
+// scrollback before data if needed.
+static bool bel_ends_osc(DaemonSession *s, const uint8_t *data, const uint8_t *bel,
+                         uint64_t data_seq) {
+    size_t span = static_cast<size_t>(bel - data);
+    size_t look = std::min(span, OSC_MAX_LOOKBACK);
+    for (size_t i = 1; i <= look; i++) {
+        uint8_t b = bel[-static_cast<ptrdiff_t>(i)];
+        if (b == 0x1b)
+            return i > 1 && bel[1 - static_cast<ptrdiff_t>(i)] == ']';
+        if (b == '\a')
+            return false;
+    }
+    if (look == OSC_MAX_LOOKBACK || data_seq == 0)
+        return false;
 
-static void send_replay(DaemonSession *session, Client *client) {
-    if (!session || !client || !session->ring || session->ring->empty()) {
-        // Always send REPLAY_END even if no data
-        if (client && session)
-            queue_message(client, MSG_REPLAY_END,
-                          reinterpret_cast<const uint8_t *>(session->uuid),
-                          SESSION_ID_LEN);
-        return;
+    // The sequence may have started in an earlier read
+    size_t want = std::min<uint64_t>(OSC_MAX_LOOKBACK - look, data_seq);
+    std::vector<uint8_t> before;
+    read_scrollback_bytes(s, data_seq - want, want, before);
+    uint8_t next = span ? data[0] : '\a';   // byte following before.back()
+    for (size_t i = before.size(); i-- > 0; ) {
+        uint8_t b = before[i];
+        if (b == 0x1b)
+            return next == ']';
+        if (b == '\a')
+            return false;
+        next = b;
     }
+    return false;
+}
 
-    const uint8_t *p1, *p2;
-    size_t len1, len2;
-    session->ring->readAll(&p1, &len1, &p2, &len2);
+// Output was just read (and written to the ring): note the time, count
+// real bells and tell subscribers that were waiting for it.
+static void note_output(DaemonSession *s, const uint8_t *data, size_t len, uint64_t now) {
+    uint64_t prev = s->last_output_ns;
+    s->last_output_ns = now;
+    s->last_output_at = time(nullptr);
+
+    uint32_t bells = 0;
+    const uint8_t *end = data + len;
+    const uint8_t *bel = static_cast<const uint8_t *>(memchr(data, '\a', len));
+    if (bel) {
+        uint64_t data_seq = session_scrollback_end(s) - len;
+        for (; bel; bel = static_cast<const uint8_t *>(memchr(bel + 1, '\a',
+                                                                static_cast<size_t>(end - bel - 1)))) {
+            if (!bel_ends_osc(s, data, bel, data_seq))
+                bells++;
+        }
+        s->bell_count += bells;
+    }
 
-    // Find UTF-8 boundary at start
-    size_t skip = session->ring->findUtf8Boundary(0);
-    size_t total_len = len1 + len2;
+    bool ring_bell = bells &&
+        now - s->bell_notified_ns >= static_cast<uint64_t>(ACTIVITY_BELL_INTERVAL_MS) * 1000000ull;
+    for (auto *c : g_clients) {
+        if (!watches_activity(c, s))
+            continue;
+        if (!prev || now - prev >= static_cast<uint64_t>(c->quiet_ms) * 1000000ull)
+            send_activity(c, s, ACTIVITY_OUTPUT);
+        if (ring_bell)
+            send_activity(c, s, ACTIVITY_BELL);
+    }
+    if (ring_bell)
+        s->bell_notified_ns = now;
+}
 
-    // Combine into a single contiguous buffer for chunking
-    std::vector<uint8_t> replay_data;
-    replay_data.reserve(total_len - skip);
-    if (skip < len1) {
-        replay_data.insert(replay_data.end(), p1 + skip, p1 + len1);
-        if (len2 > 0)
-            replay_data.insert(replay_data.end(), p2, p2 + len2);
-    } else {
-        size_t skip2 = skip - len1;
-        if (skip2 < len2)
-            replay_data.insert(replay_data.end(), p2 + skip2, p2 + len2);
-    }
-
-    // Send in REPLAY_CHUNK_SIZE chunks, each prefixed with [36B uuid]
-    size_t offset = 0;
-    while (offset < replay_data.size()) {
-        size_t chunk = std::min(static_cast<size_t>(REPLAY_CHUNK_SIZE),
-                                replay_data.size() - offset);
-        std::vector<uint8_t> msg(SESSION_ID_LEN + chunk);
-        memcpy(msg.data(), session->uuid, SESSION_ID_LEN);
-        memcpy(msg.data() + SESSION_ID_LEN, replay_data.data() + offset, chunk);
-        queue_message(client, MSG_REPLAY_DATA,
-                      msg.data(),
-                      static_cast<uint32_t>(msg.size()));
-        offset += chunk;
-    }
-
-    // Send REPLAY_END with [36B uuid]
-    queue_message(client, MSG_REPLAY_END,
-                  reinterpret_cast<const uint8_t *>(session->uuid),
-                  SESSION_ID_LEN);
+// Report sessions that went quiet since the last check. Returns the poll
+// timeout, shortened to the next session due to go quiet.
+static int check_silence(int timeout_ms) {
+    uint64_t now = monotonic_ns();
+    for (auto *c : g_clients) {
+        if (!c || !(c->subscriptions & SUBSCRIBE_ACTIVITY))
+            continue;
+        uint64_t quiet = static_cast<uint64_t>(c->quiet_ms) * 1000000ull;
+        for (auto *s : g_sessions) {
+            if (!s || !s->alive || !s->last_output_ns || !watches_activity(c, s))
+                continue;
+            uint64_t due = s->last_output_ns + quiet;
+            if (due <= c->silence_checked_ns)
+                continue;
+            if (due <= now)
+                send_activity(c, s, ACTIVITY_SILENCE);
+            else
+                timeout_ms = std::min(timeout_ms, static_cast<int>((due - now + 999999) / 1000000));
+        }
+        c->silence_checked_ns = now;
+    }
+    return timeout_ms;
+}
 
-    LOG_DEBUG("sent replay: %zu bytes in %zu chunks for session %s",
-              replay_data.size(),
-              (replay_data.size() + REPLAY_CHUNK_SIZE - 1) / REPLAY_CHUNK_SIZE,
-              session->uuid);
+// -------------------------------------------------------------------
+// Carriage-return compaction (--compact-cr)
+// -------------------------------------------------------------------
+
+// Cut the drawings of a redrawn line that later ones cover (cr_compact.h)
+// out of a PTY read, before it reaches the ring or any client, so every
+// position handed out keeps naming the same byte. A drawing that began in
+// an earlier read has been sent already and stays. Returns the new length.
+static size_t compact_cr(DaemonSession *s, uint8_t *data, size_t len) {
+    static std::vector<SeqSpan> cuts;
+    cuts.clear();
+    uint64_t seq = session_scrollback_end(s);
+    cr_compact_scan(s->cr, data, len, seq, s->cols, &cuts);
+
+    size_t out = 0;
+    size_t pos = 0;
+    for (const SeqSpan &cut : cuts) {
+        if (cut.first < seq)
+            continue;
+        size_t from = static_cast<size_t>(cut.first - seq);
+        memmove(data + out, data + pos, from - pos);
+        out += from - pos;
+        pos = static_cast<size_t>(cut.second - seq);
+    }
+    if (pos == 0)
+        return len;
+    memmove(data + out, data + pos, len - pos);
+    out += len - pos;
+    cr_compact_shift(s->cr, len - out);
+    return out;
 }
 
 // -------------------------------------------------------------------
@@ -293,7 +1414,7 @@ static void handle_hello(Client *client, const uint8_t *payload, uint32_t len) {
 }
 
 static void handle_create(Client *client, const uint8_t *payload, uint32_t len) {
-    if (static_cast<int>(g_sessions.size()) >= MAX_SESSIONS) {
+    if (g_sessions.size() >= g_max_sessions) {
         queue_error(client, ERR_TOO_MANY_SESSIONS, "max sessions reached");
         return;
     }
@@ -364,10 +1485,34 @@ static void handle_create(Client *client, const uint8_t *payload, uint32_t len)
     uint16_t cols = read_u16_le(payload + pos + 2);
     pos += 4;
 
+    // Optional [4B ring_size] (CAP_RING_SIZE), 0 = daemon default
+    size_t ring_capacity = g_ring_capacity;
+    if (pos + 4 <= len) {
+        size_t requested = read_u32_le(payload + pos);
+        pos += 4;
+        if (requested)
+            ring_capacity = std::min(std::max(requested, MIN_RING_BUFFER_SIZE),
+                                     MAX_RING_BUFFER_SIZE);
+    }
+
     // Create the session
-    DaemonSession *session = session_create(shell.c_str(), args, env,
-                                            cwd.c_str(), rows, cols,
-                                            g_ring_capacity);
+    std::string socket_dir = get_socket_dir();
+    ScrollbackConfig scrollback = {};
+    scrollback.ring_capacity = ring_capacity;
+    scrollback.ring_dir = g_persist_scrollback ? socket_dir.c_str() : nullptr;
+    scrollback.history_limit = g_history_limit;
+    scrollback.spill_dir = g_spill_history ? socket_dir.c_str() : nullptr;
+    scrollback.spill_quota = g_spill_quota;
+    DaemonSession *session;
+    {
+        LatencyScope timing(g_lat_create, "session_create", "session");
+        if (g_synthetic_sessions)
+            session = session_create_synthetic(synthetic_parse_spec(shell.c_str(), args),
+                                               rows, cols, scrollback);
+        else
+            session = session_create(shell.c_str(), args, env, cwd.c_str(),
+                                     rows, cols, scrollback);
+    }
     if (!session) {
         queue_error(client, ERR_SHELL_NOT_FOUND, "failed to create session");
         return;
@@ -380,6 +1525,8 @@ static void handle_create(Client *client, const uint8_t *payload, uint32_t len)
     session->client_fd = client->fd;
     session->detached_at = 0;
     client->attached_sessions.push_back(std::string(session->uuid, SESSION_ID_LEN));
+    enforce_ring_budget();
+    emit_session_event(SESSION_EVENT_CREATED, session);
 
     // Send CREATE_OK: [36B session_id]
     queue_message(client, MSG_CREATE_OK,
@@ -389,6 +1536,42 @@ static void handle_create(Client *client, const uint8_t *payload, uint32_t len)
     LOG_INFO("created session %s for client fd=%d", session->uuid, client->fd);
 }
 
+// Bind a detached session to client, restoring its saved termios.
+static void attach_session(Client *client, DaemonSession *session) {
+    if (session->has_saved_termios) {
+        session->backend->setTermios(session, &session->saved_termios);
+        session->has_saved_termios = false;
+    }
+
+    session->client_fd = client->fd;
+    session->detached_at = 0;
+    client->attached_sessions.push_back(std::string(session->uuid, SESSION_ID_LEN));
+    regrow_ring(session);
+    emit_session_event(SESSION_EVENT_ATTACHED, session);
+}
+
+// Everything a client gets after ATTACH_OK: the replay (via a snapshot fd
+// when asked for and supported), input flow state and exit status.
+static void send_attach_replay(Client *client, DaemonSession *session,
+                               const ReplayPlan &plan, bool via_fd) {
+    via_fd = via_fd && (client->capabilities & CAP_REPLAY_FD);
+    if (!via_fd || !send_replay_fd(session, client, plan))
+        send_replay(session, client, plan);
+
+    // A paste queued before a detach may still be draining
+    if (session->input_flow_paused && !observes_only(client, session))
+        send_input_flow(client, session, true);
+
+    // If session is dead, notify after replay
+    if (!session->alive) {
+        // SESSION_EXITED: [36B session_id][4B exit_code]
+        uint8_t exited[SESSION_ID_LEN + 4];
+        memcpy(exited, session->uuid, SESSION_ID_LEN);
+        write_u32_le(exited + SESSION_ID_LEN, static_cast<uint32_t>(session->exit_code));
+        queue_message(client, MSG_SESSION_EXITED, exited, sizeof(exited));
+    }
+}
+
 static void handle_attach(Client *client, const uint8_t *payload, uint32_t len) {
     if (len < SESSION_ID_LEN) {
         queue_error(client, ERR_PROTOCOL_ERROR, "ATTACH payload too short");
@@ -410,45 +1593,289 @@ static void handle_attach(Client *client, const uint8_t *payload, uint32_t len)
         return;
     }
 
-    if (session->client_fd >= 0) {
-        queue_error(client, ERR_SESSION_BUSY, "session already attached");
-        return;
-    }
-
-    // Restore termios if saved
-    if (session->has_saved_termios && session->master_fd >= 0) {
-        tcsetattr(session->master_fd, TCSANOW, &session->saved_termios);
-        session->has_saved_termios = false;
+    // Optional partial replay: [1B replay_mode][8B value] (CAP_REPLAY_RANGE)
+    // then [1B attach_flags]
+    bool ranged = (client->capabilities & CAP_REPLAY_RANGE) &&
+                  len >= SESSION_ID_LEN + 1 + 8;
+    uint8_t flags = ranged && len >= SESSION_ID_LEN + 1 + 8 + 1
+                        ? payload[SESSION_ID_LEN + 1 + 8] : 0;
+    bool observe = (flags & ATTACH_OBSERVE) && (client->capabilities & CAP_OBSERVE);
+
+    if (observe) {
+        if (!observe_session(client, session)) {
+            queue_error(client, ERR_SESSION_BUSY, "session attached to this client");
+            return;
+        }
+    } else {
+        if (session->client_fd >= 0) {
+            queue_error(client, ERR_SESSION_BUSY, "session already attached");
+            return;
+        }
+        stop_observing(session, client);
+        attach_session(client, session);
     }
 
-    // Attach
-    session->client_fd = client->fd;
-    session->detached_at = 0;
-    client->attached_sessions.push_back(std::string(uuid, SESSION_ID_LEN));
+    ReplayPlan plan;
+    if (ranged)
+        plan_attach_replay(client, session, payload[SESSION_ID_LEN],
+                           read_u64_le(payload + SESSION_ID_LEN + 1), &plan);
+    else
+        plan_attach_replay(client, session, REPLAY_FULL, 0, &plan);
 
     // Send ATTACH_OK: [36B session_id][2B rows][2B cols][4B replay_size]
-    uint8_t resp[SESSION_ID_LEN + 2 + 2 + 4];
+    //                 + [8B start_seq][8B end_seq][8B oldest_seq] if ranged
+    uint8_t resp[SESSION_ID_LEN + 2 + 2 + 4 + 8 + 8 + 8];
     memcpy(resp, uuid, SESSION_ID_LEN);
     write_u16_le(resp + SESSION_ID_LEN, session->rows);
     write_u16_le(resp + SESSION_ID_LEN + 2, session->cols);
-    uint32_t replay_size = static_cast<uint32_t>(session->ring ? session->ring->used() : 0);
+    uint32_t replay_size = static_cast<uint32_t>(std::min<uint64_t>(plan.size(), UINT32_MAX));
     write_u32_le(resp + SESSION_ID_LEN + 4, replay_size);
-    queue_message(client, MSG_ATTACH_OK, resp, sizeof(resp));
+    uint32_t resp_len = SESSION_ID_LEN + 2 + 2 + 4;
+    if (ranged) {
+        write_u64_le(resp + resp_len, plan.start);
+        write_u64_le(resp + resp_len + 8, plan.end);
+        write_u64_le(resp + resp_len + 16, session_scrollback_start(session));
+        resp_len += 8 + 8 + 8;
+    }
+    queue_message(client, MSG_ATTACH_OK, resp, resp_len);
 
-    // Send replay data
-    send_replay(session, client);
+    // Send replay data, through a snapshot fd if asked to (CAP_REPLAY_FD)
+    send_attach_replay(client, session, plan, flags & ATTACH_REPLAY_FD);
 
-    // If session is dead, notify after replay
-    if (!session->alive) {
-        // SESSION_EXITED: [36B session_id][4B exit_code]
-        uint8_t exited[SESSION_ID_LEN + 4];
-        memcpy(exited, uuid, SESSION_ID_LEN);
-        write_u32_le(exited + SESSION_ID_LEN, static_cast<uint32_t>(session->exit_code));
-        queue_message(client, MSG_SESSION_EXITED, exited, sizeof(exited));
+    LOG_INFO("session %s %s client fd=%d", uuid,
+             observe ? "observed by" : "attached to", client->fd);
+    g_last_activity = time(nullptr);
+}
+
+static void handle_attach_many(Client *client, const uint8_t *payload, uint32_t len) {
+    // ATTACH_MANY: [2B count] then per entry
+    //   [36B session_id][1B priority][1B replay_mode][8B value][1B attach_flags]
+    const size_t entry_size = SESSION_ID_LEN + 1 + 1 + 8 + 1;
+    if (len < 2 || len < 2 + read_u16_le(payload) * entry_size) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "ATTACH_MANY payload too short");
+        return;
+    }
+    uint16_t count = read_u16_le(payload);
+
+    struct Entry {
+        const uint8_t *req;
+        DaemonSession *session;
+        uint8_t status;
+        ReplayPlan plan;
+    };
+    std::vector<Entry> entries(count);
+
+    // ATTACH_MANY_OK: [2B count] then per entry, in request order
+    //   [36B session_id][1B status][2B rows][2B cols]
+    //   [8B start_seq][8B end_seq][8B oldest_seq]
+    const size_t reply_entry = SESSION_ID_LEN + 1 + 2 + 2 + 8 + 8 + 8;
+    std::vector<uint8_t> reply(2 + count * reply_entry, 0);
+    write_u16_le(reply.data(), count);
+
+    for (uint16_t i = 0; i < count; i++) {
+        Entry &e = entries[i];
+        e.req = payload + 2 + i * entry_size;
+        e.session = nullptr;
+
+        char uuid[UUID_STR_LEN];
+        memcpy(uuid, e.req, SESSION_ID_LEN);
+        uuid[SESSION_ID_LEN] = '\0';
+        if (!uuid_validate(uuid, SESSION_ID_LEN)) {
+            e.status = ERR_INVALID_SESSION_ID;
+        } else if (!(e.session = find_session(uuid))) {
+            e.status = ERR_SESSION_NOT_FOUND;
+        } else if ((e.req[SESSION_ID_LEN + 10] & ATTACH_OBSERVE) &&
+                   (client->capabilities & CAP_OBSERVE)) {
+            e.status = observe_session(client, e.session) ? 0 : ERR_SESSION_BUSY;
+        } else if (e.session->client_fd >= 0) {
+            e.status = ERR_SESSION_BUSY;
+        } else {
+            e.status = 0;
+            stop_observing(e.session, client);
+            attach_session(client, e.session);
+        }
+        if (e.status != 0) {
+            e.session = nullptr;
+        } else {
+            plan_attach_replay(client, e.session, e.req[SESSION_ID_LEN + 1],
+                               read_u64_le(e.req + SESSION_ID_LEN + 2), &e.plan);
+        }
+
+        uint8_t *r = reply.data() + 2 + i * reply_entry;
+        memcpy(r, e.req, SESSION_ID_LEN); r += SESSION_ID_LEN;
+        *r++ = e.status;
+        if (e.session) {
+            write_u16_le(r, e.session->rows);
+            write_u16_le(r + 2, e.session->cols);
+            write_u64_le(r + 4, e.plan.start);
+            write_u64_le(r + 12, e.plan.end);
+            write_u64_le(r + 20, session_scrollback_start(e.session));
+        }
     }
+    queue_message(client, MSG_ATTACH_MANY_OK, reply.data(), static_cast<uint32_t>(reply.size()));
+
+    // Replays follow in priority order (0 first; request order within a
+    // priority), each ending with its own REPLAY_END
+    std::vector<Entry *> order;
+    for (auto &e : entries)
+        if (e.session) order.push_back(&e);
+    std::stable_sort(order.begin(), order.end(), [](const Entry *a, const Entry *b) {
+        return a->req[SESSION_ID_LEN] < b->req[SESSION_ID_LEN];
+    });
+    for (Entry *e : order)
+        send_attach_replay(client, e->session, e->plan,
+                           e->req[SESSION_ID_LEN + 10] & ATTACH_REPLAY_FD);
+
+    LOG_INFO("attached %zu of %u sessions to client fd=%d", order.size(), count, client->fd);
+    if (!order.empty())
+        g_last_activity = time(nullptr);
+}
 
-    LOG_INFO("session %s attached to client fd=%d", uuid, client->fd);
-    g_last_activity = time(nullptr);
+static void handle_replay_range(Client *client, const uint8_t *payload, uint32_t len) {
+    // REPLAY_RANGE: [36B session_id][1B mode][8B value][8B end_seq][4B max_bytes]
+    char uuid[UUID_STR_LEN];
+    DaemonSession *session = find_session_from_payload(client, payload, len, "REPLAY_RANGE", uuid);
+    if (!session) return;
+    if (len < SESSION_ID_LEN + 1 + 8 + 8 + 4) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "REPLAY_RANGE payload too short");
+        return;
+    }
+
+    const uint8_t *p = payload + SESSION_ID_LEN;
+    uint8_t mode = p[0];
+    if (mode == REPLAY_NONE || mode > REPLAY_FROM_SEQ) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "REPLAY_RANGE: bad mode");
+        return;
+    }
+    uint64_t start, end;
+    resolve_replay_range(session, mode, read_u64_le(p + 1), read_u64_le(p + 9),
+                         read_u32_le(p + 17), &start, &end);
+
+    ReplayWriter writer(client, session->uuid, MSG_RANGE_DATA, start);
+    if (start < end)
+        stream_scrollback(session, start, end, writer);
+
+    // RANGE_END: [36B session_id][8B start_seq][8B end_seq][8B oldest_seq][8B newest_seq]
+    uint8_t resp[SESSION_ID_LEN + 8 * 4];
+    memcpy(resp, session->uuid, SESSION_ID_LEN);
+    write_u64_le(resp + SESSION_ID_LEN, start);
+    write_u64_le(resp + SESSION_ID_LEN + 8, end);
+    write_u64_le(resp + SESSION_ID_LEN + 16, session_scrollback_start(session));
+    write_u64_le(resp + SESSION_ID_LEN + 24, session_scrollback_end(session));
+    queue_message(client, MSG_RANGE_END, resp, sizeof(resp));
+}
+
+static void handle_search(Client *client, const uint8_t *payload, uint32_t len) {
+    // SEARCH: [4B request_id][1B flags][2B context][4B max_matches]
+    //         [36B session_id][2B pattern_len][pattern]
+    const uint32_t fixed = 4 + 1 + 2 + 4 + SESSION_ID_LEN + 2;
+    if (len < fixed) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "SEARCH payload too short");
+        return;
+    }
+    uint16_t pattern_len = read_u16_le(payload + fixed - 2);
+    if (len < fixed + pattern_len) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "SEARCH: bad pattern length");
+        return;
+    }
+    if (client->searching) {
+        queue_error(client, ERR_SESSION_BUSY, "SEARCH already running");
+        return;
+    }
+
+    auto search = std::make_shared<PendingSearch>();
+    search->client_id = client->id;
+    search->request_id = read_u32_le(payload);
+    uint8_t flags = payload[4];
+    search->context = std::min(read_u16_le(payload + 5), SEARCH_MAX_CONTEXT);
+    search->max_matches = std::min(read_u32_le(payload + 7), SEARCH_MAX_MATCHES);
+    if (search->max_matches == 0)
+        search->max_matches = SEARCH_DEFAULT_MATCHES;
+
+    search->matcher = std::make_shared<SearchMatcher>();
+    std::string pattern(reinterpret_cast<const char *>(payload + fixed), pattern_len);
+    std::string error;
+    if (!search->matcher->compile(pattern, flags, &error)) {
+        LOG_DEBUG("SEARCH %u: bad pattern: %s", search->request_id, error.c_str());
+        finish_search(client, *search, SEARCH_BAD_PATTERN);
+        return;
+    }
+
+    if (flags & SEARCH_ALL_SESSIONS) {
+        for (auto *s : g_sessions) {
+            if (s)
+                search->sessions.emplace_back(s->uuid, SESSION_ID_LEN);
+        }
+    } else {
+        char uuid[UUID_STR_LEN];
+        DaemonSession *session = find_session_from_payload(client, payload + 11,
+                                                           SESSION_ID_LEN, "SEARCH", uuid);
+        if (!session) return;
+        search->sessions.emplace_back(session->uuid, SESSION_ID_LEN);
+    }
+
+    client->searching = true;
+    if (!start_next_search(search))
+        finish_search(client, *search, SEARCH_COMPLETE);
+}
+
+static void handle_set_triggers(Client *client, const uint8_t *payload, uint32_t len) {
+    // SET_TRIGGERS: [36B session_id][2B count] then per trigger
+    //               [4B trigger_id][1B flags][2B pattern_len][pattern]
+    char uuid[UUID_STR_LEN];
+    DaemonSession *session = find_session_from_payload(client, payload, len,
+                                                       "SET_TRIGGERS", uuid);
+    if (!session) return;
+    if (len < SESSION_ID_LEN + 2) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "SET_TRIGGERS payload too short");
+        return;
+    }
+
+    uint16_t count = read_u16_le(payload + SESSION_ID_LEN);
+    size_t off = SESSION_ID_LEN + 2;
+    std::vector<TriggerSpec> specs;
+    specs.reserve(std::min<size_t>(count, TRIGGER_MAX_COUNT + 1));
+    for (uint16_t i = 0; i < count; i++) {
+        const char *pattern;
+        uint16_t pattern_len;
+        size_t consumed;
+        if (len - off < 5 ||
+            !read_string(payload + off + 5, len - off - 5, &pattern, &pattern_len, &consumed)) {
+            queue_error(client, ERR_PROTOCOL_ERROR, "SET_TRIGGERS entry truncated");
+            return;
+        }
+        specs.push_back({read_u32_le(payload + off), payload[off + 4],
+                         std::string(pattern, pattern_len)});
+        off += 5 + consumed;
+    }
+
+    // SET_TRIGGERS_OK: [36B session_id][1B status][2B index]
+    uint8_t resp[SESSION_ID_LEN + 1 + 2];
+    memcpy(resp, session->uuid, SESSION_ID_LEN);
+    resp[SESSION_ID_LEN] = TRIGGERS_OK;
+    write_u16_le(resp + SESSION_ID_LEN + 1, 0);
+
+    TriggerMatcher *matcher = nullptr;
+    if (!specs.empty()) {
+        matcher = new TriggerMatcher();
+        size_t bad_index = 0;
+        std::string error;
+        uint8_t status = matcher->compile(specs, &bad_index, &error);
+        if (status != TRIGGERS_OK) {
+            LOG_DEBUG("session %s: trigger %zu rejected: %s", uuid, bad_index, error.c_str());
+            delete matcher;
+            resp[SESSION_ID_LEN] = status;
+            write_u16_le(resp + SESSION_ID_LEN + 1, static_cast<uint16_t>(bad_index));
+            queue_message(client, MSG_SET_TRIGGERS_OK, resp, sizeof(resp));
+            return;
+        }
+    }
+
+    delete session->triggers;
+    session->triggers = matcher;
+    session->trigger_client_id = matcher ? client->id : 0;
+    LOG_INFO("session %s: %zu trigger(s) set by client fd=%d", uuid, specs.size(), client->fd);
+    queue_message(client, MSG_SET_TRIGGERS_OK, resp, sizeof(resp));
 }
 
 static void handle_detach(Client *client, const uint8_t *payload, uint32_t len) {
@@ -456,7 +1883,10 @@ static void handle_detach(Client *client, const uint8_t *payload, uint32_t len)
     DaemonSession *session = find_session_from_payload(client, payload, len, "DETACH", uuid);
     if (!session) return;
 
-    detach_session_from_client(session, client);
+    if (observes_only(client, session))
+        stop_observing(session, client);
+    else
+        detach_session_from_client(session, client);
     queue_message(client, MSG_DETACH_OK, nullptr, 0);
 }
 
@@ -464,6 +1894,10 @@ static void handle_destroy(Client *client, const uint8_t *payload, uint32_t len)
     char uuid[UUID_STR_LEN];
     DaemonSession *session = find_session_from_payload(client, payload, len, "DESTROY", uuid);
     if (!session) return;
+    if (observes_only(client, session)) {
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
+        return;
+    }
 
     // Detach from its actual attached client (may differ from requesting client)
     if (session->client_fd >= 0) {
@@ -473,17 +1907,13 @@ static void handle_destroy(Client *client, const uint8_t *payload, uint32_t len)
     }
 
     // Kill the shell and mark dead so session_destroy doesn't double-kill
-    if (session->alive && session->shell_pid > 0) {
-        kill(session->shell_pid, SIGHUP);
-        usleep(100000);
-        int status;
-        pid_t r = waitpid(session->shell_pid, &status, WNOHANG);
-        if (r == 0) {
-            kill(session->shell_pid, SIGKILL);
-            waitpid(session->shell_pid, &status, 0);
-        }
-        session->alive = false;
+    if (session->alive) {
+        LatencyScope timing(g_lat_destroy_kill, "destroy_kill", "session");
+        session->backend->terminate(session);
     }
+    // Observers learn the session is gone the same way as on an exit
+    if (!session->observers.empty())
+        notify_session_exited(session);
 
     remove_session(session);
     session_destroy(session);
@@ -497,6 +1927,10 @@ static void handle_resize(Client *client, const uint8_t *payload, uint32_t len)
     char uuid[UUID_STR_LEN];
     DaemonSession *session = find_session_from_payload(client, payload, len, "RESIZE", uuid);
     if (!session) return;
+    if (observes_only(client, session)) {
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
+        return;
+    }
     if (len < SESSION_ID_LEN + 4) {
         queue_error(client, ERR_PROTOCOL_ERROR, "RESIZE payload too short");
         return;
@@ -505,28 +1939,52 @@ static void handle_resize(Client *client, const uint8_t *payload, uint32_t len)
     uint16_t rows = read_u16_le(payload + SESSION_ID_LEN);
     uint16_t cols = read_u16_le(payload + SESSION_ID_LEN + 2);
 
+    // rows/cols update now for LIST; the PTY only sees the last of a burst
+    if (rows != session->rows || cols != session->cols)
+        emit_session_event(SESSION_EVENT_RESIZED, session, payload + SESSION_ID_LEN, 4);
     session->rows = rows;
     session->cols = cols;
-
-    if (session->master_fd >= 0) {
-        struct winsize ws = {};
-        ws.ws_row = rows;
-        ws.ws_col = cols;
-        ioctl(session->master_fd, TIOCSWINSZ, &ws);
-
-        // Send SIGWINCH to shell process group
-        if (session->alive && session->shell_pid > 0)
-            kill(-session->shell_pid, SIGWINCH);
+    boost_session(session);
+    if (g_resize_debounce_ms == 0) {
+        session->backend->resize(session);
+    } else {
+        if (!session->resize_due_ns)
+            g_resizes_pending++;
+        session->resize_due_ns = monotonic_ns() +
+            static_cast<uint64_t>(g_resize_debounce_ms) * 1000000ull;
     }
 
     LOG_DEBUG("session %s resized to %dx%d", uuid, cols, rows);
 }
 
+// Apply coalesced resizes that are due. Returns the poll timeout, shortened
+// so the next pending one isn't applied late.
+static int apply_due_resizes(int timeout_ms) {
+    uint64_t now = monotonic_ns();
+    for (auto *s : g_sessions) {
+        if (!s || !s->resize_due_ns)
+            continue;
+        if (s->resize_due_ns <= now) {
+            s->resize_due_ns = 0;
+            g_resizes_pending--;
+            s->backend->resize(s);
+            continue;
+        }
+        int wait_ms = static_cast<int>((s->resize_due_ns - now + 999999) / 1000000);
+        timeout_ms = std::min(timeout_ms, wait_ms);
+    }
+    return timeout_ms;
+}
+
 static void handle_input(Client *client, const uint8_t *payload, uint32_t len) {
     // INPUT: [36B session_id][raw_bytes...]
     char uuid[UUID_STR_LEN];
     DaemonSession *session = find_session_from_payload(client, payload, len, "INPUT", uuid);
     if (!session) return;
+    if (observes_only(client, session)) {
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
+        return;
+    }
 
     if (!session->alive || session->master_fd < 0)
         return;
@@ -534,30 +1992,55 @@ static void handle_input(Client *client, const uint8_t *payload, uint32_t len) {
     const uint8_t *data = payload + SESSION_ID_LEN;
     uint32_t data_len = len - SESSION_ID_LEN;
 
-    // Write to PTY master
-    size_t written = 0;
-    while (written < data_len) {
-        ssize_t n = write(session->master_fd,
-                          data + written,
-                          data_len - written);
-        if (n > 0) {
-            written += static_cast<size_t>(n);
-        } else if (n < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
-                break;
-            if (errno == EINTR)
-                continue;
-            LOG_ERROR("write to PTY master fd=%d failed: %s",
-                      session->master_fd, strerror(errno));
-            break;
+    boost_session(session);
+    write_pty_input(session, data, data_len);
+}
+
+static void handle_input_multi(Client *client, const uint8_t *payload, uint32_t len) {
+    // INPUT_MULTI: [2B count][count x 36B session_id][raw_bytes...]
+    if (len < 2 || len < 2 + read_u16_le(payload) * SESSION_ID_LEN) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "INPUT_MULTI payload too short");
+        return;
+    }
+    uint16_t count = read_u16_le(payload);
+    const uint8_t *ids = payload + 2;
+    const uint8_t *data = ids + count * SESSION_ID_LEN;
+    size_t data_len = len - 2 - count * SESSION_ID_LEN;
+
+    bool missing = false;
+    bool denied = false;
+    for (uint16_t i = 0; i < count; i++) {
+        char uuid[UUID_STR_LEN];
+        memcpy(uuid, ids + i * SESSION_ID_LEN, SESSION_ID_LEN);
+        uuid[SESSION_ID_LEN] = '\0';
+        DaemonSession *session = find_session(uuid);
+        if (!session) {
+            missing = true;
+            continue;
+        }
+        if (observes_only(client, session)) {
+            denied = true;
+            continue;
         }
+        if (!session->alive || session->master_fd < 0)
+            continue;
+        boost_session(session);
+        write_pty_input(session, data, data_len);
     }
+    // One error per message, however many ids were stale
+    if (missing)
+        queue_error(client, ERR_SESSION_NOT_FOUND, "session not found");
+    if (denied)
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
 }
 
 static void handle_list(Client *client) {
     // LIST_OK: [2B count] then per session:
     //   [36B id][1B alive][2B rows][2B cols][2B shell_len][shell]
     //   [2B cwd_len][cwd][8B created_at][8B detached_at][1B has_client]
+    //   [2B ext_len][ext...] (CAP_LIST_EXTENDED only, see protocol.h)
+    //   then [8B session_version] (CAP_SESSION_EVENTS only)
+    bool extended = (client->capabilities & CAP_LIST_EXTENDED) != 0;
     std::vector<uint8_t> payload;
 
     // Count non-null sessions (g_sessions may contain gaps after removal)
@@ -569,38 +2052,148 @@ static void handle_list(Client *client) {
     write_u16_le(payload.data(), count);
 
     for (auto *s : g_sessions) {
-        if (!s) continue;
-
+        if (s)
+            append_list_entry(payload, s, extended);
+    }
+    if (client->capabilities & CAP_SESSION_EVENTS) {
         size_t base = payload.size();
-        size_t shell_len = strlen(s->shell);
-        size_t cwd_len = strlen(s->cwd);
-        size_t entry_size = SESSION_ID_LEN + 1 + 2 + 2 +
-                            2 + shell_len + 2 + cwd_len +
-                            8 + 8 + 1;
-        payload.resize(base + entry_size);
-        uint8_t *p = payload.data() + base;
-
-        memcpy(p, s->uuid, SESSION_ID_LEN);
-        p += SESSION_ID_LEN;
-
-        *p++ = s->alive ? 1 : 0;
+        payload.resize(base + 8);
+        write_u64_le(payload.data() + base, g_session_version);
+    }
 
-        write_u16_le(p, s->rows); p += 2;
-        write_u16_le(p, s->cols); p += 2;
+    queue_message(client, MSG_LIST_OK, payload.data(),
+                  static_cast<uint32_t>(payload.size()));
+}
 
-        write_u16_le(p, static_cast<uint16_t>(shell_len)); p += 2;
-        memcpy(p, s->shell, shell_len); p += shell_len;
+// Resident set size of this process in bytes (0 if unavailable).
+static uint64_t process_rss_bytes() {
+#ifdef __APPLE__
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+#else
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    unsigned long long size = 0, resident = 0;
+    int fields = fscanf(f, "%llu %llu", &size, &resident);
+    fclose(f);
+    if (fields != 2)
+        return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
 
-        write_u16_le(p, static_cast<uint16_t>(cwd_len)); p += 2;
-        memcpy(p, s->cwd, cwd_len); p += cwd_len;
+static void handle_stats(Client *client) {
+    // STATS_OK layout: see protocol.h
+    std::vector<uint8_t> payload;
+    auto append = [&payload](size_t n) {
+        size_t at = payload.size();
+        payload.resize(at + n);
+        return payload.data() + at;
+    };
+    uint64_t now = monotonic_ns();
+
+    size_t session_count = 0;
+    for (auto *s : g_sessions)
+        if (s) session_count++;
+    size_t client_count = 0;
+    for (auto *c : g_clients)
+        if (c) client_count++;
+
+    // Daemon
+    const uint16_t daemon_len = 8 + 8 + 8 + 4 + 4 + 8 + 8 + 8;
+    uint8_t *p = append(2 + daemon_len);
+    write_u16_le(p, daemon_len); p += 2;
+    write_u64_le(p, (now - g_started_at_ns) / 1000000); p += 8;
+    write_u64_le(p, g_loop_iterations); p += 8;
+    write_u64_le(p, process_rss_bytes()); p += 8;
+    write_u32_le(p, static_cast<uint32_t>(session_count)); p += 4;
+    write_u32_le(p, static_cast<uint32_t>(client_count)); p += 4;
+    write_u64_le(p, SpillStore::globalDiskBytes()); p += 8;
+    write_u64_le(p, ring_bytes_total()); p += 8;
+    write_u64_le(p, g_ring_budget);
+
+    // Sessions
+    write_u16_le(append(2), static_cast<uint16_t>(session_count));
+    for (auto *s : g_sessions) {
+        if (!s) continue;
+        const uint16_t len = SESSION_ID_LEN + 8 * 5 + 4 + 8 + 8 + 8;
+        p = append(2 + len);
+        write_u16_le(p, len); p += 2;
+        memcpy(p, s->uuid, SESSION_ID_LEN); p += SESSION_ID_LEN;
+        write_u64_le(p, s->pty_bytes_read); p += 8;
+        write_u64_le(p, s->pty_bytes_written); p += 8;
+        write_u64_le(p, s->ring ? s->ring->used() : 0); p += 8;
+        write_u64_le(p, s->ring ? s->ring->capacity() : 0); p += 8;
+        write_u64_le(p, s->ring ? s->ring->overwritten() : 0); p += 8;
+        write_u32_le(p, s->flow_pauses); p += 4;
+        uint64_t paused = s->flow_paused_ns;
+        if (s->flow_paused)
+            paused += now - s->flow_paused_since;
+        write_u64_le(p, paused / 1000000); p += 8;
+        write_u64_le(p, input_queued(s)); p += 8;
+        write_u64_le(p, s->cr.removed);
+    }
 
-        write_u64_le(p, static_cast<uint64_t>(s->created_at)); p += 8;
-        write_u64_le(p, static_cast<uint64_t>(s->detached_at)); p += 8;
+    // Clients
+    write_u16_le(append(2), static_cast<uint16_t>(client_count));
+    for (auto *c : g_clients) {
+        if (!c) continue;
+        uint8_t types = 0;
+        for (size_t t = 0; t < MSG_TYPE_SLOTS; t++)
+            if (c->msg_counts[t]) types++;
+        const uint16_t len = 4 + 4 + 8 * 4 + 4 + 1 + types * 9;
+        p = append(2 + len);
+        write_u16_le(p, len); p += 2;
+        write_u32_le(p, static_cast<uint32_t>(c->fd)); p += 4;
+        write_u32_le(p, static_cast<uint32_t>(c->peer_pid)); p += 4;
+        write_u64_le(p, c->bytes_in); p += 8;
+        write_u64_le(p, c->bytes_out); p += 8;
+        write_u64_le(p, send_queued(c)); p += 8;
+        write_u64_le(p, c->send_buf_high_water); p += 8;
+        write_u32_le(p, c->congestion_events); p += 4;
+        *p++ = types;
+        for (size_t t = 0; t < MSG_TYPE_SLOTS; t++) {
+            if (!c->msg_counts[t]) continue;
+            *p++ = static_cast<uint8_t>(t);
+            write_u64_le(p, c->msg_counts[t]); p += 8;
+        }
+    }
 
-        *p++ = (s->client_fd >= 0) ? 1 : 0;
+    // Latency
+    struct LatencyEntry { uint8_t kind; uint8_t type; const LatencyHistogram *hist; };
+    std::vector<LatencyEntry> latencies = {
+        {LATENCY_POLL_WAIT, 0, &g_lat_poll_wait},
+        {LATENCY_LOOP_WORK, 0, &g_lat_loop_work},
+        {LATENCY_OUTPUT, 0, &g_lat_output},
+        {LATENCY_REPLAY, 0, &g_lat_replay},
+        {LATENCY_SESSION_CREATE, 0, &g_lat_create},
+        {LATENCY_DESTROY_KILL, 0, &g_lat_destroy_kill},
+        {LATENCY_INTERACTIVE, 0, &g_lat_interactive},
+    };
+    for (size_t t = 0; t < MSG_TYPE_SLOTS; t++)
+        if (g_lat_handlers[t])
+            latencies.push_back({LATENCY_HANDLER, static_cast<uint8_t>(t), g_lat_handlers[t].get()});
+    write_u16_le(append(2), static_cast<uint16_t>(latencies.size()));
+    for (const auto &e : latencies) {
+        const uint16_t len = 1 + 1 + 8 * 6;
+        p = append(2 + len);
+        write_u16_le(p, len); p += 2;
+        *p++ = e.kind;
+        *p++ = e.type;
+        write_u64_le(p, e.hist->count()); p += 8;
+        write_u64_le(p, e.hist->percentile(50)); p += 8;
+        write_u64_le(p, e.hist->percentile(90)); p += 8;
+        write_u64_le(p, e.hist->percentile(99)); p += 8;
+        write_u64_le(p, e.hist->percentile(99.9)); p += 8;
+        write_u64_le(p, e.hist->max());
     }
 
-    queue_message(client, MSG_LIST_OK, payload.data(),
+    queue_message(client, MSG_STATS_OK, payload.data(),
                   static_cast<uint32_t>(payload.size()));
 }
 
@@ -609,6 +2202,10 @@ static void handle_send_signal(Client *client, const uint8_t *payload, uint32_t
     char uuid[UUID_STR_LEN];
     DaemonSession *session = find_session_from_payload(client, payload, len, "SEND_SIGNAL", uuid);
     if (!session) return;
+    if (observes_only(client, session)) {
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
+        return;
+    }
     if (len < SESSION_ID_LEN + 4) {
         queue_error(client, ERR_PROTOCOL_ERROR, "SEND_SIGNAL payload too short");
         return;
@@ -621,10 +2218,13 @@ static void handle_send_signal(Client *client, const uint8_t *payload, uint32_t
         return;
     }
 
-    if (session->alive && session->shell_pid > 0) {
-        kill(session->shell_pid, static_cast<int>(sig));
+    if (session->alive) {
+        boost_session(session);
+        session->backend->signal(session, static_cast<int>(sig));
         LOG_DEBUG("sent signal %u to session %s (pid %d)",
                   sig, uuid, session->shell_pid);
+        if (!session->alive)
+            notify_session_exited(session);
     }
 
     // SIGNAL_OK: [36B session_id]
@@ -638,16 +2238,17 @@ static void handle_set_termios(Client *client, const uint8_t *payload, uint32_t
     char uuid[UUID_STR_LEN];
     DaemonSession *session = find_session_from_payload(client, payload, len, "SET_TERMIOS", uuid);
     if (!session) return;
+    if (observes_only(client, session)) {
+        queue_error(client, ERR_PERMISSION_DENIED, "session is observed read-only");
+        return;
+    }
     if (len < SESSION_ID_LEN + 19) {
         queue_error(client, ERR_PROTOCOL_ERROR, "SET_TERMIOS payload too short");
         return;
     }
 
-    if (session->master_fd < 0)
-        return;
-
     struct termios tio;
-    if (tcgetattr(session->master_fd, &tio) != 0)
+    if (!session->backend->getTermios(session, &tio))
         return;
 
     size_t p = SESSION_ID_LEN;
@@ -676,10 +2277,32 @@ static void handle_set_termios(Client *client, const uint8_t *payload, uint32_t
     (void)utf8_mode;
 #endif
 
-    tcsetattr(session->master_fd, TCSANOW, &tio);
+    session->backend->setTermios(session, &tio);
     LOG_DEBUG("set termios for session %s", uuid);
 }
 
+static void handle_subscribe(Client *client, const uint8_t *payload, uint32_t len) {
+    // SUBSCRIBE: [1B events][4B quiet_ms]
+    if (len < 5) {
+        queue_error(client, ERR_PROTOCOL_ERROR, "SUBSCRIBE payload too short");
+        return;
+    }
+    uint32_t quiet_ms = read_u32_le(payload + 1);
+    if (quiet_ms == 0)
+        quiet_ms = ACTIVITY_DEFAULT_QUIET_MS;
+    client->subscriptions = payload[0] & (SUBSCRIBE_ACTIVITY | SUBSCRIBE_SESSIONS);
+    client->quiet_ms = std::max(quiet_ms, ACTIVITY_MIN_QUIET_MS);
+    // Sessions already quiet are not news
+    client->silence_checked_ns = monotonic_ns();
+
+    // SUBSCRIBE_OK: [1B events][4B quiet_ms][8B session_version]
+    uint8_t resp[1 + 4 + 8];
+    resp[0] = client->subscriptions;
+    write_u32_le(resp + 1, client->quiet_ms);
+    write_u64_le(resp + 5, g_session_version);
+    queue_message(client, MSG_SUBSCRIBE_OK, resp, sizeof(resp));
+}
+
 static void handle_ping(Client *client, const uint8_t *payload, uint32_t len) {
     // PING: [8B timestamp] -> PONG: [8B timestamp]
     if (len < 8) {
@@ -695,9 +2318,7 @@ static void handle_fg_process_query(Client *client, const uint8_t *payload, uint
     DaemonSession *session = find_session_from_payload(client, payload, len, "FG_PROCESS_QUERY", uuid);
     if (!session) return;
 
-    pid_t fg_pid = 0;
-    if (session->master_fd >= 0)
-        fg_pid = tcgetpgrp(session->master_fd);
+    pid_t fg_pid = session->backend->foregroundPid(session);
 
     // FG_PROCESS_INFO: [36B session_id][4B pid][2B name_len][name][2B cwd_len][cwd]
     // We send just PID — the client does the /proc lookup
@@ -715,8 +2336,18 @@ static void handle_fg_process_query(Client *client, const uint8_t *payload, uint
 // Message dispatcher
 // -------------------------------------------------------------------
 
+static LatencyHistogram &handler_histogram(uint8_t type) {
+    // Types past the per-type slots share slot 0, which no message uses
+    size_t slot = type < MSG_TYPE_SLOTS ? type : 0;
+    if (!g_lat_handlers[slot])
+        g_lat_handlers[slot].reset(new LatencyHistogram());
+    return *g_lat_handlers[slot];
+}
+
 static void handle_message(Client *client, uint8_t type,
                            const uint8_t *payload, uint32_t len) {
+    const char *name = message_type_name(type);
+    LatencyScope timing(handler_histogram(type), name ? name : "unknown", "handler");
     client->last_message_at = time(nullptr);
     g_last_activity = time(nullptr);
 
@@ -730,10 +2361,17 @@ static void handle_message(Client *client, uint8_t type,
     case MSG_HELLO:             handle_hello(client, payload, len); break;
     case MSG_CREATE:            handle_create(client, payload, len); break;
     case MSG_ATTACH:            handle_attach(client, payload, len); break;
+    case MSG_ATTACH_MANY:       handle_attach_many(client, payload, len); break;
+    case MSG_REPLAY_RANGE:      handle_replay_range(client, payload, len); break;
+    case MSG_SEARCH:            handle_search(client, payload, len); break;
+    case MSG_STATS:             handle_stats(client); break;
     case MSG_DETACH:            handle_detach(client, payload, len); break;
     case MSG_DESTROY:           handle_destroy(client, payload, len); break;
     case MSG_RESIZE:            handle_resize(client, payload, len); break;
     case MSG_INPUT:             handle_input(client, payload, len); break;
+    case MSG_INPUT_MULTI:       handle_input_multi(client, payload, len); break;
+    case MSG_SET_TRIGGERS:      handle_set_triggers(client, payload, len); break;
+    case MSG_SUBSCRIBE:         handle_subscribe(client, payload, len); break;
     case MSG_LIST:              handle_list(client); break;
     case MSG_SEND_SIGNAL:       handle_send_signal(client, payload, len); break;
     case MSG_SET_TERMIOS:       handle_set_termios(client, payload, len); break;
@@ -763,6 +2401,8 @@ static void process_client_messages(Client *client) {
             break;
         }
 
+        if (msg.type < MSG_TYPE_SLOTS)
+            client->msg_counts[msg.type]++;
         handle_message(client, msg.type, msg.payload, msg.payload_len);
 
         // Remove consumed message from recv_buf
@@ -780,6 +2420,8 @@ static void remove_client_at(size_t &i) {
     Client *c = g_clients[i];
     LOG_INFO("removing client fd=%d", c->fd);
     detach_all_client_sessions(c);
+    stop_all_observing(c);
+    drop_client_triggers(c);
     close_client(c);
     g_clients.erase(g_clients.begin() + static_cast<ptrdiff_t>(i));
     i--;
@@ -799,16 +2441,8 @@ static void reap_children() {
 
         // Check if we need to notify an attached client
         for (auto *s : g_sessions) {
-            if (s && s->shell_pid == pid && !s->alive && s->client_fd >= 0) {
-                Client *c = find_client_for_session(s);
-                if (c) {
-                    uint8_t exited[SESSION_ID_LEN + 4];
-                    memcpy(exited, s->uuid, SESSION_ID_LEN);
-                    write_u32_le(exited + SESSION_ID_LEN,
-                                 static_cast<uint32_t>(s->exit_code));
-                    queue_message(c, MSG_SESSION_EXITED, exited, sizeof(exited));
-                }
-            }
+            if (s && s->shell_pid == pid && !s->alive)
+                notify_session_exited(s);
         }
     }
 }
@@ -832,7 +2466,7 @@ static void poll_fg_processes() {
         if (!s || !s->alive || s->master_fd < 0 || s->client_fd < 0)
             continue;
 
-        pid_t fg_pid = tcgetpgrp(s->master_fd);
+        pid_t fg_pid = s->backend->foregroundPid(s);
         if (fg_pid <= 0 || fg_pid == s->cached_fg_pid)
             continue;
 
@@ -856,9 +2490,9 @@ static void check_timeouts() {
     time_t now = time(nullptr);
 
     // Check orphaned sessions (detached > ORPHAN_TIMEOUT_SECS)
-    for (auto it = g_sessions.begin(); it != g_sessions.end(); ) {
-        DaemonSession *s = *it;
-        if (!s) { ++it; continue; }
+    std::vector<DaemonSession *> expired;
+    for (auto *s : g_sessions) {
+        if (!s) continue;
 
         bool should_destroy = false;
 
@@ -870,29 +2504,36 @@ static void check_timeouts() {
             should_destroy = true;
         }
 
-        // Dead session past keep time (detached and dead)
+        // Dead session past keep time (detached and dead). Recovered sessions
+        // get longer so a relaunched app has time to reattach them.
+        int keep_secs = s->recovered ? RECOVERED_SESSION_KEEP_SECS
+                                     : DEAD_SESSION_KEEP_SECS;
         if (!s->alive && s->client_fd < 0 &&
             s->detached_at > 0 &&
-            (now - s->detached_at) > DEAD_SESSION_KEEP_SECS) {
+            (now - s->detached_at) > keep_secs) {
             LOG_INFO("cleaning up dead session %s", s->uuid);
             should_destroy = true;
         }
 
-        if (should_destroy) {
-            it = g_sessions.erase(it);
-            session_destroy(s);
-        } else {
-            ++it;
-        }
+        if (should_destroy)
+            expired.push_back(s);
+    }
+    for (auto *s : expired) {
+        remove_session(s);
+        session_destroy(s);
     }
 
     // Check client heartbeat timeout
     for (auto it = g_clients.begin(); it != g_clients.end(); ) {
         Client *c = *it;
+        // A client held back by input flow control can't get its PINGs through
         if (c && c->authenticated &&
-            (now - c->last_message_at) > CLIENT_HEARTBEAT_TIMEOUT_SECS) {
+            (now - c->last_message_at) > CLIENT_HEARTBEAT_TIMEOUT_SECS &&
+            !client_input_blocked(c)) {
             LOG_WARN("client fd=%d heartbeat timeout, detaching sessions", c->fd);
             detach_all_client_sessions(c);
+            stop_all_observing(c);
+            drop_client_triggers(c);
             close_client(c);
             it = g_clients.erase(it);
         } else {
@@ -919,13 +2560,120 @@ static bool check_idle_timeout() {
 // Main event loop
 // -------------------------------------------------------------------
 
+// Record PTY-read-to-socket latency once a client's queued output is gone
+static void note_output_flushed(Client *client) {
+    if (client->output_pending_since && send_queued(client) == 0) {
+        g_lat_output.record(monotonic_ns() - client->output_pending_since);
+        client->output_pending_since = 0;
+    }
+    if (client->interactive_pending_since && send_queued(client) == 0) {
+        g_lat_interactive.record(monotonic_ns() - client->interactive_pending_since);
+        client->interactive_pending_since = 0;
+    }
+}
+
+// Service one PTY master after poll(): write queued input, read output
+// into the ring and forward it to the attached client.
+static void service_pty(DaemonSession *s, short revents, bool boosted) {
+    if ((revents & POLLOUT) && s->alive && s->master_fd >= 0)
+        drain_input_queue(s);
+
+    if (revents & POLLIN) {
+        uint8_t buf[8192];
+        uint64_t read_at = monotonic_ns();
+        ssize_t n = read(s->master_fd, buf, sizeof(buf));
+        if (n > 0) {
+            s->pty_bytes_read += static_cast<uint64_t>(n);
+            if (g_compact_cr)
+                n = static_cast<ssize_t>(compact_cr(s, buf, static_cast<size_t>(n)));
+
+            // Write to ring buffer
+            s->ring->write(buf, static_cast<size_t>(n));
+            uint64_t seq = session_scrollback_end(s) - static_cast<uint64_t>(n);
+            note_output(s, buf, static_cast<size_t>(n), read_at);
+            screen_marks_scan(s->screen, buf, static_cast<size_t>(n), seq);
+            unsigned osc = osc_scan(s->osc, buf, static_cast<size_t>(n));
+            if (osc & OSC_TITLE_CHANGED)
+                emit_session_string_event(SESSION_EVENT_TITLE, s, s->osc.title);
+            if (osc & OSC_CWD_CHANGED)
+                emit_session_string_event(SESSION_EVENT_CWD, s, s->osc.cwd);
+            if (s->triggers)
+                run_triggers(s, buf, static_cast<size_t>(n));
+
+            // Forward to the attached client and any observers, all
+            // sharing one OUTPUT frame: [36B session_id][data...]
+            if (s->client_fd >= 0 || !s->observers.empty()) {
+                SharedFrame frame = make_shared_frame(
+                    MSG_OUTPUT, reinterpret_cast<const uint8_t *>(s->uuid), SESSION_ID_LEN,
+                    buf, static_cast<uint32_t>(n));
+                Client *c = s->client_fd >= 0 ? find_client_for_session(s) : nullptr;
+                if (c) {
+                    queue_shared_frame(c, frame);
+                    if (!c->output_pending_since)
+                        c->output_pending_since = read_at;
+                    if (boosted && !c->interactive_pending_since)
+                        c->interactive_pending_since = read_at;
+
+                    // Try to flush immediately
+                    if (!flush_send_buf(c)) {
+                        LOG_ERROR("flush failed for client fd=%d (output)", c->fd);
+                    }
+                    note_output_flushed(c);
+                    // Flow control: if client is congested, pause this session
+                    if (c->congested)
+                        set_flow_paused(s, true);
+                }
+                if (!s->observers.empty())
+                    broadcast_to_observers(s, frame, seq);
+            }
+        } else if (n < 0 && errno != EAGAIN && errno != EIO) {
+            LOG_DEBUG("read from PTY master fd=%d: %s",
+                      s->master_fd, strerror(errno));
+        }
+        // EIO on PTY master means shell exited — SIGCHLD will handle it
+    }
+
+    if (revents & (POLLERR | POLLHUP)) {
+        // PTY closed — shell probably exited, SIGCHLD will handle cleanup
+        LOG_DEBUG("PTY master fd=%d got POLLHUP/POLLERR", s->master_fd);
+    }
+}
+
+static void start_trace() {
+    char name[64];
+    snprintf(name, sizeof(name), "/trace-%d-%ld.json",
+             static_cast<int>(getpid()), static_cast<long>(time(nullptr)));
+    std::string path = get_socket_dir() + name;
+    if (trace_start(path, static_cast<uint64_t>(g_trace_seconds) * 1000000000ull))
+        LOG_INFO("tracing for %us to %s", g_trace_seconds, path.c_str());
+}
+
 void event_loop_run(int listen_fd) {
     g_last_activity = time(nullptr);
+    g_started_at_ns = monotonic_ns();
+    if (g_trace_seconds)
+        start_trace();
+
+    if (g_persist_scrollback)
+        recover_persisted_sessions();
+    SpillStore::removeStale(get_socket_dir());
+
+    if (g_ring_budget) {
+        enforce_ring_budget();
+        g_psi_fd = open_memory_pressure_trigger();
+    }
+
     LOG_INFO("entering event loop");
 
     while (!g_shutdown_requested) {
+        int timeout_ms = POLL_TIMEOUT_MS;
+        if (g_resizes_pending)
+            timeout_ms = apply_due_resizes(timeout_ms);
+        timeout_ms = check_silence(timeout_ms);
+
         // Build poll array
-        // [0] = signal pipe, [1] = listen fd, [2..N] = clients, [N+1..M] = PTY masters
+        // [0] = signal pipe, [1] = listen fd, [2] = PSI trigger (if armed),
+        // then clients, then PTY masters
         std::vector<struct pollfd> fds;
 
         // Signal pipe
@@ -940,33 +2688,83 @@ void event_loop_run(int listen_fd) {
         listen_pfd.events = POLLIN;
         fds.push_back(listen_pfd);
 
+        // Memory pressure trigger
+        size_t psi_idx = 0;
+        if (g_psi_fd >= 0) {
+            struct pollfd psi_pfd = {};
+            psi_pfd.fd = g_psi_fd;
+            psi_pfd.events = POLLPRI;
+            psi_idx = fds.size();
+            fds.push_back(psi_pfd);
+        }
+
+        // Clients whose sessions hit INPUT_QUEUE_MAX aren't read until they drain
+        std::vector<int> input_blocked_fds;
+        for (auto *s : g_sessions) {
+            if (s && s->client_fd >= 0 && input_queued(s) >= INPUT_QUEUE_MAX)
+                input_blocked_fds.push_back(s->client_fd);
+        }
+
         // Client fds
         size_t client_start = fds.size();
         for (auto *c : g_clients) {
             struct pollfd cpfd = {};
             cpfd.fd = c->fd;
-            cpfd.events = POLLIN;
-            if (!c->send_buf.empty())
+            if (std::find(input_blocked_fds.begin(), input_blocked_fds.end(), c->fd) ==
+                input_blocked_fds.end())
+                cpfd.events = POLLIN;
+            if (send_queued(c) > 0)
                 cpfd.events |= POLLOUT;
             fds.push_back(cpfd);
         }
 
-        // PTY master fds for all alive sessions (attached non-congested + detached)
+        // While a boosted session's output is still queued for its client,
+        // don't read more bulk output destined for the same socket
+        std::vector<int> deferred_client_fds;
+        uint64_t poll_build_ns = monotonic_ns();
+        if (g_boost_until_ns > poll_build_ns) {
+            for (auto *c : g_clients) {
+                if (!c || send_queued(c) == 0) continue;
+                for (auto *s : g_sessions) {
+                    if (s && s->client_fd == c->fd && s->boost_until_ns > poll_build_ns) {
+                        deferred_client_fds.push_back(c->fd);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // PTY master fds for all alive sessions: read unless the attached
+        // client is congested, write while input is queued
         std::vector<DaemonSession *> pty_sessions;
         size_t pty_start = fds.size();
         for (auto *s : g_sessions) {
             if (!s || !s->alive || s->master_fd < 0) continue;
-            // Skip attached sessions where client is congested
-            if (s->client_fd >= 0 && s->flow_paused) continue;
 
             struct pollfd ppfd = {};
             ppfd.fd = s->master_fd;
-            ppfd.events = POLLIN;
+            if (s->client_fd < 0 || !s->flow_paused)
+                ppfd.events = POLLIN;
+            if (!deferred_client_fds.empty() && s->boost_until_ns <= poll_build_ns &&
+                std::find(deferred_client_fds.begin(), deferred_client_fds.end(),
+                          s->client_fd) != deferred_client_fds.end())
+                ppfd.events &= ~POLLIN;
+            if (input_queued(s) > 0)
+                ppfd.events |= POLLOUT;
+            if (!ppfd.events) continue;
             fds.push_back(ppfd);
             pty_sessions.push_back(s);
         }
 
-        int ret = poll(fds.data(), static_cast<nfds_t>(fds.size()), POLL_TIMEOUT_MS);
+        uint64_t removed_before = g_sessions_removed;
+        uint64_t poll_start = monotonic_ns();
+        int ret = poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+        uint64_t poll_end = monotonic_ns();
+        g_loop_iterations++;
+        g_lat_poll_wait.record(poll_end - poll_start);
+        bool tracing = trace_active();
+        if (tracing)
+            trace_complete("poll", "loop", poll_start, poll_end - poll_start);
 
         if (ret < 0) {
             if (errno == EINTR)
@@ -979,6 +2777,7 @@ void event_loop_run(int listen_fd) {
         if (fds[0].revents & POLLIN) {
             signal_pipe_drain();
             reap_children();
+            process_search_completions();
             if (g_shutdown_requested)
                 break;
         }
@@ -990,10 +2789,22 @@ void event_loop_run(int listen_fd) {
                 g_clients.push_back(c);
         }
 
-        // 3. Client fds — read data and process messages
-        for (size_t i = 0; i < g_clients.size(); i++) {
-            size_t pfd_idx = client_start + i;
-            if (pfd_idx >= fds.size()) break;
+        // Memory pressure: give back scrollback of unattached sessions
+        if (psi_idx && fds[psi_idx].revents) {
+            if (fds[psi_idx].revents & POLLPRI) {
+                handle_memory_pressure();
+            } else {
+                LOG_WARN("PSI trigger failed, memory pressure shrinking disabled");
+                close(g_psi_fd);
+                g_psi_fd = -1;
+            }
+        }
+
+        // 3. Client fds — read data and process messages. pfd_idx advances
+        // separately: removing a client shifts g_clients but not fds, and
+        // clients accepted above have no pollfd until the next iteration.
+        for (size_t i = 0, pfd_idx = client_start;
+             i < g_clients.size() && pfd_idx < pty_start; i++, pfd_idx++) {
             Client *c = g_clients[i];
 
             if (fds[pfd_idx].revents & (POLLERR | POLLHUP | POLLNVAL)) {
@@ -1005,6 +2816,7 @@ void event_loop_run(int listen_fd) {
                 uint8_t buf[8192];
                 ssize_t n = read(c->fd, buf, sizeof(buf));
                 if (n > 0) {
+                    c->bytes_in += static_cast<uint64_t>(n);
                     c->recv_buf.insert(c->recv_buf.end(), buf, buf + n);
                     process_client_messages(c);
                 } else if (n == 0) {
@@ -1019,64 +2831,55 @@ void event_loop_run(int listen_fd) {
                     remove_client_at(i);
                     continue;
                 }
+                note_output_flushed(c);
+                if (!c->observed_sessions.empty())
+                    resume_observations(c);
                 // If flushed completely, check if any sessions had paused flow
                 if (!c->congested) {
                     for (const auto &sid : c->attached_sessions) {
                         DaemonSession *s = find_session(sid.c_str());
-                        if (s) s->flow_paused = false;
+                        if (s) set_flow_paused(s, false);
                     }
                 }
             }
         }
 
-        // 5. PTY master fds — read output
-        for (size_t i = 0; i < pty_sessions.size(); i++) {
-            size_t pfd_idx = pty_start + i;
-            if (pfd_idx >= fds.size()) break;
-            DaemonSession *s = pty_sessions[i];
-
-            if (fds[pfd_idx].revents & POLLIN) {
-                uint8_t buf[8192];
-                ssize_t n = read(s->master_fd, buf, sizeof(buf));
-                if (n > 0) {
-                    // Write to ring buffer
-                    s->ring->write(buf, static_cast<size_t>(n));
-
-                    // Forward to attached client
-                    if (s->client_fd >= 0) {
-                        Client *c = find_client_for_session(s);
-                        if (c) {
-                            // Build OUTPUT: [36B session_id][data...]
-                            std::vector<uint8_t> output(SESSION_ID_LEN + static_cast<size_t>(n));
-                            memcpy(output.data(), s->uuid, SESSION_ID_LEN);
-                            memcpy(output.data() + SESSION_ID_LEN, buf, static_cast<size_t>(n));
-                            queue_message(c, MSG_OUTPUT, output.data(),
-                                          static_cast<uint32_t>(output.size()));
-
-                            // Try to flush immediately
-                            if (!flush_send_buf(c)) {
-                                LOG_ERROR("flush failed for client fd=%d (output)", c->fd);
-                            }
-                            // Flow control: if client is congested, pause this session
-                            if (c->congested)
-                                s->flow_paused = true;
-                        }
-                    }
-                } else if (n < 0 && errno != EAGAIN && errno != EIO) {
-                    LOG_DEBUG("read from PTY master fd=%d: %s",
-                              s->master_fd, strerror(errno));
-                }
-                // EIO on PTY master means shell exited — SIGCHLD will handle it
-            }
+        // 5. PTY master fds — write queued input, read output. Boosted
+        // sessions (typed into within INTERACTIVE_BOOST_MS) go first; while
+        // any is boosted, bulk producers get BULK_READS_WHILE_BOOSTED reads
+        // per iteration and the rest wait for the next poll.
+        bool boosting = g_boost_until_ns > poll_end;
+        size_t bulk_reads = 0;
+        for (int pass = 0; pass < (boosting ? 2 : 1); pass++) {
+            for (size_t i = 0; i < pty_sessions.size(); i++) {
+                size_t pfd_idx = pty_start + i;
+                if (pfd_idx >= fds.size()) break;
+                DaemonSession *s = pty_sessions[i];
+
+                // A DESTROY handled above may have freed it
+                if (g_sessions_removed != removed_before &&
+                    std::find(g_sessions.begin(), g_sessions.end(), s) == g_sessions.end())
+                    continue;
 
-            if (fds[pfd_idx].revents & (POLLERR | POLLHUP)) {
-                // PTY closed — shell probably exited, SIGCHLD will handle cleanup
-                LOG_DEBUG("PTY master fd=%d got POLLHUP/POLLERR", s->master_fd);
+                short revents = fds[pfd_idx].revents;
+                bool boosted = s->boost_until_ns > poll_end;
+                if (boosting && boosted != (pass == 0))
+                    continue;
+                if (boosting && !boosted && (revents & POLLIN) &&
+                    bulk_reads++ >= BULK_READS_WHILE_BOOSTED)
+                    revents &= ~POLLIN;
+                service_pty(s, revents, boosted);
             }
         }
 
         // 6. Periodic checks (run every iteration, not just on timeout)
         check_timeouts();
+
+        uint64_t work_ns = monotonic_ns() - poll_end;
+        g_lat_loop_work.record(work_ns);
+        if (tracing)
+            trace_complete("loop_work", "loop", poll_end, work_ns);
+
         if (check_idle_timeout())
             break;
     }
@@ -1095,4 +2898,12 @@ void event_loop_run(int listen_fd) {
     for (auto *s : g_sessions)
         session_destroy(s);
     g_sessions.clear();
+
+    if (g_psi_fd >= 0) {
+        close(g_psi_fd);
+        g_psi_fd = -1;
+    }
+    synthetic_shutdown();
+    worker_shutdown();
+    trace_stop();
 }
@@ -46,6 +46,41 @@ void signal_pipe_drain();
 // Set the ring buffer capacity for new sessions.
 void set_ring_buffer_capacity(size_t capacity);
 
+// Set the compressed cold history limit (uncompressed bytes, 0 = disabled).
+void set_history_limit(size_t limit);
+
+// Spill history evicted from memory to segment files in the socket
+// directory. Quotas are in bytes on disk (0 = unlimited).
+void set_history_spill(bool enabled, size_t session_quota, size_t global_quota);
+
+// Back new rings with mmap'd files in the socket directory, and recover
+// ring files left behind by a crashed daemon when the loop starts.
+void set_scrollback_persistence(bool enabled);
+
+// Drop a line's earlier drawings from scrollback once a carriage-return
+// redraw covers them (progress bars; see cr_compact.h).
+void set_cr_compaction(bool enabled);
+
+// Serve every CREATE with a synthetic session (see synthetic.h) instead
+// of a shell on a PTY. For load testing.
+void set_synthetic_sessions(bool enabled);
+
+// Upper bound on concurrent sessions (default MAX_SESSIONS).
+void set_max_sessions(size_t max);
+
+// Cap the total capacity of all scrollback rings (0 = unlimited). Over
+// budget, and on Linux when PSI reports memory pressure, the rings of the
+// longest-detached sessions are shrunk first.
+void set_ring_budget(size_t bytes);
+
+// Coalesce RESIZE bursts: apply a session's geometry this long after its
+// last RESIZE, so a window drag costs one SIGWINCH. 0 = apply immediately.
+void set_resize_debounce(unsigned ms);
+
+// Write a Chrome trace-event file (trace-<pid>-<time>.json in the socket
+// directory) covering the first seconds of the loop. 0 = off.
+void set_trace_window(unsigned seconds);
+
 // Run the main event loop.
 // listen_fd: the bound+listening Unix socket fd
 // Returns when SIGTERM/SIGINT is received or idle timeout expires.
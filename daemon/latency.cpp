@@ -0,0 +1,122 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "latency.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SUB_COUNT)
+        return static_cast<uint64_t>(bucket);
+    int shift = bucket / SUB_COUNT - 1;
+    uint64_t sub = static_cast<uint64_t>(bucket % SUB_COUNT);
+    uint64_t low = (static_cast<uint64_t>(SUB_COUNT) + sub) << shift;
+    return low + ((1ULL << shift) - 1);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (_total == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(_total) + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += _counts[b];
+        if (seen >= rank)
+            return std::min(bucketUpperBound(b), _max);
+    }
+    return _max;
+}
+
+// -------------------------------------------------------------------
+// Trace writer (event-loop thread only)
+// -------------------------------------------------------------------
+
+// Hard cap so a busy daemon cannot fill the disk during a long window
+static constexpr uint64_t TRACE_MAX_EVENTS = 2000000;
+
+static FILE *g_trace_file = nullptr;
+static uint64_t g_trace_until_ns = 0;
+static uint64_t g_trace_origin_ns = 0;
+static uint64_t g_trace_events = 0;
+
+bool trace_start(const std::string &path, uint64_t duration_ns) {
+    if (g_trace_file)
+        return false;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("cannot create trace file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    g_trace_file = fdopen(fd, "w");
+    if (!g_trace_file) {
+        close(fd);
+        return false;
+    }
+    setvbuf(g_trace_file, nullptr, _IOFBF, 1 << 20);
+    g_trace_origin_ns = monotonic_ns();
+    g_trace_until_ns = g_trace_origin_ns + duration_ns;
+    g_trace_events = 0;
+    fprintf(g_trace_file, "[\n");
+    LOG_INFO("tracing to %s for %llu ms", path.c_str(),
+             static_cast<unsigned long long>(duration_ns / 1000000));
+    return true;
+}
+
+bool trace_active() {
+    if (!g_trace_file)
+        return false;
+    if (monotonic_ns() >= g_trace_until_ns || g_trace_events >= TRACE_MAX_EVENTS) {
+        trace_stop();
+        return false;
+    }
+    return true;
+}
+
+void trace_complete(const char *name, const char *category,
+                    uint64_t start_ns, uint64_t dur_ns) {
+    if (!g_trace_file)
+        return;
+    // Timestamps are microseconds (fractional) from the start of the trace
+    fprintf(g_trace_file,
+            "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":%d,\"tid\":1}\n",
+            g_trace_events ? "," : "", name, category,
+            static_cast<double>(start_ns - g_trace_origin_ns) / 1000.0,
+            static_cast<double>(dur_ns) / 1000.0, static_cast<int>(getpid()));
+    g_trace_events++;
+}
+
+void trace_stop() {
+    if (!g_trace_file)
+        return;
+    fprintf(g_trace_file, "]\n");
+    fclose(g_trace_file);
+    g_trace_file = nullptr;
+    LOG_INFO("trace finished: %llu events", static_cast<unsigned long long>(g_trace_events));
+}
@@ -0,0 +1,123 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Event-loop latency instrumentation: log-linear (HDR-style) histograms
+// that are cheap enough to stay on, plus an optional Chrome trace-event
+// writer (chrome://tracing, Perfetto) for a bounded time window.
+
+#ifndef CRT_SESSIOND_LATENCY_H
+#define CRT_SESSIOND_LATENCY_H
+
+#include "clock.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Nanosecond histogram with 8 linear sub-buckets per power of two, so any
+// recorded value is reported within 12.5%. Fixed 4 KB, no allocation.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 3;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    void record(uint64_t ns) {
+        _counts[bucketOf(ns)]++;
+        _total++;
+        if (ns > _max)
+            _max = ns;
+    }
+
+    uint64_t count() const { return _total; }
+    uint64_t max() const { return _max; }
+
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100).
+    uint64_t percentile(double p) const;
+
+private:
+    uint64_t _counts[BUCKETS] = {};
+    uint64_t _total = 0;
+    uint64_t _max = 0;
+
+    static int bucketOf(uint64_t v) {
+        if (v < static_cast<uint64_t>(SUB_COUNT))
+            return static_cast<int>(v);
+        int exp = 63 - __builtin_clzll(v);
+        int shift = exp - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + static_cast<int>((v >> shift) & (SUB_COUNT - 1));
+    }
+    static uint64_t bucketUpperBound(int bucket);
+};
+
+// What a histogram measures (STATS latency section)
+enum LatencyKind : uint8_t {
+    LATENCY_POLL_WAIT      = 0,   // Time blocked in poll()
+    LATENCY_LOOP_WORK      = 1,   // Work per loop iteration after poll() returns
+    LATENCY_OUTPUT         = 2,   // PTY read until the output left the socket
+    LATENCY_HANDLER        = 3,   // One message handler (msg_type says which)
+    LATENCY_REPLAY         = 4,   // send_replay()
+    LATENCY_SESSION_CREATE = 5,   // session_create()
+    LATENCY_DESTROY_KILL   = 6,   // Shell kill escalation in DESTROY
+    LATENCY_INTERACTIVE    = 7,   // LATENCY_OUTPUT for sessions in their input boost
+};
+
+// -------------------------------------------------------------------
+// Chrome trace events
+// -------------------------------------------------------------------
+
+// Start writing trace events to path for duration_ns. Returns false if
+// the file cannot be created (or a trace is already running).
+bool trace_start(const std::string &path, uint64_t duration_ns);
+
+// True while a trace window is open; ends it once the window has passed.
+bool trace_active();
+
+// Record a complete ("X") event. start_ns/dur_ns are monotonic_ns() values.
+void trace_complete(const char *name, const char *category,
+                    uint64_t start_ns, uint64_t dur_ns);
+
+// Close the JSON array and the file.
+void trace_stop();
+
+// Times a scope into a histogram and, while tracing, a trace event.
+class LatencyScope {
+public:
+    LatencyScope(LatencyHistogram &hist, const char *name, const char *category)
+        : _hist(hist), _name(name), _category(category), _start(monotonic_ns()) {}
+    ~LatencyScope() {
+        uint64_t dur = monotonic_ns() - _start;
+        _hist.record(dur);
+        if (trace_active())
+            trace_complete(_name, _category, _start, dur);
+    }
+
+    LatencyScope(const LatencyScope &) = delete;
+    LatencyScope &operator=(const LatencyScope &) = delete;
+
+private:
+    LatencyHistogram &_hist;
+    const char *_name;
+    const char *_category;
+    uint64_t _start;
+};
+
+#endif // CRT_SESSIOND_LATENCY_H
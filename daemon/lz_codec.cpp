@@ -0,0 +1,188 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "lz_codec.h"
+
+#include <cstring>
+
+// Stream format: a sequence of
+//   [token][literal length ext...][literals][2B offset LE][match length ext...]
+// token = (literal_len << 4) | (match_len - MIN_MATCH), each nibble saturating
+// at 15 with 255-run extension bytes. The final sequence carries literals only.
+
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5;   // trailing bytes always emitted as literals
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int HASH_LOG = 12;
+
+static inline uint32_t load32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Write a 255-run length extension. Returns false if dst would overflow.
+static inline bool put_length(uint8_t **op, const uint8_t *oend, size_t len) {
+    while (len >= 255) {
+        if (*op >= oend) return false;
+        *(*op)++ = 255;
+        len -= 255;
+    }
+    if (*op >= oend) return false;
+    *(*op)++ = static_cast<uint8_t>(len);
+    return true;
+}
+
+static bool emit_sequence(uint8_t **op, const uint8_t *oend,
+                          const uint8_t *lit, size_t lit_len,
+                          size_t offset, size_t match_len) {
+    if (*op >= oend) return false;
+    uint8_t *token = (*op)++;
+    *token = static_cast<uint8_t>((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15 && !put_length(op, oend, lit_len - 15))
+        return false;
+    if (static_cast<size_t>(oend - *op) < lit_len)
+        return false;
+    memcpy(*op, lit, lit_len);
+    *op += lit_len;
+
+    if (match_len == 0)
+        return true;  // final literal-only sequence
+
+    if (oend - *op < 2) return false;
+    (*op)[0] = static_cast<uint8_t>(offset & 0xFF);
+    (*op)[1] = static_cast<uint8_t>(offset >> 8);
+    *op += 2;
+
+    size_t ml = match_len - MIN_MATCH;
+    *token |= static_cast<uint8_t>(ml >= 15 ? 15 : ml);
+    if (ml >= 15 && !put_length(op, oend, ml - 15))
+        return false;
+    return true;
+}
+
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_cap) {
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_cap;
+    size_t anchor = 0;
+
+    if (len > MIN_MATCH + LAST_LITERALS) {
+        uint32_t table[1 << HASH_LOG] = {};
+        size_t ip = 1;
+        size_t match_limit = len - LAST_LITERALS;
+
+        while (ip + MIN_MATCH <= match_limit) {
+            uint32_t seq = load32(src + ip);
+            uint32_t h = hash32(seq);
+            size_t ref = table[h];
+            table[h] = static_cast<uint32_t>(ip);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || load32(src + ref) != seq) {
+                // Skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            size_t ml = MIN_MATCH;
+            while (ip + ml < match_limit && src[ref + ml] == src[ip + ml])
+                ml++;
+
+            if (!emit_sequence(&op, oend, src + anchor, ip - anchor, ip - ref, ml))
+                return 0;
+            ip += ml;
+            anchor = ip;
+        }
+    }
+
+    if (!emit_sequence(&op, oend, src + anchor, len - anchor, 0, 0))
+        return 0;
+    return static_cast<size_t>(op - dst);
+}
+
+// Read a 255-run length extension. Returns false on truncated input.
+static inline bool get_length(const uint8_t **ip, const uint8_t *iend, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lz_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t raw_len) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + raw_len;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !get_length(&ip, iend, &lit_len))
+            return false;
+        if (static_cast<size_t>(iend - ip) < lit_len ||
+            static_cast<size_t>(oend - op) < lit_len)
+            return false;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == iend)
+            break;  // final sequence has no match
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst))
+            return false;
+
+        size_t match_len = token & 0x0F;
+        if (match_len == 15 && !get_length(&ip, iend, &match_len))
+            return false;
+        match_len += MIN_MATCH;
+        if (static_cast<size_t>(oend - op) < match_len)
+            return false;
+
+        const uint8_t *match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // Overlapping copy (run-length style)
+            while (match_len--)
+                *op++ = *match++;
+        }
+    }
+
+    return op == oend;
+}
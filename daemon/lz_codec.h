@@ -0,0 +1,45 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Small LZ77 block codec (LZ4-style token format) for compressing cold
+// scrollback. Fast single-pass compressor, bounds-checked decompressor.
+// Self-contained so the daemon keeps no third-party dependencies.
+
+#ifndef CRT_SESSIOND_LZ_CODEC_H
+#define CRT_SESSIOND_LZ_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Worst-case compressed size for len input bytes.
+inline constexpr size_t lz_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+// Compress src[0..len) into dst (capacity dst_cap).
+// Returns the compressed size, or 0 if dst is too small.
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_cap);
+
+// Decompress src[0..len) into dst, which must receive exactly raw_len bytes.
+// Returns false on malformed input (never reads or writes out of bounds).
+bool lz_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t raw_len);
+
+#endif // CRT_SESSIOND_LZ_CODEC_H
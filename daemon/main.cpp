@@ -23,13 +23,16 @@
 #include "log.h"
 #include "protocol.h"
 #include "server.h"
+#include "stats_report.h"
 
 #include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <signal.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -61,42 +64,138 @@ extern volatile sig_atomic_t g_shutdown_requested;
 struct CliArgs {
     bool version;
     bool shutdown;
+    bool stats;
     bool debug;
     bool foreground;
+    bool persist_scrollback;
+    bool compact_cr;
+    unsigned trace_seconds;
+    bool synthetic;
+    size_t max_sessions;
+    unsigned resize_debounce_ms;
     size_t buffer_size;
+    size_t ring_budget;
+    size_t history_size;
+    bool spill_history;
+    size_t spill_quota;
+    size_t spill_global_quota;
 };
 
 static CliArgs parse_args(int argc, char *argv[]) {
     CliArgs args = {};
     args.buffer_size = DEFAULT_RING_BUFFER_SIZE;
+    args.max_sessions = MAX_SESSIONS;
+    args.resize_debounce_ms = DEFAULT_RESIZE_DEBOUNCE_MS;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-v") == 0) {
             args.version = true;
         } else if (strcmp(argv[i], "--shutdown") == 0) {
             args.shutdown = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            args.stats = true;
         } else if (strcmp(argv[i], "--debug") == 0) {
             args.debug = true;
             args.foreground = true;  // Debug implies foreground
         } else if (strcmp(argv[i], "--foreground") == 0 || strcmp(argv[i], "-f") == 0) {
             args.foreground = true;
+        } else if (strcmp(argv[i], "--history-size") == 0 && i + 1 < argc) {
+            i++;
+            long long val = strtoll(argv[i], nullptr, 10);
+            if (val >= 0 && val <= 1024LL * 1024 * 1024)  // Max 1 GB
+                args.history_size = static_cast<size_t>(val);
+            else
+                fprintf(stderr, "invalid history size: %s\n", argv[i]);
+        } else if ((strcmp(argv[i], "--spill-quota") == 0 ||
+                    strcmp(argv[i], "--spill-global-quota") == 0) && i + 1 < argc) {
+            bool global = strcmp(argv[i], "--spill-global-quota") == 0;
+            i++;
+            long long val = strtoll(argv[i], nullptr, 10);
+            if (val >= 0) {
+                args.spill_history = true;
+                (global ? args.spill_global_quota : args.spill_quota) = static_cast<size_t>(val);
+            } else {
+                fprintf(stderr, "invalid spill quota: %s\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--spill-history") == 0) {
+            args.spill_history = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            i++;
+            long val = strtol(argv[i], nullptr, 10);
+            if (val > 0 && val <= 3600)  // Max 1 hour
+                args.trace_seconds = static_cast<unsigned>(val);
+            else
+                fprintf(stderr, "invalid trace duration: %s\n", argv[i]);
+        } else if (strcmp(argv[i], "--synthetic") == 0) {
+            args.synthetic = true;
+        } else if (strcmp(argv[i], "--max-sessions") == 0 && i + 1 < argc) {
+            i++;
+            long val = strtol(argv[i], nullptr, 10);
+            if (val > 0 && val <= 100000)
+                args.max_sessions = static_cast<size_t>(val);
+            else
+                fprintf(stderr, "invalid session limit: %s\n", argv[i]);
+        } else if (strcmp(argv[i], "--resize-debounce") == 0 && i + 1 < argc) {
+            i++;
+            long val = strtol(argv[i], nullptr, 10);
+            if (val >= 0 && val <= 1000)
+                args.resize_debounce_ms = static_cast<unsigned>(val);
+            else
+                fprintf(stderr, "invalid resize debounce: %s\n", argv[i]);
+        } else if (strcmp(argv[i], "--persist-scrollback") == 0) {
+            args.persist_scrollback = true;
+        } else if (strcmp(argv[i], "--compact-cr") == 0) {
+            args.compact_cr = true;
         } else if (strcmp(argv[i], "--buffer-size") == 0 && i + 1 < argc) {
             i++;
             long val = strtol(argv[i], nullptr, 10);
-            if (val > 0 && val <= 64 * 1024 * 1024)  // Max 64 MB
+            if (val >= static_cast<long>(MIN_RING_BUFFER_SIZE) &&
+                val <= static_cast<long>(MAX_RING_BUFFER_SIZE))
                 args.buffer_size = static_cast<size_t>(val);
             else
                 fprintf(stderr, "invalid buffer size: %s\n", argv[i]);
+        } else if (strcmp(argv[i], "--ring-budget") == 0 && i + 1 < argc) {
+            i++;
+            long long val = strtoll(argv[i], nullptr, 10);
+            if (val >= 0)
+                args.ring_budget = static_cast<size_t>(val);
+            else
+                fprintf(stderr, "invalid ring budget: %s\n", argv[i]);
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("Usage: crt-sessiond [OPTIONS]\n\n"
                    "Options:\n"
                    "  --version, -v       Print version and exit\n"
                    "  --shutdown          Send SIGTERM to running daemon and exit\n"
+                   "  --stats             Print running daemon's counters and exit\n"
                    "  --debug             Run in foreground with verbose logging\n"
                    "  --foreground, -f    Run in foreground (don't daemonize)\n"
                    "  --buffer-size N     Ring buffer size in bytes (default: %zu)\n"
+                   "  --ring-budget N     Cap on all rings together, in bytes; the longest-\n"
+                   "                      detached sessions' rings shrink first (default: 0,\n"
+                   "                      unlimited). Also sheds scrollback on memory pressure\n"
+                   "  --history-size N    Compressed history beyond the ring, in bytes\n"
+                   "                      of uncompressed output (default: 0, disabled)\n"
+                   "  --spill-history     Spill history beyond --history-size to disk\n"
+                   "  --spill-quota N     Per-session disk cap for spilled history, in bytes\n"
+                   "                      (implies --spill-history, default: unlimited)\n"
+                   "  --spill-global-quota N\n"
+                   "                      Disk cap for spilled history across all sessions\n"
+                   "  --persist-scrollback\n"
+                   "                      Keep scrollback in mmap'd files so it survives a crash\n"
+                   "  --compact-cr        Keep only the last drawing of lines redrawn with a\n"
+                   "                      carriage return (progress bars, spinners)\n"
+                   "  --trace SECS        Write a Chrome trace (trace-<pid>-<time>.json in the\n"
+                   "                      socket directory) for the first SECS seconds\n"
+                   "  --resize-debounce MS\n"
+                   "                      Apply a burst of resizes once, MS after the last\n"
+                   "                      (default: %u, 0 applies each immediately)\n"
+                   "  --max-sessions N    Concurrent session limit (default: %d)\n"
+                   "  --synthetic         Load testing: sessions run an in-process output\n"
+                   "                      generator instead of a shell. CREATE's shell picks\n"
+                   "                      text, ansi, utf8 or echo; args may set rate=B/s\n"
+                   "                      and burst=N\n"
                    "  --help, -h          Show this help\n",
-                   DEFAULT_RING_BUFFER_SIZE);
+                   DEFAULT_RING_BUFFER_SIZE, DEFAULT_RESIZE_DEBOUNCE_MS, MAX_SESSIONS);
             exit(0);
         } else {
             fprintf(stderr, "unknown option: %s\n", argv[i]);
@@ -184,6 +283,10 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    // --stats: print counters of the running daemon
+    if (args.stats)
+        return print_stats(get_socket_path());
+
     // Create socket directory
     if (!create_socket_dir()) {
         fprintf(stderr, "failed to create socket directory\n");
@@ -242,6 +345,29 @@ int main(int argc, char *argv[]) {
 
     // Set ring buffer capacity
     set_ring_buffer_capacity(args.buffer_size);
+    set_ring_budget(args.ring_budget);
+    set_history_limit(args.history_size);
+    set_history_spill(args.spill_history, args.spill_quota, args.spill_global_quota);
+    set_scrollback_persistence(args.persist_scrollback);
+    set_cr_compaction(args.compact_cr);
+    set_trace_window(args.trace_seconds);
+    set_synthetic_sessions(args.synthetic);
+    set_max_sessions(args.max_sessions);
+    set_resize_debounce(args.resize_debounce_ms);
+
+    // Many sessions need many fds (two per synthetic session)
+    if (args.synthetic || args.max_sessions > static_cast<size_t>(MAX_SESSIONS)) {
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+            rl.rlim_cur = rl.rlim_max;
+#if defined(__APPLE__)
+            if (rl.rlim_cur > OPEN_MAX)
+                rl.rlim_cur = OPEN_MAX;   // setrlimit rejects more
+#endif
+            if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+                LOG_WARN("could not raise the open file limit: %s", strerror(errno));
+        }
+    }
 
     // Enter event loop
     event_loop_run(listen_fd);
@@ -0,0 +1,110 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Vectorised '\n' counting for the ring's line index and line-based
+// replay. SSE2 on x86-64, NEON on ARM64, 8-byte SWAR elsewhere.
+
+#ifndef CRT_SESSIOND_NEWLINE_SCAN_H
+#define CRT_SESSIOND_NEWLINE_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Number of '\n' bytes in data[0..len).
+inline size_t count_newlines(const uint8_t *data, size_t len) {
+    size_t total = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (len - i >= 16) {
+        // Per-lane counters are 8-bit: fold them every 255 vectors
+        size_t vectors = (len - i) / 16;
+        if (vectors > 255)
+            vectors = 255;
+        __m128i acc = zero;
+        for (size_t v = 0; v < vectors; v++, i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(chunk, nl));
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        total += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+                 static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t nl = vdupq_n_u8('\n');
+    while (len - i >= 16) {
+        size_t vectors = (len - i) / 16;
+        if (vectors > 255)
+            vectors = 255;
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (size_t v = 0; v < vectors; v++, i += 16)
+            acc = vsubq_u8(acc, vceqq_u8(vld1q_u8(data + i), nl));
+        uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+        total += static_cast<size_t>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    for (; len - i >= 8; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        word ^= ones * '\n';
+        // High bit set exactly in the bytes that were '\n'
+        uint64_t hits = ~(((word & low7) + low7) | word | low7);
+        total += static_cast<size_t>(__builtin_popcountll(hits));
+    }
+#endif
+
+    for (; i < len; i++)
+        total += (data[i] == '\n');
+    return total;
+}
+
+// Offset of the n-th (1-based) '\n' in data[0..len), or len if there are
+// fewer than n. Skips 64-byte spans with the vector count.
+inline size_t find_nth_newline(const uint8_t *data, size_t len, size_t n) {
+    if (n == 0)
+        return len;
+    size_t i = 0;
+    while (len - i > 64) {
+        size_t c = count_newlines(data + i, 64);
+        if (c >= n)
+            break;
+        n -= c;
+        i += 64;
+    }
+    for (; i < len; i++) {
+        if (data[i] == '\n' && --n == 0)
+            return i;
+    }
+    return len;
+}
+
+#endif // CRT_SESSIOND_NEWLINE_SCAN_H
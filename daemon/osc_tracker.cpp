@@ -0,0 +1,171 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "osc_tracker.h"
+#include "search.h"
+
+#include <cstring>
+
+static const uint8_t OSC_START[2] = {0x1b, ']'};
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// OSC 7 payload: file://host/path (percent-encoded), or a bare path.
+static std::string osc7_path(const std::string &url) {
+    size_t pos = 0;
+    if (url.compare(0, 7, "file://") == 0) {
+        pos = url.find('/', 7);
+        if (pos == std::string::npos)
+            return std::string();
+    } else if (url.empty() || url[0] != '/') {
+        return std::string();
+    }
+
+    std::string path;
+    path.reserve(url.size() - pos);
+    for (size_t i = pos; i < url.size(); i++) {
+        int hi, lo;
+        if (url[i] == '%' && i + 2 < url.size() &&
+            (hi = hex_value(url[i + 1])) >= 0 && (lo = hex_value(url[i + 2])) >= 0) {
+            path += static_cast<char>(hi * 16 + lo);
+            i += 2;
+        } else {
+            path += url[i];
+        }
+    }
+    return path;
+}
+
+// A complete OSC body ("Ps;Pt") arrived.
+static unsigned apply_osc(OscTracker &t, const std::string &body) {
+    size_t semi = body.find(';');
+    if (semi == std::string::npos)
+        return 0;
+    std::string ps = body.substr(0, semi);
+    std::string pt = body.substr(semi + 1);
+
+    if (ps == "0" || ps == "2") {
+        if (pt == t.title)
+            return 0;
+        t.title = pt;
+        return OSC_TITLE_CHANGED;
+    }
+    if (ps == "7") {
+        std::string path = osc7_path(pt);
+        if (path.empty() || path == t.cwd)
+            return 0;
+        t.cwd = path;
+        return OSC_CWD_CHANGED;
+    }
+    return 0;
+}
+
+static void abandon(OscTracker &t) {
+    t.in_osc = false;
+    t.esc_pending = false;
+    t.partial.clear();
+}
+
+// Continue an OSC body at data[i]; returns where scanning for the next
+// sequence should resume.
+static size_t continue_osc(OscTracker &t, const uint8_t *data, size_t len, size_t i,
+                           unsigned *changes) {
+    if (t.esc_pending) {
+        // ESC ended the previous read: ST if '\' follows
+        t.esc_pending = false;
+        if (len > 0 && data[0] == '\\') {
+            *changes |= apply_osc(t, t.partial);
+            abandon(t);
+            return 1;
+        }
+        abandon(t);
+        return 0;
+    }
+
+    size_t start = i;
+    for (; i < len; i++) {
+        uint8_t b = data[i];
+        if (b == 0x07 || b == 0x1b || b == 0x18 || b == 0x1a)
+            break;
+    }
+    size_t body_len = t.partial.size() + (i - start);
+    if (body_len > OSC_MAX_SEQUENCE) {
+        abandon(t);
+        return i;
+    }
+    t.partial.append(reinterpret_cast<const char *>(data + start), i - start);
+
+    if (i == len)
+        return len;   // Continues in the next read
+    if (data[i] == 0x07) {
+        *changes |= apply_osc(t, t.partial);
+        abandon(t);
+        return i + 1;
+    }
+    if (data[i] == 0x1b) {
+        if (i + 1 == len) {
+            t.esc_pending = true;
+            return len;
+        }
+        if (data[i + 1] == '\\') {
+            *changes |= apply_osc(t, t.partial);
+            abandon(t);
+            return i + 2;
+        }
+    }
+    // CAN, SUB or another escape sequence cancels the OSC
+    abandon(t);
+    return i;
+}
+
+unsigned osc_scan(OscTracker &t, const uint8_t *data, size_t len) {
+    unsigned changes = 0;
+    if (len == 0)
+        return 0;
+
+    size_t i = 0;
+    if (t.in_osc) {
+        i = continue_osc(t, data, len, 0, &changes);
+    } else if (t.esc_pending) {
+        t.esc_pending = false;
+        if (data[0] == ']') {
+            t.in_osc = true;
+            i = continue_osc(t, data, len, 1, &changes);
+        }
+    }
+
+    while (i < len && !t.in_osc) {
+        const uint8_t *p = find_substring(data + i, len - i, OSC_START, sizeof(OSC_START));
+        if (!p) {
+            t.esc_pending = data[len - 1] == 0x1b;
+            break;
+        }
+        t.in_osc = true;
+        t.partial.clear();
+        i = continue_osc(t, data, len, static_cast<size_t>(p - data) + 2, &changes);
+    }
+    return changes;
+}
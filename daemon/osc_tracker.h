@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Window title (OSC 0/2) and working directory (OSC 7) announced by the
+// program in a session, picked out of PTY output as it is read. Sequences
+// may be split across reads.
+
+#ifndef CRT_SESSIOND_OSC_TRACKER_H
+#define CRT_SESSIOND_OSC_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Longer sequences (OSC 52 clipboard payloads, say) are skipped
+inline constexpr size_t OSC_MAX_SEQUENCE = 2048;
+
+struct OscTracker {
+    std::string title;                // Last OSC 0/2 text
+    std::string cwd;                  // Last OSC 7 path, percent-decoded
+    std::string partial;              // Body of a sequence cut off by the end of a read
+    bool        in_osc = false;       // Inside an OSC body
+    bool        esc_pending = false;  // Read ended on ESC (outside: maybe ESC ]; inside: maybe ST)
+};
+
+enum OscChange : unsigned {
+    OSC_TITLE_CHANGED = 0x01,
+    OSC_CWD_CHANGED   = 0x02,
+};
+
+// Scan one PTY read. Returns the OscChange bits of values that changed.
+unsigned osc_scan(OscTracker &tracker, const uint8_t *data, size_t len);
+
+#endif // CRT_SESSIOND_OSC_TRACKER_H
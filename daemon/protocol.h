@@ -49,6 +49,13 @@ inline constexpr size_t SESSION_ID_LEN = 36;
 // Default ring buffer size: 1 MB
 inline constexpr size_t DEFAULT_RING_BUFFER_SIZE = 1024 * 1024;
 
+// Ring buffer size limits for --buffer-size and CREATE's ring_size
+inline constexpr size_t MIN_RING_BUFFER_SIZE = 4 * 1024;
+inline constexpr size_t MAX_RING_BUFFER_SIZE = 64 * 1024 * 1024;
+
+// Rings shrunk for the memory budget keep at least this much
+inline constexpr size_t RING_SHRINK_FLOOR = 64 * 1024;
+
 // Max sessions
 inline constexpr int MAX_SESSIONS = 256;
 
@@ -61,9 +68,21 @@ inline constexpr int IDLE_TIMEOUT_SECS = 30 * 60;
 // Dead session keep time: 60 seconds
 inline constexpr int DEAD_SESSION_KEEP_SECS = 60;
 
+// Recovered (post-crash) session keep time: 10 minutes
+inline constexpr int RECOVERED_SESSION_KEEP_SECS = 10 * 60;
+
 // Poll timeout: 5 seconds
 inline constexpr int POLL_TIMEOUT_MS = 5000;
 
+// Interactive boost: a session's output is serviced first for this long
+// after INPUT, RESIZE or SEND_SIGNAL; meanwhile other sessions get at most
+// BULK_READS_WHILE_BOOSTED PTY reads per loop iteration
+inline constexpr unsigned INTERACTIVE_BOOST_MS = 100;
+inline constexpr size_t BULK_READS_WHILE_BOOSTED = 8;
+
+// Resize coalescing: a RESIZE burst is applied once, this long after the last
+inline constexpr unsigned DEFAULT_RESIZE_DEBOUNCE_MS = 25;
+
 // Heartbeat timeout: 90 seconds (daemon side)
 inline constexpr int CLIENT_HEARTBEAT_TIMEOUT_SECS = 90;
 
@@ -98,8 +117,87 @@ enum MsgType : uint8_t {
     MSG_FG_PROCESS_UPDATE = 0x19,
     MSG_PING              = 0x1A,
     MSG_PONG              = 0x1B,
+    MSG_REPLAY_RANGE      = 0x1C,
+    MSG_RANGE_DATA        = 0x1D,
+    MSG_RANGE_END         = 0x1E,
+    MSG_SEARCH            = 0x1F,
+    MSG_SEARCH_MATCH      = 0x20,
+    MSG_SEARCH_END        = 0x21,
+    MSG_STATS             = 0x22,
+    MSG_STATS_OK          = 0x23,
+    MSG_INPUT_FLOW        = 0x24,
+    MSG_REPLAY_FD         = 0x25,
+    MSG_ATTACH_MANY       = 0x26,
+    MSG_ATTACH_MANY_OK    = 0x27,
+    MSG_INPUT_MULTI       = 0x28,
+    MSG_SET_TRIGGERS      = 0x29,
+    MSG_SET_TRIGGERS_OK   = 0x2A,
+    MSG_TRIGGER           = 0x2B,
+    MSG_SUBSCRIBE         = 0x2C,
+    MSG_SUBSCRIBE_OK      = 0x2D,
+    MSG_ACTIVITY          = 0x2E,
+    MSG_SESSION_EVENT     = 0x2F,
+    MSG_OUTPUT_GAP        = 0x30,
 };
 
+// Per-type counters are kept for message types below this
+inline constexpr size_t MSG_TYPE_SLOTS = 64;
+
+// Message type name for logs, traces and --stats (nullptr if unknown).
+inline const char *message_type_name(uint8_t type) {
+    switch (type) {
+    case MSG_CREATE:            return "CREATE";
+    case MSG_CREATE_OK:         return "CREATE_OK";
+    case MSG_ATTACH:            return "ATTACH";
+    case MSG_ATTACH_OK:         return "ATTACH_OK";
+    case MSG_REPLAY_DATA:       return "REPLAY_DATA";
+    case MSG_REPLAY_END:        return "REPLAY_END";
+    case MSG_DETACH:            return "DETACH";
+    case MSG_DETACH_OK:         return "DETACH_OK";
+    case MSG_DESTROY:           return "DESTROY";
+    case MSG_DESTROY_OK:        return "DESTROY_OK";
+    case MSG_RESIZE:            return "RESIZE";
+    case MSG_INPUT:             return "INPUT";
+    case MSG_OUTPUT:            return "OUTPUT";
+    case MSG_LIST:              return "LIST";
+    case MSG_LIST_OK:           return "LIST_OK";
+    case MSG_ERROR:             return "ERROR";
+    case MSG_SESSION_EXITED:    return "SESSION_EXITED";
+    case MSG_HELLO:             return "HELLO";
+    case MSG_HELLO_OK:          return "HELLO_OK";
+    case MSG_FG_PROCESS_QUERY:  return "FG_PROCESS_QUERY";
+    case MSG_FG_PROCESS_INFO:   return "FG_PROCESS_INFO";
+    case MSG_SEND_SIGNAL:       return "SEND_SIGNAL";
+    case MSG_SIGNAL_OK:         return "SIGNAL_OK";
+    case MSG_SET_TERMIOS:       return "SET_TERMIOS";
+    case MSG_FG_PROCESS_UPDATE: return "FG_PROCESS_UPDATE";
+    case MSG_PING:              return "PING";
+    case MSG_PONG:              return "PONG";
+    case MSG_REPLAY_RANGE:      return "REPLAY_RANGE";
+    case MSG_RANGE_DATA:        return "RANGE_DATA";
+    case MSG_RANGE_END:         return "RANGE_END";
+    case MSG_SEARCH:            return "SEARCH";
+    case MSG_SEARCH_MATCH:      return "SEARCH_MATCH";
+    case MSG_SEARCH_END:        return "SEARCH_END";
+    case MSG_STATS:             return "STATS";
+    case MSG_STATS_OK:          return "STATS_OK";
+    case MSG_INPUT_FLOW:        return "INPUT_FLOW";
+    case MSG_REPLAY_FD:         return "REPLAY_FD";
+    case MSG_ATTACH_MANY:       return "ATTACH_MANY";
+    case MSG_ATTACH_MANY_OK:    return "ATTACH_MANY_OK";
+    case MSG_INPUT_MULTI:       return "INPUT_MULTI";
+    case MSG_SET_TRIGGERS:      return "SET_TRIGGERS";
+    case MSG_SET_TRIGGERS_OK:   return "SET_TRIGGERS_OK";
+    case MSG_TRIGGER:           return "TRIGGER";
+    case MSG_SUBSCRIBE:         return "SUBSCRIBE";
+    case MSG_SUBSCRIBE_OK:      return "SUBSCRIBE_OK";
+    case MSG_ACTIVITY:          return "ACTIVITY";
+    case MSG_SESSION_EVENT:     return "SESSION_EVENT";
+    case MSG_OUTPUT_GAP:        return "OUTPUT_GAP";
+    default:                    return nullptr;
+    }
+}
+
 // -------------------------------------------------------------------
 // Error codes
 // -------------------------------------------------------------------
@@ -122,11 +220,329 @@ inline constexpr uint32_t CAP_PERSISTENT_TERMIOS  = (1u << 0);
 inline constexpr uint32_t CAP_FG_PROCESS_UPDATES  = (1u << 1);
 inline constexpr uint32_t CAP_SIGNAL_FORWARDING   = (1u << 2);
 inline constexpr uint32_t CAP_REPLAY_CHUNKED      = (1u << 3);
+inline constexpr uint32_t CAP_LIST_EXTENDED       = (1u << 4);
+inline constexpr uint32_t CAP_REPLAY_RANGE        = (1u << 5);
+inline constexpr uint32_t CAP_SEARCH              = (1u << 6);
+inline constexpr uint32_t CAP_STATS               = (1u << 7);
+inline constexpr uint32_t CAP_INPUT_FLOW          = (1u << 8);
+inline constexpr uint32_t CAP_RING_SIZE           = (1u << 9);
+inline constexpr uint32_t CAP_REPLAY_FD           = (1u << 10);
+inline constexpr uint32_t CAP_ATTACH_MANY         = (1u << 11);
+inline constexpr uint32_t CAP_INPUT_MULTI         = (1u << 12);
+inline constexpr uint32_t CAP_TRIGGERS            = (1u << 13);
+inline constexpr uint32_t CAP_ACTIVITY            = (1u << 14);
+inline constexpr uint32_t CAP_SESSION_EVENTS      = (1u << 15);
+inline constexpr uint32_t CAP_OBSERVE             = (1u << 16);
+inline constexpr uint32_t CAP_REPLAY_TRIM         = (1u << 17);
 
 // All capabilities supported by this daemon
 inline constexpr uint32_t DAEMON_CAPABILITIES =
     CAP_PERSISTENT_TERMIOS | CAP_FG_PROCESS_UPDATES |
-    CAP_SIGNAL_FORWARDING  | CAP_REPLAY_CHUNKED;
+    CAP_SIGNAL_FORWARDING  | CAP_REPLAY_CHUNKED |
+    CAP_LIST_EXTENDED      | CAP_REPLAY_RANGE |
+    CAP_SEARCH             | CAP_STATS |
+    CAP_INPUT_FLOW         | CAP_RING_SIZE |
+    CAP_REPLAY_FD          | CAP_ATTACH_MANY |
+    CAP_INPUT_MULTI        | CAP_TRIGGERS |
+    CAP_ACTIVITY           | CAP_SESSION_EVENTS |
+    CAP_OBSERVE            | CAP_REPLAY_TRIM;
+
+// -------------------------------------------------------------------
+// LIST_OK extension (CAP_LIST_EXTENDED)
+// -------------------------------------------------------------------
+// With CAP_LIST_EXTENDED negotiated, every LIST_OK entry is followed by
+// [2B ext_len][ext_len bytes]. Fields are only ever appended, so clients
+// read the ones they know and skip the rest using ext_len.
+//   [8B ring_capacity][8B ring_used]
+//   [8B history_bytes][8B history_stored_bytes]   (compression ratio = bytes / stored)
+//   [8B history_disk_bytes]                      (spilled segment files)
+//   [8B lines_written][8B ring_lines]            (newline counts)
+//   [8B last_output_at][4B bell_count]           (time_t, 0 = no output yet)
+//   [2B title_len][title][2B cwd_len][cwd]       (OSC 0/2 and OSC 7, may be empty)
+// LIST_EXT_SIZE covers the fixed-size fields.
+inline constexpr size_t LIST_EXT_SIZE = 8 + 8 + 8 + 8 + 8 + 8 + 8 + 8 + 4;
+
+// -------------------------------------------------------------------
+// Partial replay (CAP_REPLAY_RANGE)
+// -------------------------------------------------------------------
+// Scrollback positions are absolute output sequence numbers: byte N of
+// everything the session ever printed has sequence N. Under --compact-cr
+// they count the bytes kept: redraws are cut from a PTY read before it is
+// stored or sent as OUTPUT, so adding OUTPUT lengths to end_seq still
+// gives exact positions.
+//
+// ATTACH may carry a trailing [1B replay_mode][8B value]; ATTACH_OK then
+// gains [8B start_seq][8B end_seq][8B oldest_seq] describing what the
+// REPLAY_DATA stream covers and how far back older history goes.
+//
+// REPLAY_RANGE: [36B id][1B mode][8B value][8B end_seq][4B max_bytes]
+//   end_seq 0 = current end; max_bytes 0 = no limit. In line and byte
+//   modes an oversized range is cut from the front, in sequence mode
+//   from the back.
+// RANGE_DATA:   [36B id][8B seq][data]
+// RANGE_END:    [36B id][8B start_seq][8B end_seq][8B oldest_seq][8B newest_seq]
+enum ReplayMode : uint8_t {
+    REPLAY_FULL       = 0,   // Everything retained (ATTACH default)
+    REPLAY_TAIL_LINES = 1,   // value = number of lines before end_seq
+    REPLAY_TAIL_BYTES = 2,   // value = number of bytes before end_seq
+    REPLAY_NONE       = 3,   // Nothing (ATTACH only)
+    REPLAY_FROM_SEQ   = 4,   // value = start sequence (REPLAY_RANGE only)
+    REPLAY_TRIMMED    = 5,   // From the last safe point (ATTACH only, CAP_REPLAY_TRIM)
+};
+
+// -------------------------------------------------------------------
+// Trimmed replay (CAP_REPLAY_TRIM)
+// -------------------------------------------------------------------
+// REPLAY_TRIMMED sends only what rebuilds the current screen: the normal
+// screen since it was last cleared, without the output of full-screen
+// programs that have since exited, and for one still running, its setup
+// and everything since its last clear. The replay starts with the
+// sequences for the terminal modes in effect (mouse, bracketed paste,
+// cursor keys), since the output that set them may be skipped. The cuts
+// all fall on escape sequence boundaries.
+//
+// ATTACH_OK's replay_size counts what is sent and start_seq is where it
+// begins; older output stays available through REPLAY_RANGE. If the last
+// clear has scrolled out, the replay starts at a line boundary.
+// A client that did not negotiate CAP_REPLAY_TRIM gets a full replay.
+
+// -------------------------------------------------------------------
+// Replay through a shared file (CAP_REPLAY_FD)
+// -------------------------------------------------------------------
+// A ranged ATTACH may append [1B attach_flags]. With ATTACH_REPLAY_FD the
+// replay range is written to an anonymous file (a sealed memfd on Linux)
+// that arrives via SCM_RIGHTS on the first byte of
+// REPLAY_FD: [36B id][8B start_seq][8B length]
+// in place of REPLAY_DATA; REPLAY_END follows as usual. The client mmaps
+// the fd and closes it. Without fd support the daemon replays normally.
+enum AttachFlags : uint8_t {
+    ATTACH_REPLAY_FD = 0x01,
+    ATTACH_OBSERVE   = 0x02,   // Read-only, see CAP_OBSERVE
+};
+
+// -------------------------------------------------------------------
+// Read-only observers (CAP_OBSERVE)
+// -------------------------------------------------------------------
+// ATTACH or ATTACH_MANY with ATTACH_OBSERVE watches a session whether or
+// not another client owns it. Observers get the same ATTACH_OK, replay,
+// OUTPUT and SESSION_EXITED as the owner; INPUT, RESIZE, SEND_SIGNAL and
+// SET_TERMIOS from them fail with ERR_PERMISSION_DENIED, and DETACH ends
+// the observation. They don't count as attached (LIST, orphan timeout).
+//
+// A slow observer never pauses the session. Once more than
+// OBSERVER_MAX_BACKLOG is queued for it, its OUTPUT is dropped until the
+// backlog is down to OBSERVER_RESUME_BACKLOG, and then
+// OUTPUT_GAP: [36B id][8B from_seq][8B to_seq]
+// precedes the next OUTPUT. The missed bytes can be fetched with
+// REPLAY_RANGE while they are still in scrollback.
+inline constexpr size_t OBSERVER_MAX_BACKLOG    = 4 * 1024 * 1024;
+inline constexpr size_t OBSERVER_RESUME_BACKLOG = 256 * 1024;
+
+// -------------------------------------------------------------------
+// Batch attach (CAP_ATTACH_MANY)
+// -------------------------------------------------------------------
+// Restores a whole window in one round trip.
+// ATTACH_MANY:    [2B count] then per entry
+//                 [36B id][1B priority][1B replay_mode][8B value][1B attach_flags]
+// ATTACH_MANY_OK: [2B count] then per entry, in request order
+//                 [36B id][1B status][2B rows][2B cols]
+//                 [8B start_seq][8B end_seq][8B oldest_seq]
+//   status 0 = attached, otherwise an ErrorCode (nothing else follows for
+//   that entry). The attached sessions' replays then arrive exactly as
+//   after ATTACH (REPLAY_DATA or REPLAY_FD, REPLAY_END, SESSION_EXITED if
+//   dead), one session after another by ascending priority, so visible
+//   panes can go first.
+
+// -------------------------------------------------------------------
+// Scrollback search (CAP_SEARCH)
+// -------------------------------------------------------------------
+// SEARCH:       [4B request_id][1B flags][2B context][4B max_matches]
+//               [36B session_id][2B pattern_len][pattern]
+//   session_id is ignored with SEARCH_ALL_SESSIONS; max_matches 0 means
+//   SEARCH_DEFAULT_MATCHES and larger values are capped at
+//   SEARCH_MAX_MATCHES. A client runs one search at a time: SEARCH before
+//   the previous one's SEARCH_END fails with ERR_SESSION_BUSY.
+//   Results arrive asynchronously:
+// SEARCH_MATCH: [4B request_id][36B session_id][8B seq][4B match_len]
+//               [8B line][8B context_seq][2B context_len][context]
+//   line counts from the start of the session's retained scrollback.
+// SEARCH_END:   [4B request_id][4B match_count][1B status]
+enum SearchFlags : uint8_t {
+    SEARCH_REGEX        = 0x01,   // POSIX extended regex (default: literal)
+    SEARCH_IGNORE_CASE  = 0x02,
+    SEARCH_ALL_SESSIONS = 0x04,   // Every session, in LIST order
+};
+
+enum SearchStatus : uint8_t {
+    SEARCH_COMPLETE     = 0,
+    SEARCH_TRUNCATED    = 1,      // Stopped at max_matches
+    SEARCH_BAD_PATTERN  = 2,
+};
+
+inline constexpr uint32_t SEARCH_DEFAULT_MATCHES = 1000;
+inline constexpr uint32_t SEARCH_MAX_MATCHES = 10000;
+inline constexpr uint16_t SEARCH_MAX_CONTEXT = 1024;
+
+// -------------------------------------------------------------------
+// Per-session ring size (CAP_RING_SIZE)
+// -------------------------------------------------------------------
+// CREATE may carry a trailing [4B ring_size] after rows/cols: the session's
+// scrollback ring in bytes, clamped to [MIN_RING_BUFFER_SIZE,
+// MAX_RING_BUFFER_SIZE]; 0 means the daemon's --buffer-size. Under a
+// --ring-budget the rings of the longest-detached sessions may later be
+// shrunk (down to RING_SHRINK_FLOOR); LIST_EXTENDED reports the current
+// capacity, and a ring grows back to its requested size on ATTACH.
+
+// -------------------------------------------------------------------
+// Input flow control (CAP_INPUT_FLOW)
+// -------------------------------------------------------------------
+// INPUT the PTY can't take yet is queued per session and written as the
+// master becomes writable, so nothing is dropped. Once a session's queue
+// passes INPUT_QUEUE_HIGH the daemon sends INPUT_FLOW paused=1 and, after
+// it drains below INPUT_QUEUE_LOW, paused=0:
+// INPUT_FLOW: [36B session_id][1B paused]
+// A client that keeps sending regardless (or lacks the capability) is
+// throttled: past INPUT_QUEUE_MAX the daemon stops reading its socket
+// until the queue drains.
+inline constexpr size_t INPUT_QUEUE_HIGH = 256 * 1024;
+inline constexpr size_t INPUT_QUEUE_LOW  = 64 * 1024;
+inline constexpr size_t INPUT_QUEUE_MAX  = 4 * 1024 * 1024;
+
+// -------------------------------------------------------------------
+// Input broadcast (CAP_INPUT_MULTI)
+// -------------------------------------------------------------------
+// One payload for several sessions (synchronized panes), each written and
+// queued exactly like its own INPUT:
+// INPUT_MULTI: [2B count][count x 36B session_id][raw_bytes]
+// Unknown ids are skipped and answered with a single ERROR.
+
+// -------------------------------------------------------------------
+// Output triggers (CAP_TRIGGERS)
+// -------------------------------------------------------------------
+// Patterns matched against a session's PTY output as it is read, whether
+// or not anyone is attached. SET_TRIGGERS replaces the session's set
+// (count 0 clears it); events go to the client that set it until that
+// client disconnects.
+// SET_TRIGGERS:    [36B session_id][2B count] then per trigger
+//                  [4B trigger_id][1B flags][2B pattern_len][pattern]
+// SET_TRIGGERS_OK: [36B session_id][1B status][2B index]
+//   index names the offending trigger when status != TRIGGERS_OK; the
+//   previous set then stays in place.
+// TRIGGER:         [36B session_id][4B trigger_id][8B seq][4B match_len]
+//                  [4B suppressed][8B context_seq][2B context_len][context]
+//   context is the matching line (as much of it as has been read), at
+//   most TRIGGER_MAX_CONTEXT bytes. A trigger fires at most once per
+//   TRIGGER_COOLDOWN_MS; suppressed counts the hits dropped since its
+//   previous event.
+//
+// Regex triggers are POSIX extended regexes matched within one line, and
+// must contain a literal of at least TRIGGER_MIN_LITERAL bytes outside
+// any group, bracket or optional atom, with no top-level alternation:
+// "error: .*not found" works, "(warn|err)" does not. The literal
+// selects the lines the regex is run on.
+enum TriggerFlags : uint8_t {
+    TRIGGER_REGEX       = 0x01,
+    TRIGGER_IGNORE_CASE = 0x02,
+    TRIGGER_ONCE        = 0x04,   // Disarm after the first event
+};
+
+enum TriggerStatus : uint8_t {
+    TRIGGERS_OK          = 0,
+    TRIGGERS_BAD_PATTERN = 1,
+    TRIGGERS_TOO_MANY    = 2,
+};
+
+inline constexpr size_t   TRIGGER_MAX_COUNT   = 32;     // Per session
+inline constexpr size_t   TRIGGER_MAX_PATTERN = 256;
+inline constexpr size_t   TRIGGER_MIN_LITERAL = 2;
+inline constexpr size_t   TRIGGER_MAX_LINE    = 4096;   // Longest line a regex is run on
+inline constexpr uint16_t TRIGGER_MAX_CONTEXT = 256;
+inline constexpr unsigned TRIGGER_COOLDOWN_MS = 1000;
+
+// -------------------------------------------------------------------
+// Activity monitoring (CAP_ACTIVITY)
+// -------------------------------------------------------------------
+// Output, bells and silence of sessions a client isn't rendering.
+// SUBSCRIBE:    [1B events][4B quiet_ms]
+//   events is a mask of SubscribeEvents (0 unsubscribes); quiet_ms is how
+//   long without output makes a session quiet, 0 = ACTIVITY_DEFAULT_QUIET_MS.
+// SUBSCRIBE_OK: [1B events][4B quiet_ms][8B session_version]   (as applied)
+// ACTIVITY:     [36B session_id][1B kind][8B last_output_at][4B bell_count]
+//   ACTIVITY_OUTPUT when a quiet session prints again, ACTIVITY_SILENCE
+//   once it has been quiet for quiet_ms, ACTIVITY_BELL for a BEL (at most
+//   one event per ACTIVITY_BELL_INTERVAL_MS; bell_count is the total).
+//   BELs that terminate an OSC sequence (window titles) don't count.
+//   Sessions attached to the subscriber itself are left out.
+enum SubscribeEvents : uint8_t {
+    SUBSCRIBE_ACTIVITY = 0x01,
+    SUBSCRIBE_SESSIONS = 0x02,   // SESSION_EVENT (CAP_SESSION_EVENTS)
+};
+
+enum ActivityKind : uint8_t {
+    ACTIVITY_OUTPUT  = 1,
+    ACTIVITY_BELL    = 2,
+    ACTIVITY_SILENCE = 3,
+};
+
+inline constexpr uint32_t ACTIVITY_DEFAULT_QUIET_MS = 5000;
+inline constexpr uint32_t ACTIVITY_MIN_QUIET_MS     = 100;
+inline constexpr unsigned ACTIVITY_BELL_INTERVAL_MS = 1000;
+// How far back a BEL is checked for an opening ESC ]
+inline constexpr size_t   OSC_MAX_LOOKBACK          = 512;
+
+// -------------------------------------------------------------------
+// Session list events (CAP_SESSION_EVENTS)
+// -------------------------------------------------------------------
+// With SUBSCRIBE_SESSIONS a client mirrors the session list instead of
+// polling LIST. Every change bumps a daemon-wide version:
+// SESSION_EVENT: [8B version][1B kind][36B session_id][kind data]
+//   CREATED   a LIST_OK entry (without the id, extended as negotiated)
+//   REMOVED   -
+//   ATTACHED  -
+//   DETACHED  [8B detached_at]
+//   EXITED    [4B exit_code]
+//   RESIZED   [2B rows][2B cols]
+//   TITLE     [2B len][title]
+//   CWD       [2B len][cwd]
+// With this capability LIST_OK ends with [8B session_version]: events
+// up to it are included, later ones apply on top. A client whose socket
+// is backed up by more than SESSION_EVENT_MAX_BACKLOG misses events; the
+// gap in versions tells it to LIST again.
+enum SessionEventKind : uint8_t {
+    SESSION_EVENT_CREATED  = 1,
+    SESSION_EVENT_REMOVED  = 2,
+    SESSION_EVENT_ATTACHED = 3,
+    SESSION_EVENT_DETACHED = 4,
+    SESSION_EVENT_EXITED   = 5,
+    SESSION_EVENT_RESIZED  = 6,
+    SESSION_EVENT_TITLE    = 7,
+    SESSION_EVENT_CWD      = 8,
+};
+
+inline constexpr size_t SESSION_EVENT_MAX_BACKLOG = 1024 * 1024;
+
+// -------------------------------------------------------------------
+// Telemetry (CAP_STATS)
+// -------------------------------------------------------------------
+// STATS has an empty payload. STATS_OK is four sections; every record is
+// prefixed with its own [2B len] and fields are only ever appended.
+//   daemon:   [2B len][8B uptime_ms][8B loop_iterations][8B rss_bytes]
+//             [4B sessions][4B clients][8B spill_disk_bytes]
+//             [8B ring_bytes][8B ring_budget]   (budget 0 = unlimited)
+//   sessions: [2B count] then per session
+//             [2B len][36B id][8B pty_bytes_read][8B pty_bytes_written]
+//             [8B ring_used][8B ring_capacity]
+//             [8B ring_overwritten]   (bytes pushed out of the ring by new
+//             output or a smaller ring size)
+//             [4B flow_pauses][8B flow_paused_ms][8B input_queued]
+//             [8B cr_compacted]   (bytes cut by --compact-cr, never sent)
+//   clients:  [2B count] then per client
+//             [2B len][4B fd][4B pid][8B bytes_in][8B bytes_out]
+//             [8B send_buf_bytes][8B send_buf_high_water][4B congestion_events]
+//             [1B n] then n x [1B msg_type][8B received]
+//   latency:  [2B count] then per histogram (nanoseconds)
+//             [2B len][1B kind][1B msg_type][8B count][8B p50][8B p90]
+//             [8B p99][8B p999][8B max]    (kind: LatencyKind in latency.h)
 
 // -------------------------------------------------------------------
 // Wire format helpers (little-endian)
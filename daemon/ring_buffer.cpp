@@ -20,50 +20,257 @@
 */
 
 #include "ring_buffer.h"
+#include "log.h"
+#include "newline_scan.h"
+#include "secure_mem.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-// Use memset_s for secure deletion where available
-#if defined(__STDC_LIB_EXT1__) || defined(__APPLE__)
-#define HAVE_MEMSET_S 1
-#else
-#define HAVE_MEMSET_S 0
-#endif
-
-static void secure_zero(void *ptr, size_t len) {
-#if HAVE_MEMSET_S
-    memset_s(ptr, len, 0, len);
-#else
-    volatile uint8_t *p = static_cast<volatile uint8_t *>(ptr);
-    while (len--)
-        *p++ = 0;
-#endif
+RingBuffer::RingBuffer()
+    : _buf(nullptr), _capacity(0), _head(0), _used(0), _sequence(0), _overwritten(0),
+      _header(nullptr), _map_len(0), _fd(-1), _evict(nullptr), _evict_ctx(nullptr),
+      _lines(0)
+{
 }
 
 RingBuffer::RingBuffer(size_t capacity)
-    : _buf(nullptr), _capacity(capacity), _head(0), _used(0)
+    : RingBuffer()
 {
+    _capacity = capacity;
     if (_capacity > 0)
         _buf = static_cast<uint8_t *>(malloc(_capacity));
 }
 
+RingBuffer::RingBuffer(size_t capacity, const std::string &backing_path)
+    : RingBuffer()
+{
+    _capacity = capacity;
+    if (_capacity == 0)
+        return;
+
+    // O_EXCL + O_NOFOLLOW: never reuse or follow a pre-existing file
+    int fd = open(backing_path.c_str(),
+                  O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("cannot create ring file %s: %s",
+                  backing_path.c_str(), strerror(errno));
+        return;
+    }
+
+    size_t map_len = RING_FILE_HEADER_SIZE + _capacity;
+    if (ftruncate(fd, static_cast<off_t>(map_len)) != 0 || !mapFile(fd, map_len)) {
+        LOG_ERROR("cannot size/map ring file %s: %s",
+                  backing_path.c_str(), strerror(errno));
+        close(fd);
+        unlink(backing_path.c_str());
+        return;
+    }
+    _path = backing_path;
+
+    memcpy(_header->magic, RING_FILE_MAGIC, sizeof(_header->magic));
+    _header->version = RING_FILE_VERSION;
+    _header->header_size = RING_FILE_HEADER_SIZE;
+    _header->capacity = _capacity;
+    _header->daemon_pid = getpid();
+    syncHeader();
+}
+
+RingBuffer *RingBuffer::recover(const std::string &backing_path) {
+    int fd = open(backing_path.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid() ||
+        static_cast<size_t>(st.st_size) <= RING_FILE_HEADER_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+
+    RingFileHeader hdr;
+    if (pread(fd, &hdr, sizeof(hdr), 0) != static_cast<ssize_t>(sizeof(hdr)) ||
+        memcmp(hdr.magic, RING_FILE_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != RING_FILE_VERSION ||
+        hdr.header_size != RING_FILE_HEADER_SIZE ||
+        hdr.capacity == 0 ||
+        hdr.capacity != static_cast<uint64_t>(st.st_size) - RING_FILE_HEADER_SIZE ||
+        hdr.head >= hdr.capacity || hdr.used > hdr.capacity) {
+        LOG_WARN("ignoring malformed ring file %s", backing_path.c_str());
+        close(fd);
+        return nullptr;
+    }
+
+    RingBuffer *ring = new (std::nothrow) RingBuffer();
+    if (!ring) {
+        close(fd);
+        return nullptr;
+    }
+    if (!ring->mapFile(fd, static_cast<size_t>(st.st_size))) {
+        close(fd);
+        delete ring;
+        return nullptr;
+    }
+    ring->_path = backing_path;
+    ring->_capacity = static_cast<size_t>(hdr.capacity);
+    ring->_head = static_cast<size_t>(hdr.head);
+    ring->_used = static_cast<size_t>(hdr.used);
+    ring->_sequence = hdr.sequence;
+    ring->_overwritten = ring->oldestSequence();
+
+    // Line numbers restart at the recovered data
+    const uint8_t *p1, *p2;
+    size_t len1, len2;
+    ring->readAll(&p1, &len1, &p2, &len2);
+    ring->indexLines(p1, len1, ring->oldestSequence());
+    ring->indexLines(p2, len2, ring->oldestSequence() + len1);
+    ring->_header->daemon_pid = getpid();
+    return ring;
+}
+
+bool RingBuffer::mapFile(int fd, size_t map_len) {
+    void *p = mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    _fd = fd;
+    _map_len = map_len;
+    _header = static_cast<RingFileHeader *>(p);
+    _buf = static_cast<uint8_t *>(p) + RING_FILE_HEADER_SIZE;
+    return true;
+}
+
+// Mirror ring state into the mapped header: plain stores, no msync.
+void RingBuffer::syncHeader() {
+    if (!_header)
+        return;
+    _header->head = _head;
+    _header->used = _used;
+    _header->sequence = _sequence;
+}
+
+void RingBuffer::setFileMetadata(const char *session_id, const char *shell,
+                                 const char *cwd, time_t created_at) {
+    if (!_header)
+        return;
+    strncpy(_header->session_id, session_id ? session_id : "",
+            sizeof(_header->session_id) - 1);
+    strncpy(_header->shell, shell ? shell : "", sizeof(_header->shell) - 1);
+    strncpy(_header->cwd, cwd ? cwd : "", sizeof(_header->cwd) - 1);
+    _header->created_at = static_cast<int64_t>(created_at);
+}
+
 RingBuffer::~RingBuffer() {
-    if (_buf) {
+    if (_header) {
+        // Zero the whole mapping and push the zeros to the file before
+        // unlinking, so no scrollback lingers in freed disk blocks.
+        secure_zero(_header, _map_len);
+        msync(_header, _map_len, MS_SYNC);
+        munmap(_header, _map_len);
+        if (ftruncate(_fd, 0) != 0)
+            LOG_WARN("ftruncate on ring file failed: %s", strerror(errno));
+        close(_fd);
+        unlink(_path.c_str());
+    } else if (_buf) {
+        secure_zero(_buf, _capacity);
+        free(_buf);
+    }
+}
+
+bool RingBuffer::resize(size_t capacity) {
+    if (capacity == _capacity)
+        return true;
+    if (capacity == 0 || !_buf)
+        return false;
+
+    // Allocate before evicting, so a failure leaves sink and ring consistent.
+    // File-backed rings need it too: it is where the data goes if the file
+    // can't be mapped again.
+    size_t keep = std::min(_used, capacity);
+    uint8_t *next = static_cast<uint8_t *>(malloc(capacity));
+    if (!next)
+        return false;
+    if (_evict && _used > keep)
+        evictOldest(_used - keep);
+
+    const uint8_t *p1, *p2;
+    size_t len1, len2;
+    readRange(_sequence - keep, keep, &p1, &len1, &p2, &len2);
+    memcpy(next, p1, len1);
+    if (len2)
+        memcpy(next + len1, p2, len2);
+
+    if (_header) {
+        // Copy out, resize the file, map it again and copy back. Old data is
+        // zeroed on disk first, as in the destructor.
+        secure_zero(_buf, _capacity);
+        msync(_header, _map_len, MS_SYNC);
+        munmap(_header, _map_len);
+        _header = nullptr;
+        _buf = nullptr;
+        size_t map_len = RING_FILE_HEADER_SIZE + capacity;
+        if (ftruncate(_fd, static_cast<off_t>(map_len)) != 0 || !mapFile(_fd, map_len)) {
+            // Keep the session going on an in-memory ring instead
+            LOG_ERROR("cannot resize ring file %s: %s", _path.c_str(), strerror(errno));
+            close(_fd);
+            unlink(_path.c_str());
+            _fd = -1;
+            _map_len = 0;
+            _path.clear();
+            _buf = next;
+        } else {
+            _header->capacity = capacity;
+            memcpy(_buf, next, keep);
+            secure_zero(next, keep);
+            free(next);
+        }
+    } else {
         secure_zero(_buf, _capacity);
         free(_buf);
+        _buf = next;
     }
+
+    _capacity = capacity;
+    _overwritten += _used - keep;
+    _used = keep;
+    _head = keep % capacity;
+    while (!_line_index.empty() && _line_index.front().seq < oldestSequence())
+        _line_index.pop_front();
+    syncHeader();
+    return true;
 }
 
 void RingBuffer::write(const uint8_t *data, size_t len) {
     if (!_buf || _capacity == 0 || len == 0)
         return;
 
+    if (_used + len > _capacity)
+        _overwritten += _used + len - _capacity;
+    if (_evict) {
+        if (_used + len > _capacity)
+            evictOldest(std::min(_used, _used + len - _capacity));
+        // Bytes of an oversized write that never make it into the ring
+        if (len > _capacity)
+            _evict(_evict_ctx, _sequence, data, len - _capacity);
+    }
+
+    indexLines(data, len, _sequence);
+    _sequence += len;
+
     // If writing more than capacity, only keep the last _capacity bytes
     if (len >= _capacity) {
         memcpy(_buf, data + len - _capacity, _capacity);
         _head = 0;
         _used = _capacity;
+        while (!_line_index.empty() && _line_index.front().seq < oldestSequence())
+            _line_index.pop_front();
+        syncHeader();
         return;
     }
 
@@ -80,6 +287,89 @@ void RingBuffer::write(const uint8_t *data, size_t len) {
     _used += len;
     if (_used > _capacity)
         _used = _capacity;
+    while (!_line_index.empty() && _line_index.front().seq < oldestSequence())
+        _line_index.pop_front();
+    syncHeader();
+}
+
+// Count newlines in data (which starts at sequence seq) and checkpoint
+// every LINE_INDEX_STRIDE-th one.
+void RingBuffer::indexLines(const uint8_t *data, size_t len, uint64_t seq) {
+    if (len == 0)
+        return;
+    uint64_t count = count_newlines(data, len);
+    uint64_t to_next = LINE_INDEX_STRIDE - _lines % LINE_INDEX_STRIDE;
+    size_t off = 0;
+
+    while (count >= to_next) {
+        off += find_nth_newline(data + off, len - off, static_cast<size_t>(to_next)) + 1;
+        _lines += to_next;
+        count -= to_next;
+        _line_index.push_back(LineCheckpoint{_lines, seq + off});
+        to_next = LINE_INDEX_STRIDE;
+    }
+    _lines += count;
+}
+
+uint64_t RingBuffer::countLines(uint64_t from, uint64_t to) const {
+    if (to <= from)
+        return 0;
+    const uint8_t *p1, *p2;
+    size_t len1, len2;
+    readRange(from, static_cast<size_t>(to - from), &p1, &len1, &p2, &len2);
+    return count_newlines(p1, len1) + count_newlines(p2, len2);
+}
+
+uint64_t RingBuffer::lineNumberAt(uint64_t seq) const {
+    uint64_t oldest = oldestSequence();
+    seq = std::min(std::max(seq, oldest), _sequence);
+
+    // Last checkpoint at or before seq, then at most a stride of lines
+    auto it = std::upper_bound(_line_index.begin(), _line_index.end(), seq,
+                               [](uint64_t s, const LineCheckpoint &cp) { return s < cp.seq; });
+    if (it != _line_index.begin()) {
+        --it;
+        return it->line + countLines(it->seq, seq);
+    }
+    // Before the first checkpoint: count back from it (or from the end)
+    if (!_line_index.empty())
+        return _line_index.front().line - countLines(seq, _line_index.front().seq);
+    return _lines - countLines(seq, _sequence);
+}
+
+bool RingBuffer::lineStart(uint64_t line, uint64_t *seq) const {
+    if (line == 0 || line > _lines)
+        return false;
+
+    auto it = std::upper_bound(_line_index.begin(), _line_index.end(), line,
+                               [](uint64_t l, const LineCheckpoint &cp) { return l < cp.line; });
+    uint64_t base_line, base_seq;
+    if (it != _line_index.begin()) {
+        --it;
+        if (it->line == line) {
+            *seq = it->seq;
+            return true;
+        }
+        base_line = it->line;
+        base_seq = it->seq;
+    } else {
+        base_seq = oldestSequence();
+        base_line = lineNumberAt(base_seq);
+        if (line <= base_line)
+            return false;
+    }
+
+    const uint8_t *p1, *p2;
+    size_t len1, len2;
+    readRange(base_seq, static_cast<size_t>(_sequence - base_seq), &p1, &len1, &p2, &len2);
+    size_t n = static_cast<size_t>(line - base_line);
+    size_t in1 = count_newlines(p1, len1);
+    if (n <= in1) {
+        *seq = base_seq + find_nth_newline(p1, len1, n) + 1;
+    } else {
+        *seq = base_seq + len1 + find_nth_newline(p2, len2, n - in1) + 1;
+    }
+    return true;
 }
 
 void RingBuffer::readAll(const uint8_t **p1, size_t *len1,
@@ -90,13 +380,8 @@ void RingBuffer::readAll(const uint8_t **p1, size_t *len1,
         return;
     }
 
-    // Start of readable data
-    size_t start;
-    if (_used < _capacity) {
-        start = 0;
-    } else {
-        start = _head; // oldest data starts where next write would go
-    }
+    // Start of readable data: the oldest byte, _used behind the next write
+    size_t start = (_head + _capacity - _used) % _capacity;
 
     if (start + _used <= _capacity) {
         // No wrap: single contiguous segment
@@ -113,14 +398,56 @@ void RingBuffer::readAll(const uint8_t **p1, size_t *len1,
     }
 }
 
-uint8_t RingBuffer::byteAt(size_t offset) const {
-    size_t start;
-    if (_used < _capacity)
-        start = 0;
-    else
-        start = _head;
+// Hand the n oldest bytes to the eviction sink (ring state is not changed;
+// the caller overwrites them).
+void RingBuffer::evictOldest(size_t n) {
+    size_t start = (_head + _capacity - _used) % _capacity;
+    uint64_t seq = _sequence - _used;
+    size_t first = std::min(n, _capacity - start);
+    _evict(_evict_ctx, seq, _buf + start, first);
+    if (n > first)
+        _evict(_evict_ctx, seq + first, _buf, n - first);
+}
+
+size_t RingBuffer::readRange(uint64_t seq, size_t len,
+                             const uint8_t **p1, size_t *len1,
+                             const uint8_t **p2, size_t *len2) const {
+    readAll(p1, len1, p2, len2);
 
-    return _buf[(start + offset) % _capacity];
+    // Clamp to the retained window
+    uint64_t oldest = oldestSequence();
+    if (seq < oldest || seq >= _sequence || len == 0) {
+        *len1 = 0;
+        *len2 = 0;
+        return 0;
+    }
+    size_t skip = static_cast<size_t>(seq - oldest);
+    len = std::min(len, _used - skip);
+
+    if (skip >= *len1) {
+        // Range lies entirely in the second segment
+        *p1 = *p2 + (skip - *len1);
+        *len1 = len;
+        *len2 = 0;
+    } else {
+        *p1 += skip;
+        *len1 -= skip;
+        if (len <= *len1) {
+            *len1 = len;
+            *len2 = 0;
+        } else {
+            *len2 = len - *len1;
+        }
+    }
+    return len;
+}
+
+uint8_t RingBuffer::byteAt(size_t offset) const {
+    size_t start = (_head + _capacity - _used) % _capacity;
+    size_t pos = start + offset;
+    if (pos >= _capacity)
+        pos -= _capacity;
+    return _buf[pos];
 }
 
 size_t RingBuffer::findUtf8Boundary(size_t offset) const {
@@ -143,4 +470,6 @@ void RingBuffer::clear() {
         secure_zero(_buf, _capacity);
     _head = 0;
     _used = 0;
+    _line_index.clear();
+    syncHeader();
 }
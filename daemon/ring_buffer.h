@@ -21,30 +21,97 @@
 
 // Fixed-capacity circular byte buffer for storing terminal output.
 // Supports wrap-around writes, two-segment reads, and secure deletion.
+// Optionally backed by an mmap'd file so scrollback survives a daemon crash.
 
 #ifndef CRT_SESSIOND_RING_BUFFER_H
 #define CRT_SESSIOND_RING_BUFFER_H
 
 #include <cstddef>
 #include <cstdint>
+#include <ctime>
+#include <deque>
+#include <string>
+
+// On-disk layout of a file-backed ring: one header page followed by
+// `capacity` bytes of ring data. Fields are native-endian; the file never
+// leaves the machine that wrote it. head/used/sequence are updated with
+// plain stores after every write (no msync), so after a crash they may lag
+// the data by at most one PTY read.
+inline constexpr char     RING_FILE_MAGIC[8]   = {'C', 'R', 'T', 'R', 'I', 'N', 'G', '\0'};
+inline constexpr uint32_t RING_FILE_VERSION    = 1;
+inline constexpr size_t   RING_FILE_HEADER_SIZE = 4096;
+
+// One line index checkpoint per this many newlines
+inline constexpr uint64_t LINE_INDEX_STRIDE = 64;
+
+struct RingFileHeader {
+    char     magic[8];            // RING_FILE_MAGIC
+    uint32_t version;             // RING_FILE_VERSION
+    uint32_t header_size;         // RING_FILE_HEADER_SIZE
+    uint64_t capacity;            // Ring data size in bytes
+    uint64_t head;                // Next write position
+    uint64_t used;                // Bytes stored
+    uint64_t sequence;            // Sequence number of the next byte written
+    int64_t  daemon_pid;          // PID of the daemon that owns the file
+    int64_t  created_at;          // Session creation time
+    char     session_id[40];      // Session UUID (null-terminated)
+    char     shell[1024];         // Shell path (truncated, null-terminated)
+    char     cwd[1024];           // Initial cwd (truncated, null-terminated)
+};
+static_assert(sizeof(RingFileHeader) <= RING_FILE_HEADER_SIZE,
+              "ring file header must fit in its page");
 
 class RingBuffer {
 public:
+    // Receives bytes that are about to leave the ring, oldest first.
+    // seq is the absolute sequence number of data[0].
+    typedef void (*EvictionSink)(void *ctx, uint64_t seq, const uint8_t *data, size_t len);
+
     explicit RingBuffer(size_t capacity);
+
+    // File-backed ring: creates backing_path (O_EXCL, mode 0600) and maps it.
+    // The file is secure-cleared and unlinked when the ring is destroyed.
+    RingBuffer(size_t capacity, const std::string &backing_path);
+
     ~RingBuffer();
 
+    // Map an existing ring file left behind by a crashed daemon.
+    // Returns nullptr if the file is missing, foreign, or malformed.
+    static RingBuffer *recover(const std::string &backing_path);
+
     // Non-copyable
     RingBuffer(const RingBuffer &) = delete;
     RingBuffer &operator=(const RingBuffer &) = delete;
 
     // Write data into the buffer. Wraps around, overwriting oldest data.
+    // Overwritten bytes are handed to the eviction sink first, if set.
     void write(const uint8_t *data, size_t len);
 
+    // Install (or clear, with fn == nullptr) the eviction sink.
+    void setEvictionSink(EvictionSink fn, void *ctx) { _evict = fn; _evict_ctx = ctx; }
+
     // Get readable data as up to two contiguous segments (handles wrap-around).
     // p1/len1 is the first segment, p2/len2 is the second (may be zero).
     void readAll(const uint8_t **p1, size_t *len1,
                  const uint8_t **p2, size_t *len2) const;
 
+    // Get [seq, seq + len) as up to two contiguous segments, clamped to the
+    // readable data. Returns the number of bytes covered (len1 + len2).
+    size_t readRange(uint64_t seq, size_t len,
+                     const uint8_t **p1, size_t *len1,
+                     const uint8_t **p2, size_t *len2) const;
+
+    // Line index. Line numbers count newlines written since the ring was
+    // created (or recovered): lineNumberAt(seq) is the number of '\n'
+    // bytes before seq, for seq in [oldestSequence(), sequence()].
+    uint64_t lineCount() const { return _lines; }
+    uint64_t lineNumberAt(uint64_t seq) const;
+    uint64_t retainedLines() const { return _lines - lineNumberAt(oldestSequence()); }
+
+    // Sequence number of the byte after the line-th newline (line >= 1).
+    // Returns false if that newline is no longer retained.
+    bool lineStart(uint64_t line, uint64_t *seq) const;
+
     // Find a valid UTF-8 lead byte boundary starting from the given offset
     // into the readable data. Skips at most 3 continuation bytes.
     // Returns the adjusted offset.
@@ -53,16 +120,63 @@ public:
     // Secure-clear and reset.
     void clear();
 
+    // Change the capacity, keeping the newest data that fits. Bytes dropped
+    // from the front go to the eviction sink first. File-backed rings are
+    // resized in place, or carry on in memory if the file can't be mapped
+    // again. Returns false, leaving the ring untouched, if the new storage
+    // can't be allocated.
+    bool resize(size_t capacity);
+
+    // Record session metadata in the file header (no-op for in-memory rings).
+    void setFileMetadata(const char *session_id, const char *shell,
+                         const char *cwd, time_t created_at);
+
+    // Header of a file-backed ring (nullptr for in-memory rings).
+    const RingFileHeader *fileHeader() const { return _header; }
+
     size_t capacity() const { return _capacity; }
     size_t used() const { return _used; }
+    uint64_t sequence() const { return _sequence; }
+    uint64_t oldestSequence() const { return _sequence - _used; }
+    uint64_t overwritten() const { return _overwritten; }
     bool empty() const { return _used == 0; }
     bool valid() const { return _buf != nullptr || _capacity == 0; }
+    bool fileBacked() const { return _header != nullptr; }
 
 private:
+    RingBuffer();
+
     uint8_t *_buf;
     size_t _capacity;
     size_t _head;  // next write position
     size_t _used;  // current bytes stored
+    uint64_t _sequence;  // total bytes written
+    uint64_t _overwritten;  // bytes dropped from the front (writes, shrinking)
+
+    // File backing (mmap); _header is null for in-memory rings
+    RingFileHeader *_header;
+    size_t _map_len;
+    int _fd;
+    std::string _path;
+
+    EvictionSink _evict;
+    void *_evict_ctx;
+
+    // Checkpoint every LINE_INDEX_STRIDE-th newline; entries whose line
+    // start has been overwritten are dropped from the front on write.
+    struct LineCheckpoint {
+        uint64_t line;  // newline number (multiple of the stride)
+        uint64_t seq;   // first byte after that newline
+    };
+    std::deque<LineCheckpoint> _line_index;
+    uint64_t _lines;  // newlines written
+
+    void indexLines(const uint8_t *data, size_t len, uint64_t seq);
+    uint64_t countLines(uint64_t from, uint64_t to) const;
+
+    bool mapFile(int fd, size_t map_len);
+    void syncHeader();
+    void evictOldest(size_t n);
 
     // Read a byte at a given offset into the readable data (0 = oldest).
     uint8_t byteAt(size_t offset) const;
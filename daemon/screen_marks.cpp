@@ -0,0 +1,247 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "screen_marks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+enum ParseResult { SEQ_DONE, SEQ_INCOMPLETE, SEQ_SKIP };
+
+// Parse the escape sequence at p (p[0] == ESC). SEQ_DONE sets *len;
+// SEQ_SKIP means it can't be one we track (skip the ESC).
+ParseResult parse_sequence(const uint8_t *p, size_t avail, size_t *len) {
+    if (avail < 2)
+        return SEQ_INCOMPLETE;
+    if (p[1] == 'c') {
+        *len = 2;
+        return SEQ_DONE;
+    }
+    if (p[1] != '[')
+        return SEQ_SKIP;
+    size_t limit = std::min(avail, SCREEN_MARK_MAX_SEQUENCE);
+    for (size_t i = 2; i < limit; i++) {
+        if (p[i] >= 0x40 && p[i] <= 0x7E) {
+            *len = i + 1;
+            return SEQ_DONE;
+        }
+        if (p[i] < 0x20 || p[i] > 0x3F)
+            return SEQ_SKIP;
+    }
+    return avail < SCREEN_MARK_MAX_SEQUENCE ? SEQ_INCOMPLETE : SEQ_SKIP;
+}
+
+bool params_are(const uint8_t *params, size_t n, const char *const *options) {
+    for (; *options; options++) {
+        if (strlen(*options) == n && memcmp(params, *options, n) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Record set/reset of tracked modes; true if any parameter selects the
+// alternate screen
+bool private_modes(ScreenMarks &m, const uint8_t *params, size_t n, bool set) {
+    bool alt = false;
+    size_t start = 0;
+    for (size_t i = 0; i <= n; i++) {
+        if (i < n && params[i] != ';')
+            continue;
+        unsigned mode = 0;
+        for (size_t k = start; k < i && mode < 100000; k++)
+            mode = mode * 10 + static_cast<unsigned>(params[k] - '0');
+        if (mode == 1049 || mode == 1047 || mode == 47)
+            alt = true;
+        for (size_t b = 0; b < sizeof(SCREEN_TRACKED_MODES) / sizeof(SCREEN_TRACKED_MODES[0]); b++) {
+            if (SCREEN_TRACKED_MODES[b] != mode)
+                continue;
+            m.modes_seen |= static_cast<uint16_t>(1u << b);
+            if (set)
+                m.modes_set |= static_cast<uint16_t>(1u << b);
+            else
+                m.modes_set &= static_cast<uint16_t>(~(1u << b));
+        }
+        start = i + 1;
+    }
+    return alt;
+}
+
+void mark_clear(ScreenMarks &m, uint64_t seq) {
+    if (m.in_alt) {
+        if (m.alt_clear == SCREEN_MARK_NONE)
+            m.alt_first_clear = seq;
+        m.alt_clear = seq;
+    } else {
+        m.primary_clear = seq;
+        m.alt_spans.clear();
+    }
+}
+
+void handle_sequence(ScreenMarks &m, const uint8_t *p, size_t len, uint64_t seq) {
+    if (p[1] == 'c') {
+        // Full reset: back on a blank normal screen
+        m.in_alt = false;
+        mark_clear(m, seq);
+        return;
+    }
+
+    const uint8_t *params = p + 2;
+    size_t n = len - 3;
+    uint8_t final = p[len - 1];
+    bool after_home = m.home_end == seq;
+
+    if (final == 'J') {
+        static const char *const below[] = {"", "0", nullptr};
+        static const char *const all[] = {"2", nullptr};
+        if (params_are(params, n, all))
+            mark_clear(m, after_home ? m.home_seq : seq);
+        else if (after_home && params_are(params, n, below))
+            mark_clear(m, m.home_seq);
+    } else if (final == 'H' || final == 'f') {
+        static const char *const home[] = {"", "1", "1;1", ";", "1;", ";1", nullptr};
+        if (params_are(params, n, home)) {
+            m.home_seq = seq;
+            m.home_end = seq + len;
+        }
+    } else if ((final == 'h' || final == 'l') && n > 1 && params[0] == '?' &&
+               private_modes(m, params + 1, n - 1, final == 'h')) {
+        if (final == 'h' && !m.in_alt) {
+            m.in_alt = true;
+            m.alt_enter = seq;
+            m.alt_first_clear = SCREEN_MARK_NONE;
+            m.alt_clear = SCREEN_MARK_NONE;
+        } else if (final == 'l' && m.in_alt) {
+            // The normal screen comes back as it was: the visit can go
+            m.in_alt = false;
+            if (m.alt_spans.size() == SCREEN_MARK_MAX_SPANS)
+                m.alt_spans.erase(m.alt_spans.begin());
+            m.alt_spans.emplace_back(m.alt_enter, seq + len);
+        }
+    }
+}
+
+// Add [start, end) clamped to [oldest, limit), merged with the previous span
+void add_span(std::vector<SeqSpan> *spans, uint64_t start, uint64_t end,
+              uint64_t oldest, uint64_t limit) {
+    start = std::max(start, oldest);
+    end = std::min(end, limit);
+    if (start >= end)
+        return;
+    if (!spans->empty() && spans->back().second == start)
+        spans->back().second = end;
+    else
+        spans->emplace_back(start, end);
+}
+
+} // namespace
+
+void screen_marks_scan(ScreenMarks &m, const uint8_t *data, size_t len, uint64_t seq) {
+    size_t i = 0;
+
+    // Finish a sequence the previous read cut off
+    if (m.partial_len > 0) {
+        uint8_t buf[SCREEN_MARK_MAX_SEQUENCE];
+        size_t take = std::min(len, SCREEN_MARK_MAX_SEQUENCE - m.partial_len);
+        memcpy(buf, m.partial, m.partial_len);
+        memcpy(buf + m.partial_len, data, take);
+        size_t have = m.partial_len + take;
+        size_t seq_len;
+        ParseResult r = parse_sequence(buf, have, &seq_len);
+        if (r == SEQ_INCOMPLETE) {
+            memcpy(m.partial, buf, have);
+            m.partial_len = have;
+            return;
+        }
+        m.partial_len = 0;
+        if (r == SEQ_DONE) {
+            handle_sequence(m, buf, seq_len, m.partial_seq);
+            i = seq_len - (have - take);
+        }
+    }
+
+    while (i < len) {
+        const uint8_t *esc = static_cast<const uint8_t *>(memchr(data + i, 0x1B, len - i));
+        if (!esc)
+            return;
+        i = static_cast<size_t>(esc - data);
+        size_t seq_len;
+        switch (parse_sequence(esc, len - i, &seq_len)) {
+        case SEQ_DONE:
+            handle_sequence(m, esc, seq_len, seq + i);
+            i += seq_len;
+            break;
+        case SEQ_SKIP:
+            i++;
+            break;
+        case SEQ_INCOMPLETE:
+            memcpy(m.partial, esc, len - i);
+            m.partial_len = len - i;
+            m.partial_seq = seq + i;
+            return;
+        }
+    }
+}
+
+bool screen_marks_replay(const ScreenMarks &m, uint64_t oldest, uint64_t end,
+                         std::vector<SeqSpan> *spans) {
+    spans->clear();
+    uint64_t start = m.primary_clear == SCREEN_MARK_NONE ? 0 : m.primary_clear;
+    bool safe = start >= oldest;
+
+    // Normal screen, skipping finished alternate-screen visits
+    uint64_t primary_end = m.in_alt ? m.alt_enter : end;
+    uint64_t pos = start;
+    for (const auto &visit : m.alt_spans) {
+        if (visit.second <= pos)
+            continue;
+        add_span(spans, pos, std::min(visit.first, primary_end), oldest, end);
+        pos = std::max(pos, visit.second);
+    }
+    add_span(spans, pos, primary_end, oldest, end);
+
+    // Alternate screen in use: the switch and the program's setup, then
+    // what followed the last clear
+    if (m.in_alt) {
+        if (m.alt_clear != SCREEN_MARK_NONE) {
+            add_span(spans, m.alt_enter, m.alt_first_clear, oldest, end);
+            add_span(spans, m.alt_clear, end, oldest, end);
+        } else {
+            add_span(spans, m.alt_enter, end, oldest, end);
+        }
+        // Entered before the oldest byte kept: the switch itself is lost
+        if (m.alt_enter < oldest)
+            safe = false;
+    }
+    return safe;
+}
+
+void screen_marks_preamble(const ScreenMarks &m, std::string *out) {
+    for (size_t b = 0; b < sizeof(SCREEN_TRACKED_MODES) / sizeof(SCREEN_TRACKED_MODES[0]); b++) {
+        if (!(m.modes_seen & (1u << b)))
+            continue;
+        *out += "\x1b[?";
+        *out += std::to_string(SCREEN_TRACKED_MODES[b]);
+        *out += (m.modes_set & (1u << b)) ? 'h' : 'l';
+    }
+}
@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Safe replay points in a session's output: where the screen was last
+// cleared, and where the alternate screen (full-screen programs) was
+// entered and left. Found with a cheap scan for the few escape sequences
+// that matter, as output is written to the ring. Sequences may be split
+// across reads.
+//
+// A clear is ESC [ 2 J, cursor home immediately followed by ESC [ J, or
+// a full reset (ESC c). A program that redraws by homing the cursor and
+// overwriting cells leaves no such point, so its output can't be trimmed.
+
+#ifndef CRT_SESSIOND_SCREEN_MARKS_H
+#define CRT_SESSIOND_SCREEN_MARKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+inline constexpr uint64_t SCREEN_MARK_NONE = UINT64_MAX;
+// Longer sequences can't be one of ours
+inline constexpr size_t SCREEN_MARK_MAX_SEQUENCE = 32;
+// Finished alternate-screen stretches remembered for skipping
+inline constexpr size_t SCREEN_MARK_MAX_SPANS = 64;
+
+// DEC private modes a trimmed replay restores up front, since the output
+// that set them may be skipped: cursor keys, cursor visibility, mouse
+// reporting and encodings, focus events, bracketed paste
+inline constexpr uint16_t SCREEN_TRACKED_MODES[] = {
+    1, 25, 1000, 1002, 1003, 1004, 1005, 1006, 1015, 2004,
+};
+
+// [start, end) in output sequence numbers
+using SeqSpan = std::pair<uint64_t, uint64_t>;
+
+struct ScreenMarks {
+    // Positions are output sequence numbers of the first byte of the
+    // sequence (SCREEN_MARK_NONE = not seen)
+    uint64_t    primary_clear = SCREEN_MARK_NONE;  // Last clear of the normal screen
+    bool        in_alt = false;                    // On the alternate screen
+    uint64_t    alt_enter = 0;                     // Sequence that switched to it
+    uint64_t    alt_first_clear = SCREEN_MARK_NONE;  // First clear since then
+    uint64_t    alt_clear = SCREEN_MARK_NONE;      // Last clear since then
+    std::vector<SeqSpan> alt_spans;                // Finished visits since primary_clear
+    uint16_t    modes_seen = 0;                    // SCREEN_TRACKED_MODES bits set or reset
+    uint16_t    modes_set = 0;                     // ... and which of those are set
+
+    uint64_t    home_seq = 0;                      // Last cursor home ...
+    uint64_t    home_end = SCREEN_MARK_NONE;       // ... and where it ended
+    uint8_t     partial[SCREEN_MARK_MAX_SEQUENCE]; // Sequence cut off by the end of a read
+    size_t      partial_len = 0;
+    uint64_t    partial_seq = 0;
+};
+
+// Scan one PTY read whose first byte has sequence number seq.
+void screen_marks_scan(ScreenMarks &marks, const uint8_t *data, size_t len, uint64_t seq);
+
+// What a reattach needs to rebuild the screen, as spans within
+// [oldest, end): the normal screen from its last clear without finished
+// alternate-screen visits, then, if a program is using the alternate
+// screen, its setup up to the first clear there and everything from the
+// last one. Returns false if the last clear (or the start
+// of the session) has already scrolled out, so the first span begins at
+// oldest rather than at a safe point.
+bool screen_marks_replay(const ScreenMarks &marks, uint64_t oldest, uint64_t end,
+                         std::vector<SeqSpan> *spans);
+
+// Append the sequences that put the tracked modes in their current state
+void screen_marks_preamble(const ScreenMarks &marks, std::string *out);
+
+#endif // CRT_SESSIOND_SCREEN_MARKS_H
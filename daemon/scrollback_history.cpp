@@ -0,0 +1,553 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scrollback_history.h"
+#include "log.h"
+#include "lz_codec.h"
+#include "newline_scan.h"
+#include "secure_mem.h"
+#include "spill_store.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <condition_variable>
+
+enum class BlockLocation : uint8_t {
+    Resident,   // in State::blocks
+    Spilling,   // in State::spilling, waiting for the disk write
+    Gone,       // written to disk or discarded
+};
+
+struct HistoryBlock {
+    uint64_t seq = 0;              // Sequence number of the first byte
+    uint32_t raw_len = 0;          // Uncompressed length (HISTORY_BLOCK_SIZE)
+    uint32_t newlines = 0;         // '\n' count
+    uint64_t line = 0;             // '\n' bytes sealed before it, since creation
+    bool compressed = false;       // data holds lz_codec output
+    bool compress_tried = false;   // worker thread only
+    BlockLocation location = BlockLocation::Resident;  // guarded by State::mutex
+    std::vector<uint8_t> data;
+
+    ~HistoryBlock() {
+        if (!data.empty())
+            secure_zero(data.data(), data.size());
+    }
+};
+
+struct ScrollbackHistory::State {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<HistoryBlock>> blocks;    // resident, oldest first
+    std::deque<std::shared_ptr<HistoryBlock>> spilling;  // evicted, awaiting disk write
+    std::unique_ptr<SpillStore> spill;                   // nullptr if spilling is off
+    size_t stored_bytes = 0;                             // data held by blocks + spilling
+    uint64_t generation = 0;                             // bumped by reset()
+    bool flush_scheduled = false;
+    bool spill_valid = true;                             // false until a reset is applied
+    int spill_readers = 0;                               // readSealed() calls reading disk
+    std::condition_variable spill_idle;                  // signalled when spill_readers hits 0
+};
+
+// Contiguous blocks (all HISTORY_BLOCK_SIZE): copy [seq, seq+len) onto out.
+static size_t copy_from_blocks(const std::deque<std::shared_ptr<HistoryBlock>> &blocks,
+                               uint64_t seq, size_t len, std::vector<uint8_t> &out,
+                               std::vector<uint8_t> &scratch) {
+    if (blocks.empty() || seq < blocks.front()->seq)
+        return 0;
+    size_t idx = static_cast<size_t>((seq - blocks.front()->seq) / HISTORY_BLOCK_SIZE);
+    size_t copied = 0;
+
+    while (copied < len && idx < blocks.size()) {
+        const HistoryBlock &b = *blocks[idx];
+        size_t off = static_cast<size_t>(seq + copied - b.seq);
+        size_t n = std::min(len - copied, static_cast<size_t>(b.raw_len) - off);
+
+        const uint8_t *src = b.data.data();
+        if (b.compressed) {
+            scratch.resize(b.raw_len);
+            if (!lz_decompress(b.data.data(), b.data.size(), scratch.data(), b.raw_len)) {
+                LOG_ERROR("corrupt history block at seq %llu",
+                          static_cast<unsigned long long>(b.seq));
+                break;
+            }
+            src = scratch.data();
+        }
+        out.insert(out.end(), src + off, src + off + n);
+        copied += n;
+        idx++;
+    }
+    return copied;
+}
+
+// The block of contiguous blocks holding byte seq, or nullptr
+static const HistoryBlock *block_at(const std::deque<std::shared_ptr<HistoryBlock>> &blocks,
+                                    uint64_t seq) {
+    if (blocks.empty() || seq < blocks.front()->seq)
+        return nullptr;
+    size_t idx = static_cast<size_t>((seq - blocks.front()->seq) / HISTORY_BLOCK_SIZE);
+    return idx < blocks.size() ? blocks[idx].get() : nullptr;
+}
+
+// The block holding newline number line (HistoryBlock::line), or nullptr
+static const HistoryBlock *block_with_line(const std::deque<std::shared_ptr<HistoryBlock>> &blocks,
+                                           uint64_t line) {
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), line,
+                               [](uint64_t l, const std::shared_ptr<HistoryBlock> &b) {
+                                   return l < b->line;
+                               });
+    if (it == blocks.begin())
+        return nullptr;
+    const HistoryBlock *b = (--it)->get();
+    return line < b->line + b->newlines ? b : nullptr;
+}
+
+ScrollbackHistory::ScrollbackHistory(size_t limit, SpillStore *spill)
+    : _state(std::make_shared<State>()), _limit(limit), _spill_enabled(spill != nullptr),
+      _mem_start_seq(0), _end_seq(0), _sealed_lines(0)
+{
+    _state->spill.reset(spill);
+    _pending.reserve(HISTORY_BLOCK_SIZE);
+}
+
+ScrollbackHistory::~ScrollbackHistory() {
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        for (auto &b : _state->blocks)
+            b->location = BlockLocation::Gone;
+        for (auto &b : _state->spilling)
+            b->location = BlockLocation::Gone;
+        _state->blocks.clear();  // blocks zero themselves when the last ref drops
+        _state->spilling.clear();
+        _state->stored_bytes = 0;
+        _state->generation++;
+    }
+    // Segment files are wiped on the worker, after any write still in flight
+    if (_spill_enabled) {
+        std::shared_ptr<State> state = _state;
+        worker_submit([state] { clearSpill(state); });
+    }
+    if (!_pending.empty())
+        secure_zero(_pending.data(), _pending.size());
+    if (!_scratch.empty())
+        secure_zero(_scratch.data(), _scratch.size());
+}
+
+void ScrollbackHistory::evictionSink(void *ctx, uint64_t seq,
+                                     const uint8_t *data, size_t len) {
+    static_cast<ScrollbackHistory *>(ctx)->append(seq, data, len);
+}
+
+void ScrollbackHistory::reset(uint64_t seq) {
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        for (auto &b : _state->blocks)
+            b->location = BlockLocation::Gone;
+        for (auto &b : _state->spilling)
+            b->location = BlockLocation::Gone;
+        _state->blocks.clear();
+        _state->spilling.clear();
+        _state->stored_bytes = 0;
+        _state->generation++;
+        _state->flush_scheduled = false;
+        _state->spill_valid = !_spill_enabled;
+    }
+    if (_spill_enabled) {
+        std::shared_ptr<State> state = _state;
+        worker_submit([state] { clearSpill(state); });
+    }
+    if (!_pending.empty())
+        secure_zero(_pending.data(), _pending.size());
+    _pending.clear();
+    _mem_start_seq = _end_seq = seq;
+}
+
+void ScrollbackHistory::append(uint64_t seq, const uint8_t *data, size_t len) {
+    if ((_limit == 0 && !_spill_enabled) || len == 0)
+        return;
+    if (seq != _end_seq)
+        reset(seq);
+
+    while (len > 0) {
+        size_t n = std::min(len, HISTORY_BLOCK_SIZE - _pending.size());
+        _pending.insert(_pending.end(), data, data + n);
+        data += n;
+        len -= n;
+        _end_seq += n;
+        if (_pending.size() == HISTORY_BLOCK_SIZE)
+            sealPending();
+    }
+    trim();
+}
+
+void ScrollbackHistory::sealPending() {
+    auto block = std::make_shared<HistoryBlock>();
+    block->seq = _end_seq - _pending.size();
+    block->raw_len = static_cast<uint32_t>(_pending.size());
+    block->newlines = static_cast<uint32_t>(count_newlines(_pending.data(), _pending.size()));
+    block->line = _sealed_lines;
+    _sealed_lines += block->newlines;
+    block->data.swap(_pending);
+    _pending.reserve(HISTORY_BLOCK_SIZE);
+
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->stored_bytes += block->data.size();
+        _state->blocks.push_back(block);
+    }
+
+    std::shared_ptr<State> state = _state;
+    worker_submit([state, block] { compressBlock(state, block); });
+}
+
+// Runs on the worker thread. The data of a block is only ever replaced by
+// the worker itself, so it can be read here without holding the lock.
+void ScrollbackHistory::compressBlock(const std::shared_ptr<State> &state,
+                                      const std::shared_ptr<HistoryBlock> &block) {
+    if (block->compress_tried)
+        return;
+    block->compress_tried = true;
+
+    std::vector<uint8_t> out(lz_compress_bound(block->raw_len));
+    size_t n = lz_compress(block->data.data(), block->raw_len, out.data(), out.size());
+
+    // Keep incompressible blocks raw: decompressing them would be pure overhead
+    std::vector<uint8_t> packed;
+    if (n > 0 && n < block->raw_len - block->raw_len / 8)
+        packed.assign(out.begin(), out.begin() + static_cast<ptrdiff_t>(n));
+    secure_zero(out.data(), out.size());
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!packed.empty() && block->location != BlockLocation::Gone) {
+            state->stored_bytes -= block->data.size();
+            state->stored_bytes += packed.size();
+            block->data.swap(packed);
+            block->compressed = true;
+        }
+    }
+    // packed now holds either the old raw bytes or the unused compressed copy
+    if (!packed.empty())
+        secure_zero(packed.data(), packed.size());
+}
+
+void ScrollbackHistory::trim() {
+    if (_end_seq - _mem_start_seq <= _limit)
+        return;
+
+    bool schedule_flush = false;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        while (!_state->blocks.empty() && _end_seq - _mem_start_seq > _limit) {
+            std::shared_ptr<HistoryBlock> front = _state->blocks.front();
+            _state->blocks.pop_front();
+            _mem_start_seq = front->seq + front->raw_len;
+
+            if (_spill_enabled) {
+                // Batched: one flush job drains everything queued so far
+                front->location = BlockLocation::Spilling;
+                _state->spilling.push_back(front);
+                if (!_state->flush_scheduled) {
+                    _state->flush_scheduled = true;
+                    schedule_flush = true;
+                }
+            } else {
+                front->location = BlockLocation::Gone;
+                _state->stored_bytes -= front->data.size();
+            }
+        }
+        generation = _state->generation;
+    }
+
+    if (schedule_flush) {
+        std::shared_ptr<State> state = _state;
+        worker_submit([state, generation] { flushSpill(state, generation); });
+    }
+}
+
+// Worker thread: write every queued block to the spill segments, then
+// publish the index entries and release the in-memory copies.
+void ScrollbackHistory::flushSpill(const std::shared_ptr<State> &state, uint64_t generation) {
+    std::vector<std::shared_ptr<HistoryBlock>> batch;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->generation != generation)
+            return;  // history was reset; a newer job owns the queue
+        state->flush_scheduled = false;
+        batch.assign(state->spilling.begin(), state->spilling.end());
+    }
+    if (batch.empty())
+        return;
+
+    std::vector<SpillRecord> records;
+    records.reserve(batch.size());
+    for (const auto &b : batch) {
+        compressBlock(state, b);  // no-op unless its own job has not run yet
+        records.push_back(SpillRecord{b->seq, b->raw_len, b->newlines, b->line, b->compressed,
+                                      b->data.data(), b->data.size()});
+    }
+
+    std::vector<SpillIndexEntry> entries;
+    bool ok = state->spill->writeRecords(records, entries);
+
+    std::vector<RetiredSegment> retired;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->generation == generation) {
+            state->spill->commit(entries, retired);
+            if (!ok) {
+                // Keep what is on disk contiguous with memory: drop it all
+                LOG_ERROR("scrollback spill failed, discarding spilled history");
+                state->spill->clear(retired);
+            }
+            for (size_t i = 0; i < batch.size() && !state->spilling.empty() &&
+                               state->spilling.front() == batch[i]; i++) {
+                state->stored_bytes -= batch[i]->data.size();
+                batch[i]->location = BlockLocation::Gone;
+                state->spilling.pop_front();
+            }
+        }
+    }
+    wipeRetired(state, retired);
+}
+
+void ScrollbackHistory::clearSpill(const std::shared_ptr<State> &state) {
+    std::vector<RetiredSegment> retired;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->spill->clear(retired);
+        state->spill_valid = true;
+    }
+    wipeRetired(state, retired);
+}
+
+// Worker thread: retired segments are out of the index, but a read planned
+// before they left may still be using their fds.
+void ScrollbackHistory::wipeRetired(const std::shared_ptr<State> &state,
+                                    const std::vector<RetiredSegment> &retired) {
+    if (retired.empty())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->spill_idle.wait(lock, [&state] { return state->spill_readers == 0; });
+    }
+    for (const auto &seg : retired)
+        SpillStore::wipeSegment(seg);
+}
+
+uint64_t ScrollbackHistory::startSeqLocked() const {
+    if (_state->spill && _state->spill_valid && !_state->spill->empty())
+        return _state->spill->startSeq();
+    if (!_state->spilling.empty())
+        return _state->spilling.front()->seq;
+    return _mem_start_seq;
+}
+
+uint64_t ScrollbackHistory::startSeq() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return startSeqLocked();
+}
+
+// Look a sealed block up by a byte it holds (by_line false) or by a
+// newline it holds, in every tier.
+bool ScrollbackHistory::findBlock(bool by_line, uint64_t key, BlockPos *pos) const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    const State &state = *_state;
+    if (state.spill && state.spill_valid) {
+        SpillIndexEntry e;
+        if (by_line ? state.spill->findLine(key, &e) : state.spill->findSeq(key, &e)) {
+            *pos = BlockPos{e.seq, e.raw_len, e.newlines, e.line};
+            return true;
+        }
+    }
+    for (const auto *tier : {&state.spilling, &state.blocks}) {
+        const HistoryBlock *b = by_line ? block_with_line(*tier, key) : block_at(*tier, key);
+        if (b) {
+            *pos = BlockPos{b->seq, b->raw_len, b->newlines, b->line};
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScrollbackHistory::findLineStart(uint64_t end_seq, uint64_t lines,
+                                      uint64_t *line_start) const {
+    uint64_t start = startSeq();
+    uint64_t pending_seq = sealedEndSeq();
+    end_seq = std::min(end_seq, _end_seq);
+    if (lines == 0 || end_seq <= start)
+        return false;
+
+    // Number the newlines before start and before end_seq as the blocks do
+    BlockPos pos;
+    uint64_t first_line = _sealed_lines;
+    if (start < pending_seq) {
+        if (!findBlock(false, start, &pos))
+            return false;
+        first_line = pos.line;
+    }
+    std::vector<uint8_t> data;
+    auto wipe = [&data] {
+        if (!data.empty())
+            secure_zero(data.data(), data.size());
+        data.clear();
+    };
+    uint64_t end_line;
+    if (end_seq >= pending_seq) {
+        end_line = _sealed_lines +
+                   count_newlines(_pending.data(), static_cast<size_t>(end_seq - pending_seq));
+    } else {
+        if (!findBlock(false, end_seq, &pos))
+            return false;
+        size_t head = static_cast<size_t>(end_seq - pos.seq);
+        if (head > 0 && read(pos.seq, head, data) != head) {
+            wipe();
+            return false;
+        }
+        end_line = pos.line + count_newlines(data.data(), data.size());
+        wipe();
+    }
+    if (end_line - first_line < lines)
+        return false;
+
+    // Newline end_line - lines, counting from 0: the unsealed tail, or the
+    // one block that holds it
+    uint64_t target = end_line - lines;
+    const uint8_t *p = _pending.data();
+    size_t n = _pending.size();
+    uint64_t base_seq = pending_seq;
+    uint64_t base_line = _sealed_lines;
+    if (target < _sealed_lines) {
+        if (!findBlock(true, target, &pos))
+            return false;
+        if (read(pos.seq, pos.raw_len, data) != pos.raw_len) {
+            wipe();
+            return false;
+        }
+        p = data.data();
+        n = data.size();
+        base_seq = pos.seq;
+        base_line = pos.line;
+    }
+    size_t off = find_nth_newline(p, n, static_cast<size_t>(target - base_line + 1));
+    wipe();
+    if (off >= n)
+        return false;
+    *line_start = base_seq + off + 1;
+    return true;
+}
+
+// Sealed tiers in sequence order: disk, queued for disk, resident. Called
+// with lock held; returns with it released. The memory tiers are copied
+// under the lock, the spilled records after it is dropped, so neither
+// thread holds the history lock across disk I/O.
+size_t ScrollbackHistory::readSealed(State &state, std::unique_lock<std::mutex> &lock,
+                                     uint64_t seq, size_t len,
+                                     std::vector<uint8_t> &out,
+                                     std::vector<uint8_t> &scratch) {
+    std::vector<SpillRead> reads;
+    size_t on_disk = 0;
+    if (state.spill && state.spill_valid)
+        on_disk = state.spill->planRead(seq, len, reads);
+
+    // Leave room for the spilled bytes ahead of the memory tiers
+    size_t base = out.size();
+    out.resize(base + on_disk);
+    size_t copied = on_disk;
+    if (copied < len)
+        copied += copy_from_blocks(state.spilling, seq + copied, len - copied, out, scratch);
+    if (copied < len)
+        copied += copy_from_blocks(state.blocks, seq + copied, len - copied, out, scratch);
+    if (reads.empty()) {
+        lock.unlock();
+        if (!scratch.empty())
+            secure_zero(scratch.data(), scratch.size());
+        return copied;
+    }
+
+    state.spill_readers++;
+    lock.unlock();
+    size_t got = SpillStore::readPlanned(reads, seq, on_disk, out.data() + base, scratch);
+    lock.lock();
+    if (--state.spill_readers == 0)
+        state.spill_idle.notify_all();
+    lock.unlock();
+
+    if (got < on_disk) {
+        // Disk read failed: keep only the contiguous prefix
+        secure_zero(out.data() + base + got, out.size() - base - got);
+        out.resize(base + got);
+        copied = got;
+    }
+    return copied;
+}
+
+HistorySnapshot ScrollbackHistory::snapshot() const {
+    HistorySnapshot snap;
+    snap._state = _state;
+    snap._start = startSeq();
+    snap._end = sealedEndSeq();
+    return snap;
+}
+
+size_t HistorySnapshot::read(uint64_t seq, size_t len, std::vector<uint8_t> &out,
+                             std::vector<uint8_t> &scratch) const {
+    if (!_state || seq < _start || seq >= _end || len == 0)
+        return 0;
+    len = static_cast<size_t>(std::min<uint64_t>(len, _end - seq));
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    return ScrollbackHistory::readSealed(*_state, lock, seq, len, out, scratch);
+}
+
+size_t ScrollbackHistory::read(uint64_t seq, size_t len,
+                               std::vector<uint8_t> &out) const {
+    uint64_t pending_seq = _end_seq - _pending.size();
+    size_t copied = 0;
+
+    {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        if (seq < startSeqLocked() || seq >= _end_seq || len == 0)
+            return 0;
+        len = static_cast<size_t>(std::min<uint64_t>(len, _end_seq - seq));
+        if (seq < pending_seq)
+            copied = readSealed(*_state, lock, seq,
+                                static_cast<size_t>(std::min<uint64_t>(len, pending_seq - seq)),
+                                out, _scratch);
+    }
+
+    // Unsealed tail
+    if (copied < len && seq + copied >= pending_seq) {
+        size_t off = static_cast<size_t>(seq + copied - pending_seq);
+        size_t n = std::min(len - copied, _pending.size() - off);
+        out.insert(out.end(), _pending.data() + off, _pending.data() + off + n);
+        copied += n;
+    }
+    return copied;
+}
+
+size_t ScrollbackHistory::storedBytes() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->stored_bytes + _pending.size();
+}
+
+size_t ScrollbackHistory::diskBytes() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->spill ? static_cast<size_t>(_state->spill->diskBytes()) : 0;
+}
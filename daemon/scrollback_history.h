@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cold scrollback tier: bytes evicted from a session's hot RingBuffer are
+// collected into fixed-size blocks and compressed on the worker thread.
+// Blocks are decompressed on demand when replay reaches past the ring.
+// With a SpillStore attached, blocks evicted from memory are appended to
+// segment files on disk (by the worker) instead of being discarded.
+
+#ifndef CRT_SESSIOND_SCROLLBACK_HISTORY_H
+#define CRT_SESSIOND_SCROLLBACK_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class SpillStore;
+struct RetiredSegment;
+
+// Uncompressed size of one history block: 64 KB
+inline constexpr size_t HISTORY_BLOCK_SIZE = 64 * 1024;
+
+struct HistoryBlock;
+class HistorySnapshot;
+
+class ScrollbackHistory {
+public:
+    // limit: maximum uncompressed bytes kept in memory
+    // spill: optional disk tier for blocks beyond limit (takes ownership)
+    ScrollbackHistory(size_t limit, SpillStore *spill);
+    ~ScrollbackHistory();
+
+    // Non-copyable
+    ScrollbackHistory(const ScrollbackHistory &) = delete;
+    ScrollbackHistory &operator=(const ScrollbackHistory &) = delete;
+
+    // Append bytes evicted from the ring. seq is the absolute sequence
+    // number of data[0]; a gap in sequence discards the existing history.
+    void append(uint64_t seq, const uint8_t *data, size_t len);
+
+    // RingBuffer eviction sink adapter (ctx is the ScrollbackHistory).
+    static void evictionSink(void *ctx, uint64_t seq, const uint8_t *data, size_t len);
+
+    // Copy up to len bytes starting at absolute sequence seq onto the end of out.
+    // Returns the number of bytes copied (0 if seq is outside the history).
+    size_t read(uint64_t seq, size_t len, std::vector<uint8_t> &out) const;
+
+    // Sequence number just after the lines-th '\n' before end_seq. Whole
+    // blocks are skipped by their newline counts, so only the block that
+    // newline is in (and the one end_seq splits, if any) is read. Returns
+    // false if the history holds fewer than lines newlines before end_seq.
+    bool findLineStart(uint64_t end_seq, uint64_t lines, uint64_t *line_start) const;
+
+    // Retained range, disk and memory: [startSeq(), endSeq())
+    uint64_t startSeq() const;
+    uint64_t endSeq() const { return _end_seq; }
+    size_t size() const { return static_cast<size_t>(_end_seq - startSeq()); }
+    bool empty() const { return size() == 0; }
+
+    // Uncompressed bytes retained, bytes held in memory, bytes on disk.
+    size_t rawBytes() const { return size(); }
+    size_t storedBytes() const;
+    size_t diskBytes() const;
+
+    // Worker-safe view of the sealed blocks (everything but the unsealed
+    // tail, which starts at sealedEndSeq()).
+    HistorySnapshot snapshot() const;
+    uint64_t sealedEndSeq() const { return _end_seq - _pending.size(); }
+
+private:
+    friend class HistorySnapshot;
+    struct State;
+
+    std::shared_ptr<State> _state;
+    size_t _limit;
+    bool _spill_enabled;
+    uint64_t _mem_start_seq;        // first byte of resident blocks / pending
+    uint64_t _end_seq;
+    uint64_t _sealed_lines;         // '\n' bytes in every block sealed so far
+    std::vector<uint8_t> _pending;  // unsealed tail block (event-loop thread only)
+    mutable std::vector<uint8_t> _scratch;
+
+    // Where a sealed block sits in the stream, from whichever tier holds it
+    struct BlockPos {
+        uint64_t seq;
+        uint32_t raw_len;
+        uint32_t newlines;
+        uint64_t line;
+    };
+    bool findBlock(bool by_line, uint64_t key, BlockPos *pos) const;
+
+    void sealPending();
+    void trim();
+    void reset(uint64_t seq);
+    uint64_t startSeqLocked() const;
+    static size_t readSealed(State &state, std::unique_lock<std::mutex> &lock,
+                             uint64_t seq, size_t len,
+                             std::vector<uint8_t> &out, std::vector<uint8_t> &scratch);
+    static void wipeRetired(const std::shared_ptr<State> &state,
+                            const std::vector<RetiredSegment> &retired);
+
+    // Worker-thread jobs
+    static void compressBlock(const std::shared_ptr<State> &state,
+                              const std::shared_ptr<HistoryBlock> &block);
+    static void flushSpill(const std::shared_ptr<State> &state, uint64_t generation);
+    static void clearSpill(const std::shared_ptr<State> &state);
+};
+
+// Read handle on a history's sealed blocks that may be used from the
+// worker thread. It shares the history's block state, so it stays safe
+// (reads just come up short) if the history is reset or destroyed.
+class HistorySnapshot {
+public:
+    HistorySnapshot() : _start(0), _end(0) {}
+
+    uint64_t startSeq() const { return _start; }
+    uint64_t endSeq() const { return _end; }
+
+    // Copy up to len bytes from seq onto out; scratch is caller-owned
+    // decompression space. Returns the number of bytes copied.
+    size_t read(uint64_t seq, size_t len, std::vector<uint8_t> &out,
+                std::vector<uint8_t> &scratch) const;
+
+private:
+    friend class ScrollbackHistory;
+    std::shared_ptr<ScrollbackHistory::State> _state;
+    uint64_t _start;
+    uint64_t _end;
+};
+
+#endif // CRT_SESSIOND_SCROLLBACK_HISTORY_H
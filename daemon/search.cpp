@@ -0,0 +1,335 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "search.h"
+#include "newline_scan.h"
+#include "protocol.h"
+#include "secure_mem.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// -------------------------------------------------------------------
+// Substring kernel
+// -------------------------------------------------------------------
+
+// Candidate positions are those where both the first and the last needle
+// byte match; only those are verified with memcmp. On terminal output this
+// rejects nearly every position 16 at a time.
+const uint8_t *find_substring(const uint8_t *hay, size_t hay_len,
+                              const uint8_t *needle, size_t needle_len) {
+    if (needle_len == 0)
+        return hay;
+    if (needle_len > hay_len)
+        return nullptr;
+    if (needle_len == 1)
+        return static_cast<const uint8_t *>(memchr(hay, needle[0], hay_len));
+
+    const size_t last_off = needle_len - 1;
+    const size_t positions = hay_len - last_off;   // candidate start offsets
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(static_cast<char>(needle[0]));
+    const __m128i last = _mm_set1_epi8(static_cast<char>(needle[last_off]));
+    for (; i + 16 <= positions; i += 16) {
+        __m128i bf = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+        __m128i bl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + last_off));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last))));
+        while (mask) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t first = vdupq_n_u8(needle[0]);
+    const uint8x16_t last = vdupq_n_u8(needle[last_off]);
+    for (; i + 16 <= positions; i += 16) {
+        uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(hay + i), first),
+                                 vceqq_u8(vld1q_u8(hay + i + last_off), last));
+        // Narrow to a 64-bit mask with 4 bits per byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        while (mask) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctzll(mask)) / 4;
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0)
+                return hay + i + bit;
+            mask &= ~(0xFULL << (bit * 4));
+        }
+    }
+#endif
+
+    // Remaining positions (or everything, without SIMD)
+    while (i < positions) {
+        const uint8_t *p = static_cast<const uint8_t *>(
+            memchr(hay + i, needle[0], positions - i));
+        if (!p)
+            break;
+        if (p[last_off] == needle[last_off] &&
+            memcmp(p + 1, needle + 1, needle_len - 2) == 0)
+            return p;
+        i = static_cast<size_t>(p - hay) + 1;
+    }
+    return nullptr;
+}
+
+// -------------------------------------------------------------------
+// SearchMatcher
+// -------------------------------------------------------------------
+
+SearchMatcher::SearchMatcher() : _regex(false), _compiled(false), _re() {}
+
+SearchMatcher::~SearchMatcher() {
+    if (_compiled)
+        regfree(&_re);
+    if (!_line.empty())
+        secure_zero(&_line[0], _line.size());
+}
+
+bool SearchMatcher::compile(const std::string &pattern, uint8_t flags, std::string *error) {
+    if (pattern.empty()) {
+        *error = "empty pattern";
+        return false;
+    }
+    _pattern = pattern;
+    _regex = (flags & (SEARCH_REGEX | SEARCH_IGNORE_CASE)) != 0;
+    if (!_regex)
+        return true;
+
+    // Case-insensitive literals go through the regex engine, escaped
+    std::string expr;
+    if (flags & SEARCH_REGEX) {
+        expr = pattern;
+    } else {
+        for (char c : pattern) {
+            if (strchr("\\.[]()*+?{}|^$", c))
+                expr += '\\';
+            expr += c;
+        }
+    }
+
+    int cflags = REG_EXTENDED;
+    if (flags & SEARCH_IGNORE_CASE)
+        cflags |= REG_ICASE;
+    int rc = regcomp(&_re, expr.c_str(), cflags);
+    if (rc != 0) {
+        char buf[128];
+        regerror(rc, &_re, buf, sizeof(buf));
+        *error = buf;
+        return false;
+    }
+    _compiled = true;
+    return true;
+}
+
+bool SearchMatcher::next(const uint8_t *data, size_t len, size_t from,
+                         size_t *match_off, size_t *match_len) const {
+    if (from >= len)
+        return false;
+
+    if (!_regex) {
+        const uint8_t *p = find_substring(data + from, len - from,
+                                          reinterpret_cast<const uint8_t *>(_pattern.data()),
+                                          _pattern.size());
+        if (!p)
+            return false;
+        *match_off = static_cast<size_t>(p - data);
+        *match_len = _pattern.size();
+        return true;
+    }
+
+    // Regex: one line at a time, without the line's CR/LF
+    for (size_t pos = from; pos < len; ) {
+        const uint8_t *nl = static_cast<const uint8_t *>(memchr(data + pos, '\n', len - pos));
+        size_t end = nl ? static_cast<size_t>(nl - data) : len;
+        size_t text_end = (end > pos && data[end - 1] == '\r') ? end - 1 : end;
+
+        // Embedded NULs end the line early for regexec; terminal text rarely has them
+        _line.assign(reinterpret_cast<const char *>(data + pos), text_end - pos);
+        regmatch_t m;
+        int eflags = (pos > 0 && data[pos - 1] != '\n') ? REG_NOTBOL : 0;
+        if (regexec(&_re, _line.c_str(), 1, &m, eflags) == 0) {
+            *match_off = pos + static_cast<size_t>(m.rm_so);
+            *match_len = static_cast<size_t>(m.rm_eo - m.rm_so);
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// -------------------------------------------------------------------
+// Scan driver
+// -------------------------------------------------------------------
+
+SearchSource::~SearchSource() {
+    if (!tail.empty())
+        secure_zero(tail.data(), tail.size());
+}
+
+namespace {
+
+// Feeds arbitrary chunks to the matcher as whole lines. Complete lines
+// are scanned in place; a line split across chunks is carried over.
+class LineScanner {
+public:
+    LineScanner(const SearchMatcher &matcher, size_t context, size_t max_matches,
+                std::vector<SearchMatch> &out)
+        : _matcher(matcher), _context(context), _max(max_matches), _out(out) {}
+
+    ~LineScanner() { dropCarry(); }
+
+    // Returns false once max_matches is reached.
+    bool feed(const uint8_t *data, size_t len, uint64_t seq) {
+        while (len > 0) {
+            if (!_carry.empty()) {
+                const uint8_t *nl = static_cast<const uint8_t *>(memchr(data, '\n', len));
+                size_t take = nl ? static_cast<size_t>(nl - data) + 1 : len;
+                take = std::min(take, SEARCH_MAX_LINE - _carry.size());
+                _carry.insert(_carry.end(), data, data + take);
+                data += take;
+                len -= take;
+                seq += take;
+                if (_carry.back() == '\n' || _carry.size() == SEARCH_MAX_LINE) {
+                    if (!scan(_carry.data(), _carry.size(), _carry_seq))
+                        return false;
+                    dropCarry();
+                }
+                continue;
+            }
+
+            // Whole lines, in place
+            size_t whole = len;
+            while (whole > 0 && data[whole - 1] != '\n')
+                whole--;
+            if (whole > 0) {
+                if (!scan(data, whole, seq))
+                    return false;
+                data += whole;
+                len -= whole;
+                seq += whole;
+                continue;
+            }
+
+            // Start of an unterminated line
+            if (len >= SEARCH_MAX_LINE) {
+                if (!scan(data, SEARCH_MAX_LINE, seq))
+                    return false;
+                data += SEARCH_MAX_LINE;
+                len -= SEARCH_MAX_LINE;
+                seq += SEARCH_MAX_LINE;
+                continue;
+            }
+            _carry.assign(data, data + len);
+            _carry_seq = seq;
+            break;
+        }
+        return true;
+    }
+
+    bool finish() {
+        bool more = _carry.empty() || scan(_carry.data(), _carry.size(), _carry_seq);
+        dropCarry();
+        return more;
+    }
+
+private:
+    const SearchMatcher &_matcher;
+    size_t _context;
+    size_t _max;
+    std::vector<SearchMatch> &_out;
+    std::vector<uint8_t> _carry;
+    uint64_t _carry_seq = 0;
+    uint64_t _line = 0;
+
+    void dropCarry() {
+        if (!_carry.empty())
+            secure_zero(_carry.data(), _carry.size());
+        _carry.clear();
+    }
+
+    bool scan(const uint8_t *buf, size_t len, uint64_t seq) {
+        size_t from = 0, counted = 0;
+        size_t off, mlen;
+        while (_out.size() < _max && _matcher.next(buf, len, from, &off, &mlen)) {
+            _line += count_newlines(buf + counted, off - counted);
+            counted = off;
+
+            // Context: up to _context bytes each side, not crossing lines
+            size_t cs = off;
+            while (cs > 0 && off - cs < _context && buf[cs - 1] != '\n')
+                cs--;
+            size_t ce = off + mlen;
+            while (ce < len && ce - (off + mlen) < _context && buf[ce] != '\n')
+                ce++;
+
+            SearchMatch m;
+            m.seq = seq + off;
+            m.len = static_cast<uint32_t>(mlen);
+            m.line = _line;
+            m.context_seq = seq + cs;
+            m.context.assign(buf + cs, buf + ce);
+            _out.push_back(std::move(m));
+
+            from = off + std::max<size_t>(mlen, 1);
+        }
+        _line += count_newlines(buf + counted, len - counted);
+        return _out.size() < _max;
+    }
+};
+
+} // namespace
+
+bool search_scan(const SearchMatcher &matcher, const SearchSource &source,
+                 size_t context, size_t max_matches, std::vector<SearchMatch> &out) {
+    size_t before = out.size();
+    LineScanner scanner(matcher, context, before + max_matches, out);
+
+    // Sealed history, one block at a time
+    std::vector<uint8_t> block, scratch;
+    bool more = true;
+    for (uint64_t seq = source.history.startSeq();
+         more && seq < source.history.endSeq(); ) {
+        block.clear();
+        size_t n = source.history.read(seq, HISTORY_BLOCK_SIZE, block, scratch);
+        if (n == 0)
+            break;  // history was reset or destroyed meanwhile
+        more = scanner.feed(block.data(), n, seq);
+        seq += n;
+    }
+    if (!block.empty())
+        secure_zero(block.data(), block.size());
+
+    if (more)
+        more = scanner.feed(source.tail.data(), source.tail.size(), source.tail_seq);
+    if (more)
+        more = scanner.finish();
+    return !more;
+}
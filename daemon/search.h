@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Server-side scrollback search: literal substring (vectorised first/last
+// byte filter) or POSIX extended regex, over a session's sealed history
+// and a copy of its ring. Scans run on the worker thread.
+
+#ifndef CRT_SESSIOND_SEARCH_H
+#define CRT_SESSIOND_SEARCH_H
+
+#include "scrollback_history.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <regex.h>
+#include <string>
+#include <vector>
+
+// Lines longer than this are searched in pieces
+inline constexpr size_t SEARCH_MAX_LINE = 64 * 1024;
+
+// First occurrence of needle in hay, or nullptr.
+const uint8_t *find_substring(const uint8_t *hay, size_t hay_len,
+                              const uint8_t *needle, size_t needle_len);
+
+struct SearchMatch {
+    uint64_t seq;                   // Sequence number of the first matched byte
+    uint32_t len;                   // Match length
+    uint64_t line;                  // 0-based line within the searched range
+    uint64_t context_seq;           // Sequence number of context[0]
+    std::vector<uint8_t> context;   // Part of the matching line around the match
+};
+
+class SearchMatcher {
+public:
+    SearchMatcher();
+    ~SearchMatcher();
+
+    // Non-copyable
+    SearchMatcher(const SearchMatcher &) = delete;
+    SearchMatcher &operator=(const SearchMatcher &) = delete;
+
+    // flags: SEARCH_REGEX / SEARCH_IGNORE_CASE. Returns false (with a
+    // message in *error) if the pattern is empty or does not compile.
+    bool compile(const std::string &pattern, uint8_t flags, std::string *error);
+
+    // Find the next match in data[from..len), which holds whole lines.
+    // Regex matches never span lines and ignore a trailing CR.
+    bool next(const uint8_t *data, size_t len, size_t from,
+              size_t *match_off, size_t *match_len) const;
+
+private:
+    std::string _pattern;
+    bool _regex;
+    bool _compiled;
+    regex_t _re;
+    mutable std::string _line;   // NUL-terminated copy for regexec
+};
+
+// What a search job scans: sealed history blocks, then a snapshot of the
+// unsealed history tail and ring taken on the event-loop thread.
+struct SearchSource {
+    HistorySnapshot history;
+    std::vector<uint8_t> tail;
+    uint64_t tail_seq = 0;
+
+    ~SearchSource();
+};
+
+// Scan source oldest first, appending up to max_matches matches to out.
+// context: bytes of line kept on each side of a match.
+// Returns true if the scan stopped early because max_matches was reached.
+bool search_scan(const SearchMatcher &matcher, const SearchSource &source,
+                 size_t context, size_t max_matches, std::vector<SearchMatch> &out);
+
+#endif // CRT_SESSIOND_SEARCH_H
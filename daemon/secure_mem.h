@@ -0,0 +1,48 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Secure memory clearing shared by everything that holds scrollback bytes.
+
+#ifndef CRT_SESSIOND_SECURE_MEM_H
+#define CRT_SESSIOND_SECURE_MEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Use memset_s for secure deletion where available
+#if defined(__STDC_LIB_EXT1__) || defined(__APPLE__)
+#define HAVE_MEMSET_S 1
+#else
+#define HAVE_MEMSET_S 0
+#endif
+
+inline void secure_zero(void *ptr, size_t len) {
+#if HAVE_MEMSET_S
+    memset_s(ptr, len, 0, len);
+#else
+    volatile uint8_t *p = static_cast<volatile uint8_t *>(ptr);
+    while (len--)
+        *p++ = 0;
+#endif
+}
+
+#endif // CRT_SESSIOND_SECURE_MEM_H
@@ -22,15 +22,19 @@
 #include "server.h"
 #include "log.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <fcntl.h>
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -354,7 +358,9 @@ Client *accept_client(int listen_fd) {
         return nullptr;
     }
 
+    static uint64_t next_client_id = 1;
     c->fd = fd;
+    c->id = next_client_id++;
     c->authenticated = false;  // Needs HELLO handshake
     c->capabilities = 0;
     c->peer_pid = peer_pid;
@@ -368,6 +374,8 @@ Client *accept_client(int listen_fd) {
 void close_client(Client *client) {
     if (!client) return;
     LOG_INFO("closing client fd=%d", client->fd);
+    for (const auto &pending : client->send_fds)
+        close(pending.second);
     close(client->fd);
     delete client;
 }
@@ -387,6 +395,43 @@ void queue_message(Client *client, uint8_t type,
     write_header(hdr, type, payload_len);
     if (payload_len > 0)
         memcpy(hdr + HEADER_SIZE, payload, payload_len);
+
+    client->send_buf_high_water = std::max(client->send_buf_high_water,
+                                           send_queued(client));
+}
+
+void queue_message_fd(Client *client, uint8_t type,
+                      const uint8_t *payload, uint32_t payload_len, int fd) {
+    if (!client) {
+        close(fd);
+        return;
+    }
+    client->send_fds.emplace_back(client->send_buf_offset + client->send_buf.size(), fd);
+    queue_message(client, type, payload, payload_len);
+}
+
+SharedFrame make_shared_frame(uint8_t type, const uint8_t *prefix, uint32_t prefix_len,
+                              const uint8_t *data, uint32_t data_len) {
+    auto frame = std::make_shared<std::vector<uint8_t>>(HEADER_SIZE + prefix_len + data_len);
+    uint8_t *p = frame->data();
+    write_header(p, type, prefix_len + data_len);
+    if (prefix_len > 0)
+        memcpy(p + HEADER_SIZE, prefix, prefix_len);
+    if (data_len > 0)
+        memcpy(p + HEADER_SIZE + prefix_len, data, data_len);
+    return frame;
+}
+
+void queue_shared_frame(Client *client, const SharedFrame &frame) {
+    if (!client) return;
+    client->shared_frames.emplace_back(client->send_buf_offset + client->send_buf.size(), frame);
+    client->shared_queued += frame->size();
+    client->send_buf_high_water = std::max(client->send_buf_high_water,
+                                           send_queued(client));
+}
+
+size_t send_queued(const Client *client) {
+    return client->send_buf.size() + client->shared_queued;
 }
 
 void queue_error(Client *client, uint8_t error_code, const char *message) {
@@ -429,20 +474,117 @@ bool try_parse_message(std::vector<uint8_t> &recv_buf, ParsedMessage *msg, bool
     return true;
 }
 
+// Write iov to the socket, passing fd along with the first byte if >= 0
+static ssize_t send_iov(int sock, struct iovec *iov, int iovcnt, int fd) {
+    if (fd < 0)
+        return writev(sock, iov, iovcnt);
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(sock, &msg, 0);
+}
+
+// Shared frames and send_buf stretches gathered per write
+static constexpr int FLUSH_IOV_MAX = 64;
+
 bool flush_send_buf(Client *client) {
-    if (!client || client->send_buf.empty())
+    if (!client)
         return true;
 
-    while (!client->send_buf.empty()) {
-        ssize_t n = ::write(client->fd,
-                            client->send_buf.data(),
-                            client->send_buf.size());
+    while (!client->send_buf.empty() || !client->shared_frames.empty()) {
+        // A passed fd must ride on the first byte of its message, so writes
+        // stop short of the next one and it goes out with sendmsg()
+        size_t limit = client->send_buf.size();
+        int fd = -1;
+        bool frame_first = !client->shared_frames.empty() &&
+                           client->shared_frames.front().first == client->send_buf_offset;
+        for (const auto &pending : client->send_fds) {
+            size_t at = static_cast<size_t>(pending.first - client->send_buf_offset);
+            if (at == 0 && fd < 0 && !frame_first) {
+                fd = pending.second;
+                continue;
+            }
+            limit = std::min(limit, at);
+            break;
+        }
+
+        // Gather in stream order: the frames due at each position, then
+        // send_buf up to the next frame
+        struct iovec iov[FLUSH_IOV_MAX];
+        bool is_frame[FLUSH_IOV_MAX];
+        int cnt = 0;
+        size_t pos = 0;
+        size_t fi = 0;
+        for (;;) {
+            while (fi < client->shared_frames.size() && cnt < FLUSH_IOV_MAX &&
+                   client->shared_frames[fi].first - client->send_buf_offset == pos) {
+                const auto &frame = *client->shared_frames[fi].second;
+                size_t skip = fi == 0 ? client->shared_sent : 0;
+                iov[cnt].iov_base = const_cast<uint8_t *>(frame.data() + skip);
+                iov[cnt].iov_len = frame.size() - skip;
+                is_frame[cnt++] = true;
+                fi++;
+            }
+            if (cnt == FLUSH_IOV_MAX)
+                break;
+            size_t end = limit;
+            if (fi < client->shared_frames.size())
+                end = std::min(end, static_cast<size_t>(
+                    client->shared_frames[fi].first - client->send_buf_offset));
+            if (end <= pos)
+                break;
+            iov[cnt].iov_base = client->send_buf.data() + pos;
+            iov[cnt].iov_len = end - pos;
+            is_frame[cnt++] = false;
+            pos = end;
+        }
+
+        ssize_t n = send_iov(client->fd, iov, cnt, fd);
         if (n > 0) {
-            client->send_buf.erase(client->send_buf.begin(),
-                                   client->send_buf.begin() + n);
+            if (fd >= 0) {
+                close(fd);
+                client->send_fds.pop_front();
+            }
+            client->bytes_out += static_cast<uint64_t>(n);
             client->congested = false;
+
+            size_t left = static_cast<size_t>(n);
+            size_t owned = 0;
+            for (int i = 0; i < cnt && left > 0; i++) {
+                size_t k = std::min(left, iov[i].iov_len);
+                left -= k;
+                if (!is_frame[i]) {
+                    owned += k;
+                    continue;
+                }
+                client->shared_queued -= k;
+                client->shared_sent += k;
+                if (k == iov[i].iov_len) {
+                    client->shared_frames.pop_front();
+                    client->shared_sent = 0;
+                }
+            }
+            client->send_buf.erase(client->send_buf.begin(),
+                                   client->send_buf.begin() + owned);
+            client->send_buf_offset += owned;
         } else if (n < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!client->congested)
+                    client->congestion_events++;
                 client->congested = true;
                 return true;  // Not an error, just flow control
             }
@@ -455,3 +597,34 @@ bool flush_send_buf(Client *client) {
     }
     return true;
 }
+
+// -------------------------------------------------------------------
+// Scrollback snapshots
+// -------------------------------------------------------------------
+
+int create_snapshot_fd(const char *name) {
+    int fd;
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+    fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd >= 0 || errno != ENOSYS)
+        return fd;
+#endif
+    std::string path = get_socket_dir() + "/" + name + "-XXXXXX";
+    std::vector<char> tmpl(path.begin(), path.end());
+    tmpl.push_back('\0');
+    fd = mkstemp(tmpl.data());
+    if (fd < 0)
+        return -1;
+    unlink(tmpl.data());
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+void seal_snapshot_fd(int fd) {
+#if defined(__linux__) && defined(F_ADD_SEALS)
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0)
+        LOG_DEBUG("sealing snapshot fd=%d failed: %s", fd, strerror(errno));
+#else
+    (void)fd;
+#endif
+}
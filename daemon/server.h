@@ -28,12 +28,19 @@
 #include "protocol.h"
 
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+// A complete frame (header and payload) queued to several clients at once
+using SharedFrame = std::shared_ptr<const std::vector<uint8_t>>;
+
 // Client connection state
 struct Client {
     int         fd;
+    uint64_t    id;                     // Unique for the daemon's lifetime
     bool        authenticated;          // HELLO completed
     uint32_t    capabilities;           // Negotiated capabilities
     pid_t       peer_pid;               // Peer PID from credentials
@@ -42,6 +49,36 @@ struct Client {
     std::vector<std::string> attached_sessions;  // Session UUIDs
     time_t      last_message_at;        // Last message timestamp (heartbeat)
     bool        congested;              // Socket write would block
+    uint8_t     subscriptions;          // SubscribeEvents
+    uint32_t    quiet_ms;               // Silence threshold for ACTIVITY
+    uint64_t    silence_checked_ns;     // Silence up to here has been reported
+    bool        searching;              // A SEARCH is running (one at a time)
+
+    // Counters (MSG_STATS): plain increments, always on
+    uint64_t    bytes_in;
+    uint64_t    bytes_out;
+    size_t      send_buf_high_water;
+    uint32_t    congestion_events;      // Transitions into congested
+    uint64_t    msg_counts[MSG_TYPE_SLOTS];  // Received, by type
+    uint64_t    output_pending_since;   // monotonic_ns() of the oldest unsent OUTPUT read
+    uint64_t    interactive_pending_since;  // Same, for OUTPUT of boosted sessions
+
+    // Sessions watched read-only (ATTACH_OBSERVE)
+    std::vector<std::string> observed_sessions;
+
+    // Positions below are in send_buf's own stream: send_buf_offset plus
+    // a send_buf position, unaffected by shared frames in between.
+    uint64_t    send_buf_offset;        // send_buf bytes already written
+
+    // File descriptors to pass with SCM_RIGHTS, keyed by the position of
+    // the message they ride on. Owned by the client until sent.
+    std::deque<std::pair<uint64_t, int>> send_fds;
+
+    // Shared frames, each going out before the send_buf byte at its
+    // position. shared_sent bytes of the front one are already written.
+    std::deque<std::pair<uint64_t, SharedFrame>> shared_frames;
+    size_t      shared_sent;
+    size_t      shared_queued;          // Unwritten bytes in shared_frames
 };
 
 // Parsed protocol message
@@ -90,6 +127,21 @@ void close_client(Client *client);
 void queue_message(Client *client, uint8_t type,
                    const uint8_t *payload, uint32_t payload_len);
 
+// Queue a message whose first byte carries fd (SCM_RIGHTS). Takes
+// ownership of fd; it is closed once sent or when the client goes away.
+void queue_message_fd(Client *client, uint8_t type,
+                      const uint8_t *payload, uint32_t payload_len, int fd);
+
+// Build a frame for queue_shared_frame(): the payload is prefix then data.
+SharedFrame make_shared_frame(uint8_t type, const uint8_t *prefix, uint32_t prefix_len,
+                              const uint8_t *data, uint32_t data_len);
+
+// Queue a frame built once for several clients; no copy is made.
+void queue_shared_frame(Client *client, const SharedFrame &frame);
+
+// Bytes queued for a client and not yet written
+size_t send_queued(const Client *client);
+
 // Queue an ERROR message to a client.
 void queue_error(Client *client, uint8_t error_code, const char *message);
 
@@ -98,8 +150,17 @@ void queue_error(Client *client, uint8_t error_code, const char *message);
 // On protocol error, returns false and sets *error to true.
 bool try_parse_message(std::vector<uint8_t> &recv_buf, ParsedMessage *msg, bool *error);
 
-// Flush as much of send_buf as possible to the client fd.
+// Flush as much of send_buf and shared_frames as possible to the client fd.
 // Returns false if the connection should be closed (error).
 bool flush_send_buf(Client *client);
 
+// Anonymous file for a scrollback snapshot that is handed to a client:
+// a memfd on Linux (sealable), elsewhere an unlinked file in the socket
+// directory. Returns -1 on failure.
+int create_snapshot_fd(const char *name);
+
+// Make a filled snapshot read-only for good where the platform allows
+// (memfd seals); a no-op elsewhere.
+void seal_snapshot_fd(int fd);
+
 #endif // CRT_SESSIOND_SERVER_H
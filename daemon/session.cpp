@@ -22,7 +22,10 @@
 #include "session.h"
 #include "log.h"
 #include "protocol.h"
+#include "spill_store.h"
+#include "trigger.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
@@ -206,12 +209,188 @@ bool validate_shell_path(const char *path) {
     return true;
 }
 
+// -------------------------------------------------------------------
+// Backends
+// -------------------------------------------------------------------
+
+static void pty_resize(DaemonSession *s) {
+    if (s->master_fd < 0)
+        return;
+    struct winsize ws = {};
+    ws.ws_row = s->rows;
+    ws.ws_col = s->cols;
+    ioctl(s->master_fd, TIOCSWINSZ, &ws);
+
+    // Send SIGWINCH to shell process group
+    if (s->alive && s->shell_pid > 0)
+        kill(-s->shell_pid, SIGWINCH);
+}
+
+static bool pty_get_termios(DaemonSession *s, struct termios *tio) {
+    return s->master_fd >= 0 && tcgetattr(s->master_fd, tio) == 0;
+}
+
+static void pty_set_termios(DaemonSession *s, const struct termios *tio) {
+    if (s->master_fd >= 0)
+        tcsetattr(s->master_fd, TCSANOW, tio);
+}
+
+static pid_t pty_foreground_pid(DaemonSession *s) {
+    return s->master_fd >= 0 ? tcgetpgrp(s->master_fd) : 0;
+}
+
+static void pty_signal(DaemonSession *s, int sig) {
+    if (s->alive && s->shell_pid > 0)
+        kill(s->shell_pid, sig);
+}
+
+static void pty_terminate(DaemonSession *s) {
+    if (!s->alive || s->shell_pid <= 0)
+        return;
+    kill(s->shell_pid, SIGHUP);
+    usleep(100000);
+    int status;
+    pid_t r = waitpid(s->shell_pid, &status, WNOHANG);
+    if (r == 0) {
+        // Still running — escalate to SIGKILL
+        kill(s->shell_pid, SIGKILL);
+        waitpid(s->shell_pid, &status, 0);
+    }
+    s->alive = false;
+}
+
+const SessionBackend PTY_SESSION_BACKEND = {
+    "pty", pty_resize, pty_get_termios, pty_set_termios,
+    pty_foreground_pid, pty_signal, pty_terminate,
+};
+
+// Closing our end stops the generator for this session
+static void synthetic_terminate(DaemonSession *s) {
+    if (s->master_fd >= 0) {
+        close(s->master_fd);
+        s->master_fd = -1;
+    }
+    s->alive = false;
+}
+
+static void synthetic_resize(DaemonSession *) {}
+static bool synthetic_get_termios(DaemonSession *, struct termios *) { return false; }
+static void synthetic_set_termios(DaemonSession *, const struct termios *) {}
+static pid_t synthetic_foreground_pid(DaemonSession *) { return 0; }
+
+// No process to signal: signals that would end a shell end the session
+static void synthetic_signal(DaemonSession *s, int sig) {
+    if (!s->alive)
+        return;
+    if (sig == SIGHUP || sig == SIGINT || sig == SIGQUIT || sig == SIGTERM || sig == SIGKILL) {
+        synthetic_terminate(s);
+        s->exit_code = 128 + sig;
+        LOG_INFO("session %s: synthetic session ended by signal %d", s->uuid, sig);
+    }
+}
+
+const SessionBackend SYNTHETIC_SESSION_BACKEND = {
+    "synthetic", synthetic_resize, synthetic_get_termios, synthetic_set_termios,
+    synthetic_foreground_pid, synthetic_signal, synthetic_terminate,
+};
+
+// -------------------------------------------------------------------
+// Creation
+// -------------------------------------------------------------------
+
+// Allocate the session, its ring and its history around an already
+// running producer. On failure the caller still owns master_fd and pid.
+static DaemonSession *new_session(const SessionBackend *backend, int master_fd, pid_t pid,
+                                  const char *shell, const char *cwd,
+                                  uint16_t rows, uint16_t cols,
+                                  const ScrollbackConfig &scrollback) {
+    // Generate UUID first: a file-backed ring is named after it
+    char uuid[UUID_STR_LEN];
+    if (!uuid_generate(uuid, sizeof(uuid))) {
+        LOG_ERROR("failed to generate UUID");
+        return nullptr;
+    }
+
+    // Allocate ring buffer
+    size_t ring_capacity = scrollback.ring_capacity;
+    RingBuffer *ring = scrollback.ring_dir
+        ? new (std::nothrow) RingBuffer(ring_capacity,
+                                        session_ring_path(scrollback.ring_dir, uuid))
+        : new (std::nothrow) RingBuffer(ring_capacity);
+    if (!ring || !ring->valid()) {
+        LOG_ERROR("failed to allocate ring buffer (%zu bytes)", ring_capacity);
+        delete ring;
+        return nullptr;
+    }
+
+    // Cold history is fed by the ring's eviction sink
+    ScrollbackHistory *history = nullptr;
+    if (scrollback.history_limit > 0 || scrollback.spill_dir) {
+        SpillStore *spill = scrollback.spill_dir
+            ? new (std::nothrow) SpillStore(scrollback.spill_dir, uuid, scrollback.spill_quota)
+            : nullptr;
+        history = new (std::nothrow) ScrollbackHistory(scrollback.history_limit, spill);
+        if (history)
+            ring->setEvictionSink(&ScrollbackHistory::evictionSink, history);
+        else {
+            delete spill;
+            LOG_WARN("failed to allocate scrollback history, continuing without");
+        }
+    }
+
+    // Allocate session
+    DaemonSession *s = new (std::nothrow) DaemonSession{};
+    if (!s) {
+        LOG_ERROR("failed to allocate session");
+        delete ring;
+        delete history;
+        return nullptr;
+    }
+
+    memcpy(s->uuid, uuid, sizeof(s->uuid));
+    s->backend = backend;
+    s->master_fd = master_fd;
+    s->shell_pid = pid;
+    s->rows = rows;
+    s->cols = cols;
+    s->ring = ring;
+    s->ring_requested = ring->capacity();
+    s->history = history;
+    s->client_fd = -1;
+    s->created_at = time(nullptr);
+    s->detached_at = 0;
+    strncpy(s->cwd, cwd ? cwd : "", PATH_MAX - 1);
+    s->cwd[PATH_MAX - 1] = '\0';
+    strncpy(s->shell, shell, PATH_MAX - 1);
+    s->shell[PATH_MAX - 1] = '\0';
+    s->alive = true;
+    s->exit_code = 0;
+    memset(&s->saved_termios, 0, sizeof(s->saved_termios));
+    s->has_saved_termios = false;
+    s->flow_paused = false;
+    s->input_queue_off = 0;
+    s->input_flow_paused = false;
+    s->boost_until_ns = 0;
+    s->resize_due_ns = 0;
+    s->last_output_ns = 0;
+    s->last_output_at = 0;
+    s->bell_count = 0;
+    s->bell_notified_ns = 0;
+    s->cached_fg_pid = 0;
+    s->triggers = nullptr;
+    s->trigger_client_id = 0;
+    s->recovered = false;
+
+    ring->setFileMetadata(s->uuid, s->shell, s->cwd, s->created_at);
+    return s;
+}
+
 DaemonSession *session_create(const char *shell_path,
                               const std::vector<std::string> &args,
                               const std::vector<std::string> &env,
                               const char *cwd,
                               uint16_t rows, uint16_t cols,
-                              size_t ring_capacity) {
+                              const ScrollbackConfig &scrollback) {
     if (!validate_shell_path(shell_path))
         return nullptr;
 
@@ -331,64 +510,169 @@ DaemonSession *session_create(const char *shell_path,
     // Set master fd non-blocking
     set_nonblock(master_fd);
 
-    // Allocate ring buffer
-    RingBuffer *ring = new (std::nothrow) RingBuffer(ring_capacity);
-    if (!ring || !ring->valid()) {
-        LOG_ERROR("failed to allocate ring buffer (%zu bytes)", ring_capacity);
-        delete ring;
+    DaemonSession *s = new_session(&PTY_SESSION_BACKEND, master_fd, pid, shell_path,
+                                   cwd, rows, cols, scrollback);
+    if (!s) {
         close(master_fd);
         kill(pid, SIGKILL);
         waitpid(pid, nullptr, 0);
         return nullptr;
     }
 
-    // Allocate session
-    DaemonSession *s = new (std::nothrow) DaemonSession{};
+    LOG_INFO("session created: %s (shell=%s, pid=%d, %dx%d)",
+             s->uuid, shell_path, pid, cols, rows);
+
+    return s;
+}
+
+std::string session_ring_path(const char *ring_dir, const char *uuid) {
+    return std::string(ring_dir) + "/" + std::string(uuid, SESSION_ID_LEN) + ".ring";
+}
+
+DaemonSession *session_create_synthetic(const SyntheticSpec &spec,
+                                        uint16_t rows, uint16_t cols,
+                                        const ScrollbackConfig &scrollback) {
+    int fd = synthetic_start(spec);
+    if (fd < 0)
+        return nullptr;
+
+    DaemonSession *s = new_session(&SYNTHETIC_SESSION_BACKEND, fd, 0,
+                                   synthetic_pattern_name(spec.pattern), "",
+                                   rows, cols, scrollback);
     if (!s) {
-        LOG_ERROR("failed to allocate session");
+        close(fd);
+        return nullptr;
+    }
+
+    LOG_INFO("session created: %s (synthetic %s, %llu B/s, %dx%d)",
+             s->uuid, s->shell, static_cast<unsigned long long>(spec.rate), cols, rows);
+    return s;
+}
+
+DaemonSession *session_recover(const char *ring_path) {
+    RingBuffer *ring = RingBuffer::recover(ring_path);
+    if (!ring)
+        return nullptr;
+
+    const RingFileHeader *hdr = ring->fileHeader();
+    if (!uuid_validate(hdr->session_id, strnlen(hdr->session_id, sizeof(hdr->session_id)))) {
+        LOG_WARN("ring file %s has no valid session id", ring_path);
         delete ring;
-        close(master_fd);
-        kill(pid, SIGKILL);
-        waitpid(pid, nullptr, 0);
         return nullptr;
     }
 
-    // Generate UUID
-    if (!uuid_generate(s->uuid, sizeof(s->uuid))) {
-        LOG_ERROR("failed to generate UUID");
+    DaemonSession *s = new (std::nothrow) DaemonSession{};
+    if (!s) {
         delete ring;
-        delete s;
-        close(master_fd);
-        kill(pid, SIGKILL);
-        waitpid(pid, nullptr, 0);
         return nullptr;
     }
 
-    s->master_fd = master_fd;
-    s->shell_pid = pid;
-    s->rows = rows;
-    s->cols = cols;
+    memcpy(s->uuid, hdr->session_id, SESSION_ID_LEN);
+    s->uuid[SESSION_ID_LEN] = '\0';
+    s->backend = &PTY_SESSION_BACKEND;
+    s->master_fd = -1;
+    s->shell_pid = 0;
+    s->rows = 24;
+    s->cols = 80;
     s->ring = ring;
+    s->ring_requested = ring->capacity();
+    s->history = nullptr;
     s->client_fd = -1;
-    s->created_at = time(nullptr);
-    s->detached_at = 0;
-    strncpy(s->cwd, cwd ? cwd : "", PATH_MAX - 1);
+    s->created_at = static_cast<time_t>(hdr->created_at);
+    s->detached_at = time(nullptr);
+    strncpy(s->cwd, hdr->cwd, PATH_MAX - 1);
     s->cwd[PATH_MAX - 1] = '\0';
-    strncpy(s->shell, shell_path, PATH_MAX - 1);
+    strncpy(s->shell, hdr->shell, PATH_MAX - 1);
     s->shell[PATH_MAX - 1] = '\0';
-    s->alive = true;
-    s->exit_code = 0;
-    memset(&s->saved_termios, 0, sizeof(s->saved_termios));
+    s->alive = false;
+    s->exit_code = -1;
     s->has_saved_termios = false;
     s->flow_paused = false;
+    s->input_queue_off = 0;
+    s->input_flow_paused = false;
+    s->boost_until_ns = 0;
+    s->resize_due_ns = 0;
+    s->last_output_ns = 0;
+    s->last_output_at = 0;
+    s->bell_count = 0;
+    s->bell_notified_ns = 0;
     s->cached_fg_pid = 0;
+    s->triggers = nullptr;
+    s->trigger_client_id = 0;
+    s->recovered = true;
 
-    LOG_INFO("session created: %s (shell=%s, pid=%d, %dx%d)",
-             s->uuid, shell_path, pid, cols, rows);
-
+    LOG_INFO("recovered session %s from ring file (%zu bytes of scrollback)",
+             s->uuid, ring->used());
     return s;
 }
 
+size_t session_scrollback_size(const DaemonSession *session) {
+    size_t total = session->ring ? session->ring->used() : 0;
+    if (session->history)
+        total += session->history->size();
+    return total;
+}
+
+uint64_t session_scrollback_start(const DaemonSession *session) {
+    if (session->history && !session->history->empty())
+        return session->history->startSeq();
+    return session->ring ? session->ring->oldestSequence() : 0;
+}
+
+uint64_t session_scrollback_end(const DaemonSession *session) {
+    return session->ring ? session->ring->sequence() : 0;
+}
+
+size_t session_read_scrollback(const DaemonSession *session, uint64_t seq,
+                               size_t len, std::vector<uint8_t> &out) {
+    size_t copied = 0;
+
+    // History covers everything before the ring's oldest byte
+    if (session->history && seq < session->history->endSeq())
+        copied = session->history->read(seq, len, out);
+
+    if (copied < len && session->ring) {
+        const uint8_t *p1, *p2;
+        size_t len1, len2;
+        copied += session->ring->readRange(seq + copied, len - copied,
+                                           &p1, &len1, &p2, &len2);
+        out.insert(out.end(), p1, p1 + len1);
+        out.insert(out.end(), p2, p2 + len2);
+    }
+    return copied;
+}
+
+uint64_t session_find_line_start(const DaemonSession *session, uint64_t end_seq,
+                                 uint64_t lines) {
+    uint64_t start = session_scrollback_start(session);
+    end_seq = std::min(end_seq, session_scrollback_end(session));
+    if (lines == 0 || end_seq <= start)
+        return end_seq;
+
+    // Exclude the final byte: a trailing newline terminates the last line
+    uint64_t remaining = lines;
+    uint64_t line_start = start;
+    uint64_t scan_end = end_seq - 1;
+
+    // Ring first, through its line index
+    RingBuffer *ring = session->ring;
+    if (ring && scan_end > ring->oldestSequence()) {
+        uint64_t ring_start = std::max(start, ring->oldestSequence());
+        uint64_t before_end = ring->lineNumberAt(scan_end);
+        uint64_t in_ring = before_end - ring->lineNumberAt(ring_start);
+        if (in_ring >= lines && ring->lineStart(before_end - lines + 1, &line_start))
+            return line_start;
+        remaining -= std::min(remaining, in_ring);
+        scan_end = ring_start;
+    }
+
+    // Then older history, skipping whole blocks by their newline counts
+    if (session->history && scan_end > start &&
+        session->history->findLineStart(scan_end, remaining, &line_start))
+        return line_start;
+    return start;
+}
+
 void session_destroy(DaemonSession *session) {
     if (!session) return;
 
@@ -401,24 +685,19 @@ void session_destroy(DaemonSession *session) {
     }
 
     // Kill shell if still alive
-    if (session->alive && session->shell_pid > 0) {
-        kill(session->shell_pid, SIGHUP);
-        // Give it a moment
-        int status;
-        pid_t r = waitpid(session->shell_pid, &status, WNOHANG);
-        if (r == 0) {
-            // Still running — escalate to SIGKILL
-            usleep(100000); // 100ms
-            kill(session->shell_pid, SIGKILL);
-            waitpid(session->shell_pid, &status, 0);
-        }
-    }
+    session->backend->terminate(session);
 
-    // Secure-clear and free ring buffer
+    // Secure-clear and free ring buffer, then the history it feeds
     if (session->ring) {
         delete session->ring;
         session->ring = nullptr;
     }
+    if (session->history) {
+        delete session->history;
+        session->history = nullptr;
+    }
+    delete session->triggers;
+    session->triggers = nullptr;
 
     // Secure-clear the session struct itself
     memset(session->uuid, 0, sizeof(session->uuid));
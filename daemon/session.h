@@ -21,11 +21,18 @@
 
 // Session lifecycle: PTY creation, shell spawning, environment sanitization,
 // and child process management. Each DaemonSession owns a PTY master fd and ring buffer.
+// Synthetic sessions (load testing) replace the PTY and shell with a
+// generator; a SessionBackend hides the difference from the event loop.
 
 #ifndef CRT_SESSIOND_SESSION_H
 #define CRT_SESSIOND_SESSION_H
 
+#include "cr_compact.h"
+#include "osc_tracker.h"
 #include "ring_buffer.h"
+#include "screen_marks.h"
+#include "scrollback_history.h"
+#include "synthetic.h"
 #include "uuid.h"
 
 #include <cstdint>
@@ -36,14 +43,49 @@
 #include <climits>
 #include <vector>
 
+struct DaemonSession;
+class TriggerMatcher;
+
+// Terminal and process operations that depend on what drives the session.
+// Output is always read from, and input written to, master_fd.
+struct SessionBackend {
+    const char *name;
+    // Apply session->rows/cols
+    void  (*resize)(DaemonSession *s);
+    bool  (*getTermios)(DaemonSession *s, struct termios *tio);
+    void  (*setTermios)(DaemonSession *s, const struct termios *tio);
+    // Foreground process group, 0 if unknown
+    pid_t (*foregroundPid)(DaemonSession *s);
+    // Deliver a signal; a backend without a process may end the session
+    // (alive = false) instead
+    void  (*signal)(DaemonSession *s, int sig);
+    // Hang up, escalating to a kill, and wait for the session to end
+    void  (*terminate)(DaemonSession *s);
+};
+
+extern const SessionBackend PTY_SESSION_BACKEND;
+extern const SessionBackend SYNTHETIC_SESSION_BACKEND;
+
+// A client watching a session read-only (ATTACH_OBSERVE)
+struct SessionObserver {
+    uint64_t    client_id;
+    bool        lagging;              // OUTPUT being dropped for a backed-up socket
+    uint64_t    dropped_from;         // Sequence of the first byte dropped (if lagging)
+};
+
 struct DaemonSession {
     char        uuid[UUID_STR_LEN];   // Session UUID (36 chars + null)
-    int         master_fd;            // PTY master fd
+    const SessionBackend *backend;
+    int         master_fd;            // PTY master fd (socketpair end if synthetic)
     pid_t       shell_pid;            // Shell process PID
     uint16_t    rows;                 // Current terminal rows
     uint16_t    cols;                 // Current terminal cols
     RingBuffer *ring;                 // Scrollback ring buffer
+    size_t      ring_requested;       // Ring capacity asked for at CREATE (the ring may be
+                                      // shrunk below it for the memory budget)
+    ScrollbackHistory *history;       // Compressed cold scrollback (nullptr if disabled)
     int         client_fd;            // Attached client fd (-1 if detached)
+    std::vector<SessionObserver> observers;
     time_t      created_at;           // Session creation time
     time_t      detached_at;          // Last detach time (0 if attached)
     char        cwd[PATH_MAX];        // Initial working directory
@@ -54,7 +96,38 @@ struct DaemonSession {
     bool        has_saved_termios;    // True if termios was captured
     bool        flow_paused;          // PTY read paused: client socket returned EAGAIN,
                                       // cleared when send_buf fully flushed
+    std::vector<uint8_t> input_queue; // INPUT the PTY hasn't accepted yet
+    size_t      input_queue_off;      // Bytes of input_queue already written
+    bool        input_flow_paused;    // INPUT_FLOW paused=1 sent to the client
+    uint64_t    boost_until_ns;       // monotonic_ns() until which output is serviced first
+    uint64_t    resize_due_ns;        // monotonic_ns() to apply rows/cols at (0 = applied)
+    uint64_t    last_output_ns;       // monotonic_ns() of the last PTY read (0 = none yet)
+    time_t      last_output_at;       // Wall-clock time of the same (LIST, ACTIVITY)
+    uint32_t    bell_count;           // BELs printed, OSC terminators excluded
+    uint64_t    bell_notified_ns;     // monotonic_ns() of the last ACTIVITY_BELL
+    OscTracker  osc;                  // Title and cwd announced in the output
+    ScreenMarks screen;               // Safe points for a trimmed replay
+    CrCompactor cr;                   // Redrawn lines to compact (--compact-cr)
     pid_t       cached_fg_pid;        // Last known foreground PID (for change detection)
+    TriggerMatcher *triggers;         // Output triggers (nullptr if none are set)
+    uint64_t    trigger_client_id;    // Client that set them and gets the events
+    bool        recovered;            // Rebuilt from a ring file after a daemon crash
+
+    // Counters (MSG_STATS): plain increments, always on
+    uint64_t    pty_bytes_read;
+    uint64_t    pty_bytes_written;
+    uint32_t    flow_pauses;          // Times PTY reads were paused for a slow client
+    uint64_t    flow_paused_ns;       // Total paused time, excluding a pause in progress
+    uint64_t    flow_paused_since;    // monotonic_ns() when the current pause began
+};
+
+// Scrollback storage settings for a new session
+struct ScrollbackConfig {
+    size_t      ring_capacity;        // Hot ring buffer size in bytes
+    const char *ring_dir;             // Directory for mmap'd ring files (nullptr = in-memory)
+    size_t      history_limit;        // Cold history, uncompressed bytes (0 = disabled)
+    const char *spill_dir;            // Directory for spilled history segments (nullptr = off)
+    size_t      spill_quota;          // Per-session disk cap for spilled history (0 = unlimited)
 };
 
 // Create a new session: open PTY, fork shell, allocate ring buffer.
@@ -63,14 +136,46 @@ struct DaemonSession {
 // env: environment variables (KEY=VALUE strings)
 // cwd: initial working directory
 // rows, cols: initial window size
-// ring_capacity: ring buffer size in bytes
+// scrollback: ring buffer and cold history settings
 // Returns session pointer on success, nullptr on failure.
 DaemonSession *session_create(const char *shell_path,
                               const std::vector<std::string> &args,
                               const std::vector<std::string> &env,
                               const char *cwd,
                               uint16_t rows, uint16_t cols,
-                              size_t ring_capacity);
+                              const ScrollbackConfig &scrollback);
+
+// Create a synthetic session fed by the generator thread (see synthetic.h).
+// Returns nullptr on failure.
+DaemonSession *session_create_synthetic(const SyntheticSpec &spec,
+                                        uint16_t rows, uint16_t cols,
+                                        const ScrollbackConfig &scrollback);
+
+// Rebuild a dead session from a ring file left behind by a crashed daemon.
+// The session keeps its original UUID, has no PTY, and is marked recovered.
+// Returns nullptr if the file cannot be recovered.
+DaemonSession *session_recover(const char *ring_path);
+
+// Path of the ring file for a session UUID inside ring_dir.
+std::string session_ring_path(const char *ring_dir, const char *uuid);
+
+// Total replayable bytes: cold history plus ring contents.
+size_t session_scrollback_size(const DaemonSession *session);
+
+// Replayable range in absolute output sequence numbers: [start, end).
+uint64_t session_scrollback_start(const DaemonSession *session);
+uint64_t session_scrollback_end(const DaemonSession *session);
+
+// Copy up to len bytes of scrollback starting at seq onto the end of out.
+// Returns the number of bytes copied.
+size_t session_read_scrollback(const DaemonSession *session, uint64_t seq,
+                               size_t len, std::vector<uint8_t> &out);
+
+// Sequence number where the last `lines` lines before end_seq begin
+// (a newline right before end_seq ends the last line). Returns the
+// scrollback start if fewer lines are retained.
+uint64_t session_find_line_start(const DaemonSession *session, uint64_t end_seq,
+                                 uint64_t lines);
 
 // Destroy a session: secure-clear ring buffer, close master fd, free memory.
 void session_destroy(DaemonSession *session);
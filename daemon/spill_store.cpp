@@ -0,0 +1,327 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "spill_store.h"
+#include "log.h"
+#include "lz_codec.h"
+#include "protocol.h"
+#include "secure_mem.h"
+#include "uuid.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+std::atomic<uint64_t> SpillStore::s_global_bytes{0};
+std::atomic<uint64_t> SpillStore::s_global_quota{0};
+
+void SpillStore::setGlobalQuota(size_t quota) {
+    s_global_quota = quota;
+}
+
+SpillStore::SpillStore(const std::string &dir, const char *session_id, size_t quota)
+    : _dir(dir), _session_id(session_id, SESSION_ID_LEN), _quota(quota),
+      _disk_bytes(0), _write_fd(-1), _write_segment(0), _write_offset(0),
+      _next_segment(0)
+{
+    // At least four segments fit in the quota, so dropping the oldest one
+    // always frees a meaningful share of it
+    _segment_limit = SPILL_SEGMENT_SIZE;
+    if (_quota > 0 && _quota / 4 < _segment_limit)
+        _segment_limit = std::max(_quota / 4, static_cast<size_t>(64 * 1024));
+}
+
+SpillStore::~SpillStore() {
+    std::vector<RetiredSegment> retired;
+    clear(retired);
+    for (const auto &seg : retired)
+        wipeSegment(seg);
+}
+
+std::string SpillStore::segmentPath(uint32_t number) const {
+    return _dir + "/" + _session_id + "." + std::to_string(number) + ".seg";
+}
+
+bool SpillStore::openSegment(uint32_t number) {
+    std::string path = segmentPath(number);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("cannot create spill segment %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    _write_fd = fd;
+    _write_segment = number;
+    _write_offset = 0;
+    _opened.push_back(Segment{number, fd, 0, path});
+    return true;
+}
+
+bool SpillStore::writeRecords(const std::vector<SpillRecord> &records,
+                              std::vector<SpillIndexEntry> &out) {
+    for (const auto &rec : records) {
+        size_t rec_len = SPILL_RECORD_HEADER_SIZE + rec.data_len;
+        if (_write_fd < 0 || _write_offset + rec_len > _segment_limit) {
+            if (!openSegment(_next_segment++))
+                return false;
+        }
+
+        uint8_t hdr[SPILL_RECORD_HEADER_SIZE] = {};
+        write_u64_le(hdr, rec.seq);
+        write_u32_le(hdr + 8, rec.raw_len);
+        write_u32_le(hdr + 12, static_cast<uint32_t>(rec.data_len));
+        write_u32_le(hdr + 16, rec.newlines);
+        hdr[20] = rec.compressed ? SPILL_RECORD_COMPRESSED : 0;
+
+        struct iovec iov[2];
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = const_cast<uint8_t *>(rec.data);
+        iov[1].iov_len = rec.data_len;
+
+        // Append-only; the worker is the only writer
+        size_t done = 0;
+        while (done < rec_len) {
+            ssize_t n;
+            if (done == 0) {
+                n = pwritev(_write_fd, iov, 2, static_cast<off_t>(_write_offset));
+            } else if (done < sizeof(hdr)) {
+                n = pwrite(_write_fd, hdr + done, sizeof(hdr) - done,
+                           static_cast<off_t>(_write_offset + done));
+            } else {
+                n = pwrite(_write_fd, rec.data + (done - sizeof(hdr)), rec_len - done,
+                           static_cast<off_t>(_write_offset + done));
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                LOG_ERROR("spill write failed: %s", strerror(errno));
+                _write_fd = -1;  // abandon the segment tail, continue in a new one
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+
+        out.push_back(SpillIndexEntry{rec.seq, rec.raw_len,
+                                      static_cast<uint32_t>(rec.data_len),
+                                      rec.newlines, rec.line, rec.compressed,
+                                      _write_segment, _write_offset});
+        _write_offset += rec_len;
+    }
+    return true;
+}
+
+void SpillStore::commit(const std::vector<SpillIndexEntry> &entries,
+                        std::vector<RetiredSegment> &retired) {
+    for (auto &seg : _opened)
+        _segments.push_back(seg);
+    _opened.clear();
+
+    for (const auto &e : entries) {
+        // The index must stay contiguous; a gap means the history was reset
+        if (!_index.empty() && e.seq != endSeq())
+            continue;
+        _index.push_back(e);
+        uint64_t bytes = SPILL_RECORD_HEADER_SIZE + e.stored_len;
+        for (auto &seg : _segments) {
+            if (seg.number == e.segment) {
+                seg.size += bytes;
+                break;
+            }
+        }
+        _disk_bytes += bytes;
+        s_global_bytes += bytes;
+    }
+
+    // Enforce per-session and daemon-wide quotas, oldest segment first
+    while (_segments.size() > 1 &&
+           ((_quota > 0 && _disk_bytes > _quota) ||
+            (s_global_quota > 0 && s_global_bytes > s_global_quota)))
+        retireOldest(retired);
+}
+
+void SpillStore::retireOldest(std::vector<RetiredSegment> &retired) {
+    Segment seg = _segments.front();
+    _segments.pop_front();
+
+    while (!_index.empty() && _index.front().segment == seg.number)
+        _index.pop_front();
+
+    _disk_bytes -= seg.size;
+    s_global_bytes -= seg.size;
+    if (seg.fd == _write_fd)
+        _write_fd = -1;  // next write opens a fresh segment
+    retired.push_back(RetiredSegment{seg.fd, seg.path, seg.size});
+}
+
+void SpillStore::clear(std::vector<RetiredSegment> &retired) {
+    for (auto &seg : _opened)
+        _segments.push_back(seg);
+    _opened.clear();
+    while (!_segments.empty())
+        retireOldest(retired);
+    _index.clear();
+    _write_fd = -1;
+}
+
+void SpillStore::wipeSegment(const RetiredSegment &seg) {
+    // Same secure-delete semantics as ring files: overwrite, sync, unlink
+    static const uint8_t zeros[64 * 1024] = {};
+    for (uint64_t off = 0; off < seg.size; ) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(sizeof(zeros), seg.size - off));
+        ssize_t w = pwrite(seg.fd, zeros, n, static_cast<off_t>(off));
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            break;
+        off += static_cast<uint64_t>(w);
+    }
+    fdatasync(seg.fd);
+    if (ftruncate(seg.fd, 0) != 0)
+        LOG_WARN("ftruncate on spill segment failed: %s", strerror(errno));
+    close(seg.fd);
+    unlink(seg.path.c_str());
+}
+
+void SpillStore::removeStale(const std::string &dir) {
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != nullptr) {
+        // Only <uuid>.<n>.seg
+        const char *name = ent->d_name;
+        size_t name_len = strlen(name);
+        if (name_len < SESSION_ID_LEN + 6 || name[SESSION_ID_LEN] != '.' ||
+            strcmp(name + name_len - 4, ".seg") != 0 ||
+            !uuid_validate(name, SESSION_ID_LEN))
+            continue;
+
+        std::string path = dir + "/" + name;
+        int fd = open(path.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            continue;
+        }
+        LOG_INFO("removing stale spill segment %s", name);
+        wipeSegment(RetiredSegment{fd, path, static_cast<uint64_t>(st.st_size)});
+    }
+    closedir(d);
+}
+
+const SpillStore::Segment *SpillStore::findSegment(uint32_t number) const {
+    for (const auto &seg : _segments) {
+        if (seg.number == number)
+            return &seg;
+    }
+    return nullptr;
+}
+
+bool SpillStore::findSeq(uint64_t seq, SpillIndexEntry *entry) const {
+    if (_index.empty() || seq < startSeq() || seq >= endSeq())
+        return false;
+    auto it = std::upper_bound(_index.begin(), _index.end(), seq,
+                               [](uint64_t s, const SpillIndexEntry &e) { return s < e.seq; });
+    *entry = *--it;
+    return true;
+}
+
+bool SpillStore::findLine(uint64_t line, SpillIndexEntry *entry) const {
+    // Only the last record numbered at or before line can hold it
+    auto it = std::upper_bound(_index.begin(), _index.end(), line,
+                               [](uint64_t l, const SpillIndexEntry &e) { return l < e.line; });
+    if (it == _index.begin())
+        return false;
+    --it;
+    if (line >= it->line + it->newlines)
+        return false;
+    *entry = *it;
+    return true;
+}
+
+size_t SpillStore::planRead(uint64_t seq, size_t len, std::vector<SpillRead> &reads) const {
+    if (_index.empty() || seq < startSeq() || seq >= endSeq() || len == 0)
+        return 0;
+
+    // Sparse index lookup: last entry starting at or before seq
+    auto it = std::upper_bound(_index.begin(), _index.end(), seq,
+                               [](uint64_t s, const SpillIndexEntry &e) { return s < e.seq; });
+    --it;
+
+    size_t covered = 0;
+    for (; it != _index.end() && covered < len; ++it) {
+        const Segment *seg = findSegment(it->segment);
+        if (!seg)
+            break;
+        size_t off = static_cast<size_t>(seq + covered - it->seq);
+        covered += std::min(len - covered, static_cast<size_t>(it->raw_len) - off);
+        reads.push_back(SpillRead{seg->fd, *it});
+    }
+    return covered;
+}
+
+size_t SpillStore::readPlanned(const std::vector<SpillRead> &reads, uint64_t seq, size_t len,
+                               uint8_t *dst, std::vector<uint8_t> &scratch) {
+    size_t copied = 0;
+    std::vector<uint8_t> raw;
+    for (const SpillRead &r : reads) {
+        if (copied >= len)
+            break;
+        const SpillIndexEntry &e = r.entry;
+        scratch.resize(e.stored_len);
+        ssize_t n = pread(r.fd, scratch.data(), e.stored_len,
+                          static_cast<off_t>(e.offset + SPILL_RECORD_HEADER_SIZE));
+        if (n != static_cast<ssize_t>(e.stored_len)) {
+            LOG_ERROR("short read from spill segment %u", e.segment);
+            break;
+        }
+
+        const uint8_t *src = scratch.data();
+        if (e.compressed) {
+            raw.resize(e.raw_len);
+            if (!lz_decompress(scratch.data(), e.stored_len, raw.data(), e.raw_len)) {
+                LOG_ERROR("corrupt spill record at seq %llu",
+                          static_cast<unsigned long long>(e.seq));
+                break;
+            }
+            src = raw.data();
+        }
+
+        size_t off = static_cast<size_t>(seq + copied - e.seq);
+        size_t take = std::min(len - copied, static_cast<size_t>(e.raw_len) - off);
+        memcpy(dst + copied, src + off, take);
+        copied += take;
+    }
+
+    if (!raw.empty())
+        secure_zero(raw.data(), raw.size());
+    if (!scratch.empty())
+        secure_zero(scratch.data(), scratch.size());
+    return copied;
+}
@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Append-only segment files for scrollback evicted from the in-memory
+// history. Each session writes <uuid>.<n>.seg files in the private socket
+// directory and keeps a sparse in-memory index (one entry per history block:
+// sequence -> segment/offset, newline count). Disk use is bounded by a
+// per-session and a daemon-wide quota; the oldest segments go first.
+//
+// Threading: every mutation (writeRecords, commit, clear) runs on the worker
+// thread, so writes and segment deletion are naturally ordered. commit() and
+// clear() change reader-visible state and must hold the owning
+// ScrollbackHistory's lock, as do planRead() and the accessors.
+// writeRecords() and readPlanned() run without the lock; the owner defers
+// wipeSegment() until no planned read is in flight.
+
+#ifndef CRT_SESSIOND_SPILL_STORE_H
+#define CRT_SESSIOND_SPILL_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Maximum size of one segment file: 8 MB (smaller if the quota is tight)
+inline constexpr size_t SPILL_SEGMENT_SIZE = 8 * 1024 * 1024;
+
+// On-disk record: [8B seq][4B raw_len][4B stored_len][4B newlines]
+//                 [1B flags][3B reserved][stored_len bytes]   (little-endian)
+inline constexpr size_t SPILL_RECORD_HEADER_SIZE = 24;
+inline constexpr uint8_t SPILL_RECORD_COMPRESSED = 0x01;
+
+// A block to be spilled, as handed to the worker
+struct SpillRecord {
+    uint64_t seq;
+    uint32_t raw_len;
+    uint32_t newlines;
+    uint64_t line;
+    bool compressed;
+    const uint8_t *data;
+    size_t data_len;
+};
+
+// Where a spilled block lives
+struct SpillIndexEntry {
+    uint64_t seq;
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint32_t newlines;
+    uint64_t line;      // newlines before it (HistoryBlock::line; not on disk)
+    bool compressed;
+    uint32_t segment;   // segment number
+    uint64_t offset;    // record header offset within the segment
+};
+
+// One spilled record to fetch, planned under the history lock
+struct SpillRead {
+    int fd;                 // segment fd, open until the segment is wiped
+    SpillIndexEntry entry;
+};
+
+// A segment removed from the store, to be wiped outside the lock
+struct RetiredSegment {
+    int fd;
+    std::string path;
+    uint64_t size;
+};
+
+class SpillStore {
+public:
+    SpillStore(const std::string &dir, const char *session_id, size_t quota);
+    ~SpillStore();
+
+    // Non-copyable
+    SpillStore(const SpillStore &) = delete;
+    SpillStore &operator=(const SpillStore &) = delete;
+
+    // Daemon-wide disk budget shared by all sessions (0 = unlimited).
+    static void setGlobalQuota(size_t quota);
+    static uint64_t globalDiskBytes() { return s_global_bytes.load(); }
+
+    // Worker thread: append records to the current segment, rotating as
+    // needed. Fills out[] (one entry per record) for commit(). Returns
+    // false on I/O error (records that were not written are not in out).
+    bool writeRecords(const std::vector<SpillRecord> &records,
+                      std::vector<SpillIndexEntry> &out);
+
+    // Publish written entries and enforce quotas. Segments dropped to meet
+    // the quota are appended to retired for wipeSegment() outside the lock.
+    void commit(const std::vector<SpillIndexEntry> &entries,
+                std::vector<RetiredSegment> &retired);
+
+    // Drop everything (all segments are appended to retired).
+    void clear(std::vector<RetiredSegment> &retired);
+
+    // Overwrite with zeros, close and unlink a retired segment.
+    static void wipeSegment(const RetiredSegment &seg);
+
+    // Wipe segment files left in dir by a daemon that did not exit cleanly.
+    // Their index died with it, so they cannot be replayed.
+    static void removeStale(const std::string &dir);
+
+    // List the records holding up to len bytes starting at seq onto reads.
+    // Returns the number of bytes they cover.
+    size_t planRead(uint64_t seq, size_t len, std::vector<SpillRead> &reads) const;
+
+    // Read planned records from disk and copy [seq, seq+len) to dst.
+    // Returns the number of bytes copied (short on I/O error).
+    static size_t readPlanned(const std::vector<SpillRead> &reads, uint64_t seq, size_t len,
+                              uint8_t *dst, std::vector<uint8_t> &scratch);
+
+    // Index entry of the record holding byte seq, or of the one holding
+    // newline number line (counted as SpillIndexEntry::line). Returns
+    // false if no committed record does.
+    bool findSeq(uint64_t seq, SpillIndexEntry *entry) const;
+    bool findLine(uint64_t line, SpillIndexEntry *entry) const;
+
+    // Committed range [startSeq(), endSeq()); empty() when nothing is on disk
+    bool empty() const { return _index.empty(); }
+    uint64_t startSeq() const { return _index.empty() ? 0 : _index.front().seq; }
+    uint64_t endSeq() const {
+        return _index.empty() ? 0 : _index.back().seq + _index.back().raw_len;
+    }
+    uint64_t diskBytes() const { return _disk_bytes; }
+
+private:
+    struct Segment {
+        uint32_t number;
+        int fd;
+        uint64_t size;
+        std::string path;
+    };
+
+    std::string _dir;
+    std::string _session_id;
+    size_t _quota;
+    size_t _segment_limit;
+
+    // Reader side (guarded by the history lock)
+    std::deque<Segment> _segments;         // oldest first
+    std::deque<SpillIndexEntry> _index;    // oldest first, contiguous in seq
+    uint64_t _disk_bytes;
+
+    // Writer side (worker thread only)
+    int _write_fd;
+    uint32_t _write_segment;
+    uint64_t _write_offset;
+    uint32_t _next_segment;
+    std::vector<Segment> _opened;          // segments opened since last commit
+
+    static std::atomic<uint64_t> s_global_bytes;
+    static std::atomic<uint64_t> s_global_quota;
+
+    std::string segmentPath(uint32_t number) const;
+    bool openSegment(uint32_t number);
+    const Segment *findSegment(uint32_t number) const;
+    void retireOldest(std::vector<RetiredSegment> &retired);
+};
+
+#endif // CRT_SESSIOND_SPILL_STORE_H
@@ -0,0 +1,148 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats_report.h"
+#include "latency.h"
+#include "protocol.h"
+#include "sync_client.h"
+
+#include <cstdio>
+#include <vector>
+
+int print_stats(const std::string &socket_path) {
+    SyncClient client;
+    if (!sync_connect(&client, socket_path, CAP_STATS)) {
+        fprintf(stderr, "cannot connect to daemon at %s\n", socket_path.c_str());
+        return 1;
+    }
+    uint8_t type;
+    std::vector<uint8_t> resp;
+    if (!(client.capabilities & CAP_STATS) ||
+        !sync_send(&client, MSG_STATS, nullptr, 0) ||
+        !sync_recv(&client, &type, &resp, 5000) || type != MSG_STATS_OK) {
+        fprintf(stderr, "daemon does not support STATS\n");
+        sync_close(&client);
+        return 1;
+    }
+    sync_close(&client);
+
+    // Every record is [2B len][fields]; read known fields, skip the rest
+    const uint8_t *p = resp.data(), *end = resp.data() + resp.size();
+    auto record = [&](size_t need, const uint8_t **fields) {
+        if (end - p < 2) return false;
+        uint16_t len = read_u16_le(p);
+        if (static_cast<size_t>(end - p) < 2u + len || len < need) return false;
+        *fields = p + 2;
+        p += 2 + len;
+        return true;
+    };
+    auto count = [&](uint16_t *n) {
+        if (end - p < 2) return false;
+        *n = read_u16_le(p);
+        p += 2;
+        return true;
+    };
+
+    const uint8_t *f;
+    if (!record(40, &f)) {
+        fprintf(stderr, "malformed STATS reply\n");
+        return 1;
+    }
+    printf("daemon pid %d: up %llu s, %llu loop iterations, rss %llu KB, "
+           "%u sessions, %u clients, %llu KB spilled\n",
+           client.daemon_pid,
+           static_cast<unsigned long long>(read_u64_le(f) / 1000),
+           static_cast<unsigned long long>(read_u64_le(f + 8)),
+           static_cast<unsigned long long>(read_u64_le(f + 16) / 1024),
+           read_u32_le(f + 24), read_u32_le(f + 28),
+           static_cast<unsigned long long>(read_u64_le(f + 32) / 1024));
+    if (read_u16_le(f - 2) >= 56 && read_u64_le(f + 48) > 0)  // Budget set
+        printf("rings %llu KB of %llu KB budget\n",
+               static_cast<unsigned long long>(read_u64_le(f + 40) / 1024),
+               static_cast<unsigned long long>(read_u64_le(f + 48) / 1024));
+
+    uint16_t n = 0;
+    if (count(&n) && n > 0)
+        printf("\n%-36s %12s %10s %9s %9s %12s %7s %9s %10s %10s\n", "session", "pty read",
+               "pty write", "ring KB", "cap KB", "overwritten", "pauses", "paused ms",
+               "input q", "cr cut KB");
+    for (uint16_t i = 0; i < n && record(36 + 60, &f); i++) {
+        uint64_t cr_cut = read_u16_le(f - 2) >= 36 + 68 ? read_u64_le(f + 96) : 0;
+        printf("%.36s %12llu %10llu %9llu %9llu %12llu %7u %9llu %10llu %10llu\n",
+               reinterpret_cast<const char *>(f),
+               static_cast<unsigned long long>(read_u64_le(f + 36)),
+               static_cast<unsigned long long>(read_u64_le(f + 44)),
+               static_cast<unsigned long long>(read_u64_le(f + 52) / 1024),
+               static_cast<unsigned long long>(read_u64_le(f + 60) / 1024),
+               static_cast<unsigned long long>(read_u64_le(f + 68)),
+               read_u32_le(f + 76),
+               static_cast<unsigned long long>(read_u64_le(f + 80)),
+               static_cast<unsigned long long>(read_u64_le(f + 88)),
+               static_cast<unsigned long long>(cr_cut / 1024));
+    }
+
+    if (count(&n) && n > 0)
+        printf("\n%5s %7s %12s %12s %10s %12s %9s  messages\n", "fd", "pid",
+               "bytes in", "bytes out", "queued", "queue peak", "congested");
+    for (uint16_t i = 0; i < n && record(45, &f); i++) {
+        printf("%5u %7u %12llu %12llu %10llu %12llu %9u ",
+               read_u32_le(f), read_u32_le(f + 4),
+               static_cast<unsigned long long>(read_u64_le(f + 8)),
+               static_cast<unsigned long long>(read_u64_le(f + 16)),
+               static_cast<unsigned long long>(read_u64_le(f + 24)),
+               static_cast<unsigned long long>(read_u64_le(f + 32)),
+               read_u32_le(f + 40));
+        uint8_t types = f[44];
+        for (uint8_t t = 0; t < types; t++) {
+            const uint8_t *e = f + 45 + t * 9;
+            if (e + 9 > p) break;
+            const char *name = message_type_name(e[0]);
+            if (name)
+                printf(" %s=%llu", name, static_cast<unsigned long long>(read_u64_le(e + 1)));
+            else
+                printf(" 0x%02x=%llu", e[0], static_cast<unsigned long long>(read_u64_le(e + 1)));
+        }
+        printf("\n");
+    }
+
+    if (count(&n) && n > 0)
+        printf("\n%-20s %10s %10s %10s %10s %10s %10s\n", "latency (us)",
+               "count", "p50", "p90", "p99", "p99.9", "max");
+    for (uint16_t i = 0; i < n && record(50, &f); i++) {
+        static const char *const kinds[] = {
+            "poll wait", "loop work", "output", "handler", "send_replay",
+            "session_create", "destroy kill", "interactive output",
+        };
+        char label[32];
+        const char *name = message_type_name(f[1]);
+        if (f[0] == LATENCY_HANDLER)
+            snprintf(label, sizeof(label), "  %s", name ? name : "unknown");
+        else if (f[0] < sizeof(kinds) / sizeof(kinds[0]))
+            snprintf(label, sizeof(label), "%s", kinds[f[0]]);
+        else
+            snprintf(label, sizeof(label), "kind %u", f[0]);
+        printf("%-20s %10llu", label, static_cast<unsigned long long>(read_u64_le(f + 2)));
+        for (int v = 0; v < 5; v++)
+            printf(" %10.1f", static_cast<double>(read_u64_le(f + 10 + v * 8)) / 1000.0);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Human-readable STATS report, shared by crt-sessiond --stats and
+// crt-sessionctl stats.
+
+#ifndef CRT_SESSIOND_STATS_REPORT_H
+#define CRT_SESSIOND_STATS_REPORT_H
+
+#include <string>
+
+// Query the daemon listening on socket_path and print its counters to
+// stdout. Returns the process exit code.
+int print_stats(const std::string &socket_path);
+
+#endif // CRT_SESSIOND_STATS_REPORT_H
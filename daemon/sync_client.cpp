@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sync_client.h"
+#include "protocol.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Free space kept after the buffered bytes for each read(): several
+// REPLAY_DATA chunks
+static constexpr size_t SYNC_READ_SIZE = 256 * 1024;
+
+bool sync_connect(SyncClient *client, const std::string &path, uint32_t caps) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client->fd < 0)
+        return false;
+    if (connect(client->fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+        sync_close(client);
+        return false;
+    }
+
+    // HELLO: [1B version][4B capabilities][4B client_pid]
+    uint8_t hello[9];
+    hello[0] = PROTOCOL_VERSION;
+    write_u32_le(hello + 1, caps);
+    write_u32_le(hello + 5, static_cast<uint32_t>(getpid()));
+    uint8_t type;
+    std::vector<uint8_t> resp;
+    if (!sync_send(client, MSG_HELLO, hello, sizeof(hello)) ||
+        !sync_recv(client, &type, &resp, 5000) ||
+        type != MSG_HELLO_OK || resp.size() < 9) {
+        sync_close(client);
+        return false;
+    }
+    client->capabilities = read_u32_le(resp.data() + 1);
+    client->daemon_pid = static_cast<pid_t>(read_u32_le(resp.data() + 5));
+    return true;
+}
+
+bool sync_send(SyncClient *client, uint8_t type, const uint8_t *payload, uint32_t len) {
+    std::vector<uint8_t> frame(HEADER_SIZE + len);
+    write_header(frame.data(), type, len);
+    if (len > 0)
+        memcpy(frame.data() + HEADER_SIZE, payload, len);
+
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = write(client->fd, frame.data() + sent, frame.size() - sent);
+        if (n > 0)
+            sent += static_cast<size_t>(n);
+        else if (n < 0 && errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+bool sync_next_frame(SyncClient *client, uint8_t *type, const uint8_t **payload,
+                     uint32_t *len) {
+    size_t avail = client->recv_end - client->recv_off;
+    if (avail < HEADER_SIZE)
+        return false;
+    const uint8_t *hdr = client->recv_buf.data() + client->recv_off;
+    uint32_t payload_len = read_u32_le(hdr + 1);
+    if (payload_len > MAX_MESSAGE_SIZE || avail < HEADER_SIZE + payload_len)
+        return false;
+    *type = hdr[0];
+    *payload = hdr + HEADER_SIZE;
+    *len = payload_len;
+    client->recv_off += HEADER_SIZE + payload_len;
+    return true;
+}
+
+bool sync_fill(SyncClient *client, int timeout_ms) {
+    std::vector<uint8_t> &buf = client->recv_buf;
+
+    // Move the unread tail to the front, then read straight in after it
+    if (client->recv_off > 0) {
+        memmove(buf.data(), buf.data() + client->recv_off, client->recv_end - client->recv_off);
+        client->recv_end -= client->recv_off;
+        client->recv_off = 0;
+    }
+    if (client->recv_end >= HEADER_SIZE && read_u32_le(buf.data() + 1) > MAX_MESSAGE_SIZE)
+        return false;
+    if (buf.size() < client->recv_end + SYNC_READ_SIZE)
+        buf.resize(client->recv_end + SYNC_READ_SIZE);
+
+    while (true) {
+        struct pollfd pfd = {client->fd, POLLIN, 0};
+        int ret = poll(&pfd, 1, timeout_ms);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+
+        ssize_t n = read(client->fd, buf.data() + client->recv_end, buf.size() - client->recv_end);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        client->recv_end += static_cast<size_t>(n);
+        return true;
+    }
+}
+
+bool sync_recv(SyncClient *client, uint8_t *type, std::vector<uint8_t> *payload,
+               int timeout_ms) {
+    const uint8_t *data;
+    uint32_t len;
+    while (!sync_next_frame(client, type, &data, &len)) {
+        if (!sync_fill(client, timeout_ms))
+            return false;
+    }
+    payload->assign(data, data + len);
+    return true;
+}
+
+void sync_close(SyncClient *client) {
+    if (client->fd >= 0)
+        close(client->fd);
+    client->fd = -1;
+    client->recv_buf.clear();
+    client->recv_off = 0;
+    client->recv_end = 0;
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Blocking protocol client for command-line tools (crt-sessiond --stats,
+// benchmarks): connect, HELLO, then plain request/response. The daemon's
+// own event loop never uses this.
+
+#ifndef CRT_SESSIOND_SYNC_CLIENT_H
+#define CRT_SESSIOND_SYNC_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+struct SyncClient {
+    int         fd = -1;
+    uint32_t    capabilities = 0;     // Negotiated in HELLO
+    pid_t       daemon_pid = 0;
+    std::vector<uint8_t> recv_buf;    // Read buffer, only ever grown
+    size_t      recv_off = 0;         // Bytes of it already handed out
+    size_t      recv_end = 0;         // Bytes of it filled
+};
+
+// Connect to the daemon socket at path and complete the HELLO handshake
+// offering caps. Prints nothing; returns false on any failure.
+bool sync_connect(SyncClient *client, const std::string &path, uint32_t caps);
+
+// Send one message. Returns false on write error.
+bool sync_send(SyncClient *client, uint8_t type, const uint8_t *payload, uint32_t len);
+
+// Receive one message, waiting at most timeout_ms (-1 = forever).
+// Returns false on timeout, disconnect, or a malformed frame.
+bool sync_recv(SyncClient *client, uint8_t *type, std::vector<uint8_t> *payload,
+               int timeout_ms);
+
+// Zero-copy receive for streaming: the next complete frame already read,
+// as a view into recv_buf. No I/O; false if none is buffered. Views stay
+// valid until the next sync_fill() or sync_recv().
+bool sync_next_frame(SyncClient *client, uint8_t *type, const uint8_t **payload,
+                     uint32_t *len);
+
+// Read whatever the socket has, waiting at most timeout_ms (-1 = forever)
+// for the first byte. Returns false on timeout, disconnect, or a frame
+// over MAX_MESSAGE_SIZE.
+bool sync_fill(SyncClient *client, int timeout_ms);
+
+void sync_close(SyncClient *client);
+
+#endif // CRT_SESSIOND_SYNC_CLIENT_H
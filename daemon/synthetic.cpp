@@ -0,0 +1,401 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "synthetic.h"
+#include "clock.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// -------------------------------------------------------------------
+// Patterns
+// -------------------------------------------------------------------
+
+static constexpr size_t PATTERN_SIZE = 256 * 1024;
+
+static uint64_t xorshift(uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+template <size_t N>
+static const char *pick(const char *const (&words)[N], uint64_t &state) {
+    return words[xorshift(state) % N];
+}
+
+static std::string make_text() {
+    static const char *const words[] = {
+        "compiling", "src/session.cpp", "warning:", "unused", "variable", "linking",
+        "crt-sessiond", "done", "in", "12ms", "ok", "->", "test", "passed", "0x7ffd3c2a",
+        "error:", "expected", "';'", "before", "'}'", "token", "/usr/include/c++/11",
+    };
+    std::string out;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    while (out.size() < PATTERN_SIZE) {
+        size_t n = 3 + xorshift(state) % 12;
+        for (size_t w = 0; w < n; w++) {
+            out += pick(words, state);
+            out += ' ';
+        }
+        out += "\r\n";
+    }
+    return out;
+}
+
+static std::string make_ansi() {
+    static const char *const words[] = {
+        "CPU", "MEM", "Tasks:", "load", "average:", "running", "sleeping", "zsh",
+        "crt-sessiond", "kworker/0:1", "node", "python3", "100.0", "0.3", "S", "R",
+    };
+    std::string out;
+    uint64_t state = 0xD1B54A32D192ED03ULL;
+    char buf[96];
+    while (out.size() < PATTERN_SIZE) {
+        switch (xorshift(state) % 4) {
+        case 0:   // Coloured log line
+            snprintf(buf, sizeof(buf), "\x1b[38;5;%um%s\x1b[0m \x1b[1m%s\x1b[22m %s\r\n",
+                     static_cast<unsigned>(xorshift(state) % 256),
+                     pick(words, state), pick(words, state), pick(words, state));
+            out += buf;
+            break;
+        case 1:   // Full-screen redraw row: cursor position, truecolor, erase line
+            snprintf(buf, sizeof(buf), "\x1b[%u;1H\x1b[48;2;%u;%u;%um %-12s %6s\x1b[K\x1b[m",
+                     static_cast<unsigned>(1 + xorshift(state) % 50),
+                     static_cast<unsigned>(xorshift(state) % 256),
+                     static_cast<unsigned>(xorshift(state) % 256),
+                     static_cast<unsigned>(xorshift(state) % 256),
+                     pick(words, state), pick(words, state));
+            out += buf;
+            break;
+        case 2: { // Progress bar redrawn in place
+            unsigned pct = static_cast<unsigned>(xorshift(state) % 101);
+            std::string bar(pct / 5, '#');
+            bar.resize(20, '.');
+            snprintf(buf, sizeof(buf), "\r\x1b[32m[%s]\x1b[0m %3u%%", bar.c_str(), pct);
+            out += buf;
+            break;
+        }
+        default:  // Window title
+            snprintf(buf, sizeof(buf), "\x1b]0;%s: %s\x07", pick(words, state), pick(words, state));
+            out += buf;
+            break;
+        }
+    }
+    return out;
+}
+
+static std::string make_utf8() {
+    static const char *const words[] = {
+        "\xe6\xbc\xa2\xe5\xad\x97",                 // 漢字
+        "\xe3\x81\x8b\xe3\x81\xaa",                 // かな
+        "\xed\x95\x9c\xea\xb8\x80",                 // 한글
+        "\xf0\x9f\x9a\x80",                         // rocket (4 bytes)
+        "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd",         // thumbs up + skin tone
+        "e\xcc\x81",                                // e + combining acute
+        "\xe2\x94\x8c\xe2\x94\x80\xe2\x94\x90",     // box drawing
+        "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d",         // Hebrew (RTL)
+        "na\xc3\xafve", "caf\xc3\xa9", "\xc3\x9f", "ascii",
+    };
+    std::string out;
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    while (out.size() < PATTERN_SIZE) {
+        size_t n = 4 + xorshift(state) % 16;
+        for (size_t w = 0; w < n; w++) {
+            out += pick(words, state);
+            out += ' ';
+        }
+        out += "\r\n";
+    }
+    return out;
+}
+
+static const std::string &pattern_data(SyntheticPattern pattern) {
+    // Built once, read-only afterwards
+    static const std::string text = make_text();
+    static const std::string ansi = make_ansi();
+    static const std::string utf8 = make_utf8();
+    switch (pattern) {
+    case SYNTH_ANSI: return ansi;
+    case SYNTH_UTF8: return utf8;
+    default:         return text;
+    }
+}
+
+const char *synthetic_pattern_name(SyntheticPattern pattern) {
+    switch (pattern) {
+    case SYNTH_ANSI: return "ansi";
+    case SYNTH_UTF8: return "utf8";
+    case SYNTH_ECHO: return "echo";
+    default:         return "text";
+    }
+}
+
+SyntheticSpec synthetic_parse_spec(const char *shell, const std::vector<std::string> &args) {
+    SyntheticSpec spec = {};
+    const char *slash = strrchr(shell, '/');
+    std::string name = slash ? slash + 1 : shell;
+    if (name == "ansi")
+        spec.pattern = SYNTH_ANSI;
+    else if (name == "utf8")
+        spec.pattern = SYNTH_UTF8;
+    else if (name == "echo")
+        spec.pattern = SYNTH_ECHO;
+    else
+        spec.pattern = SYNTH_TEXT;
+
+    for (const auto &a : args) {
+        if (a.compare(0, 5, "rate=") == 0)
+            spec.rate = strtoull(a.c_str() + 5, nullptr, 10);
+        else if (a.compare(0, 6, "burst=") == 0)
+            spec.burst = strtoull(a.c_str() + 6, nullptr, 10);
+    }
+    if (spec.rate && !spec.burst)
+        spec.burst = std::max<uint64_t>(1, spec.rate / 100);
+    return spec;
+}
+
+// -------------------------------------------------------------------
+// Generator thread
+// -------------------------------------------------------------------
+
+static constexpr size_t WRITE_CHUNK = 16 * 1024;
+static constexpr size_t ECHO_MAX = 64 * 1024;        // Pending echo beyond this is dropped
+
+struct Generator {
+    int fd;                     // Generator's end of the socketpair
+    SyntheticSpec spec;
+    const std::string *data;
+    size_t pos;                 // Next byte of data to send
+    uint64_t tokens;            // Bytes that may be sent now (rate-limited only)
+    uint64_t next_grant_ns;
+    std::string echo;           // Input waiting to be echoed
+};
+
+static std::mutex g_synth_mutex;
+static std::vector<Generator *> g_synth_new;       // Handed over to the thread
+static std::thread g_synth_thread;
+static int g_synth_wake[2] = {-1, -1};
+static bool g_synth_stopping = false;
+static uint64_t g_synth_started = 0;               // Offsets each session's pattern
+
+// Release tokens for rate-limited generators. Unspent tokens carry over up
+// to one burst, so a paused session does not flood when it resumes.
+static void grant_tokens(Generator *g, uint64_t now) {
+    if (!g->spec.rate)
+        return;
+    uint64_t period = g->spec.burst * 1000000000ull / g->spec.rate;
+    if (period == 0)
+        period = 1;
+    if (now > g->next_grant_ns + 1000000000ull)
+        g->next_grant_ns = now;     // Far behind (stalled thread): don't catch up
+    while (now >= g->next_grant_ns) {
+        g->tokens = std::min(g->tokens + g->spec.burst, 2 * g->spec.burst);
+        g->next_grant_ns += period;
+    }
+}
+
+static bool wants_write(const Generator *g) {
+    if (!g->echo.empty())
+        return true;
+    if (g->spec.pattern == SYNTH_ECHO)
+        return false;
+    return !g->spec.rate || g->tokens > 0;
+}
+
+// Returns false once the daemon's end is gone
+static bool service(Generator *g, short revents) {
+    if (revents & POLLIN) {
+        char buf[4096];
+        ssize_t n = read(g->fd, buf, sizeof(buf));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+            return false;
+        // Echo like a cooked-mode terminal: CR becomes CRLF
+        for (ssize_t i = 0; i < n && g->echo.size() < ECHO_MAX; i++) {
+            g->echo += buf[i];
+            if (buf[i] == '\r')
+                g->echo += '\n';
+        }
+    } else if (revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        return false;
+    }
+
+    if (!(revents & POLLOUT))
+        return true;
+    if (!g->echo.empty()) {
+        ssize_t n = write(g->fd, g->echo.data(), g->echo.size());
+        if (n > 0)
+            g->echo.erase(0, static_cast<size_t>(n));
+        else if (n < 0 && errno != EAGAIN && errno != EINTR)
+            return false;
+        return true;
+    }
+    if (g->spec.pattern == SYNTH_ECHO)
+        return true;
+
+    size_t want = WRITE_CHUNK;
+    if (g->spec.rate)
+        want = static_cast<size_t>(std::min<uint64_t>(want, g->tokens));
+    want = std::min(want, g->data->size() - g->pos);
+    ssize_t n = write(g->fd, g->data->data() + g->pos, want);
+    if (n > 0) {
+        g->pos = (g->pos + static_cast<size_t>(n)) % g->data->size();
+        if (g->spec.rate)
+            g->tokens -= static_cast<uint64_t>(n);
+    } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        return false;
+    }
+    return true;
+}
+
+static void generator_main() {
+    std::vector<Generator *> gens;
+    std::vector<struct pollfd> fds;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(g_synth_mutex);
+            if (g_synth_stopping)
+                break;
+            gens.insert(gens.end(), g_synth_new.begin(), g_synth_new.end());
+            g_synth_new.clear();
+        }
+
+        uint64_t now = monotonic_ns();
+        int timeout = 100;
+        fds.assign(1, {g_synth_wake[0], POLLIN, 0});
+        for (auto *g : gens) {
+            grant_tokens(g, now);
+            short events = POLLIN;
+            if (wants_write(g))
+                events |= POLLOUT;
+            else if (g->spec.rate && g->spec.pattern != SYNTH_ECHO)
+                timeout = std::min<int>(timeout,
+                    static_cast<int>((g->next_grant_ns - now) / 1000000) + 1);
+            fds.push_back({g->fd, events, 0});
+        }
+
+        if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0 && errno != EINTR) {
+            LOG_ERROR("synthetic generator poll() failed: %s", strerror(errno));
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(g_synth_wake[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < gens.size(); i++) {
+            Generator *g = gens[i];
+            if (service(g, fds[i + 1].revents)) {
+                gens[kept++] = g;
+            } else {
+                close(g->fd);
+                delete g;
+            }
+        }
+        gens.resize(kept);
+    }
+
+    for (auto *g : gens) {
+        close(g->fd);
+        delete g;
+    }
+}
+
+int synthetic_start(const SyntheticSpec &spec) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        LOG_ERROR("socketpair failed: %s", strerror(errno));
+        return -1;
+    }
+    for (int fd : sv) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    Generator *g = new (std::nothrow) Generator{};
+    if (!g) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    g->fd = sv[1];
+    g->spec = spec;
+    g->data = &pattern_data(spec.pattern);
+    g->next_grant_ns = monotonic_ns();
+
+    {
+        std::lock_guard<std::mutex> lock(g_synth_mutex);
+        // Spread sessions over the pattern so they don't emit in lockstep
+        g->pos = static_cast<size_t>(g_synth_started++ * 7919) % g->data->size();
+        if (!g_synth_thread.joinable()) {
+            if (pipe(g_synth_wake) != 0) {
+                LOG_ERROR("pipe() for synthetic generator failed: %s", strerror(errno));
+                close(sv[0]);
+                close(sv[1]);
+                delete g;
+                return -1;
+            }
+            for (int fd : g_synth_wake) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            }
+            g_synth_stopping = false;
+            g_synth_thread = std::thread(generator_main);
+        }
+        g_synth_new.push_back(g);
+    }
+    char c = 1;
+    (void)write(g_synth_wake[1], &c, 1);
+    return sv[0];
+}
+
+void synthetic_shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(g_synth_mutex);
+        if (!g_synth_thread.joinable())
+            return;
+        g_synth_stopping = true;
+    }
+    char c = 1;
+    (void)write(g_synth_wake[1], &c, 1);
+    g_synth_thread.join();
+
+    for (auto *g : g_synth_new) {
+        close(g->fd);
+        delete g;
+    }
+    g_synth_new.clear();
+    close(g_synth_wake[0]);
+    close(g_synth_wake[1]);
+    g_synth_wake[0] = g_synth_wake[1] = -1;
+}
@@ -0,0 +1,64 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Synthetic session output for load and stress testing: instead of a
+// forked shell on a PTY, a session reads from one end of a socketpair that
+// an in-process generator thread feeds with deterministic text. The event
+// loop, framing and flow control see an ordinary fd, but creating a
+// session costs no fork, so thousands of them are cheap.
+
+#ifndef CRT_SESSIOND_SYNTHETIC_H
+#define CRT_SESSIOND_SYNTHETIC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum SyntheticPattern : uint8_t {
+    SYNTH_TEXT = 0,     // Build-log ASCII lines
+    SYNTH_ANSI = 1,     // SGR colours, cursor motion, progress-bar redraws
+    SYNTH_UTF8 = 2,     // CJK, emoji, combining marks, box drawing
+    SYNTH_ECHO = 3,     // No output of its own, only echoed input
+};
+
+struct SyntheticSpec {
+    SyntheticPattern pattern;
+    uint64_t rate;      // Bytes/s; 0 = as fast as the daemon reads
+    uint64_t burst;     // Bytes released at once, every burst/rate seconds
+};
+
+// Build a spec from CREATE's shell and args: the shell's basename picks the
+// pattern (text, ansi, utf8, echo; anything else is text) and args may hold
+// "rate=N" and "burst=N". Burst defaults to 10 ms worth of output.
+SyntheticSpec synthetic_parse_spec(const char *shell, const std::vector<std::string> &args);
+
+const char *synthetic_pattern_name(SyntheticPattern pattern);
+
+// Start generating for a new session. Returns the daemon's end of the
+// socketpair (non-blocking, close-on-exec) or -1. All input written to it
+// is echoed back, as a terminal in cooked mode would; closing it ends the
+// generator for that session.
+int synthetic_start(const SyntheticSpec &spec);
+
+// Stop the generator thread and close its ends of all socketpairs.
+void synthetic_shutdown();
+
+#endif // CRT_SESSIOND_SYNTHETIC_H
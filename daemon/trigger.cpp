@@ -0,0 +1,640 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trigger.h"
+#include "protocol.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline uint8_t fold(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+}
+
+// Mark c in set, both cases for letters
+static void mark_byte(bool set[256], uint8_t c) {
+    set[c] = true;
+    if (c >= 'a' && c <= 'z')
+        set[c - ('a' - 'A')] = true;
+    else if (c >= 'A' && c <= 'Z')
+        set[c + ('a' - 'A')] = true;
+}
+
+// -------------------------------------------------------------------
+// Regex literal extraction
+// -------------------------------------------------------------------
+
+// Index just past the bracket expression starting at re[i], or npos.
+static size_t skip_bracket(const std::string &re, size_t i) {
+    size_t n = re.size();
+    size_t j = i + 1;
+    if (j < n && re[j] == '^')
+        j++;
+    if (j < n && re[j] == ']')
+        j++;
+    while (j < n) {
+        if (re[j] == '[' && j + 1 < n &&
+            (re[j + 1] == ':' || re[j + 1] == '.' || re[j + 1] == '=')) {
+            // [:class:], [.coll.], [=equiv=]
+            char kind = re[j + 1];
+            size_t close = j + 2;
+            while (close + 1 < n && !(re[close] == kind && re[close + 1] == ']'))
+                close++;
+            if (close + 1 >= n)
+                return std::string::npos;
+            j = close + 2;
+            continue;
+        }
+        if (re[j] == ']')
+            return j + 1;
+        j++;
+    }
+    return std::string::npos;
+}
+
+// Longest run of bytes every match of the ERE must contain, taken from the
+// top level only: groups, brackets and optional atoms end a run, and
+// top-level alternation means there is none. Returns false if that run is
+// shorter than TRIGGER_MIN_LITERAL.
+static bool required_literal(const std::string &re, std::string *literal) {
+    std::string best, run;
+    auto end_run = [&]() {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+
+    size_t n = re.size();
+    for (size_t i = 0; i < n; ) {
+        char c = re[i];
+        switch (c) {
+        case '\\': {
+            if (i + 1 >= n)
+                return false;
+            char e = re[i + 1];
+            if (e != '\0' && strchr("\\.^$|()[]{}*+?", e))
+                run += e;
+            else
+                end_run();
+            i += 2;
+            break;
+        }
+        case '|':
+            return false;
+        case '(': {
+            int depth = 0;
+            for (; i < n; i++) {
+                if (re[i] == '\\') {
+                    i++;
+                } else if (re[i] == '[') {
+                    size_t next = skip_bracket(re, i);
+                    if (next == std::string::npos)
+                        return false;
+                    i = next - 1;
+                } else if (re[i] == '(') {
+                    depth++;
+                } else if (re[i] == ')' && --depth == 0) {
+                    break;
+                }
+            }
+            if (i >= n)
+                return false;
+            i++;
+            end_run();
+            break;
+        }
+        case '[':
+            i = skip_bracket(re, i);
+            if (i == std::string::npos)
+                return false;
+            end_run();
+            break;
+        case '*':
+        case '?':
+            // The atom before may be absent
+            if (!run.empty())
+                run.pop_back();
+            end_run();
+            i++;
+            break;
+        case '+':
+            end_run();
+            i++;
+            break;
+        case '{': {
+            size_t close = re.find('}', i);
+            if (close == std::string::npos)
+                return false;
+            if (strtoul(re.c_str() + i + 1, nullptr, 10) == 0 && !run.empty())
+                run.pop_back();
+            end_run();
+            i = close + 1;
+            break;
+        }
+        case '.':
+        case '^':
+        case '$':
+            end_run();
+            i++;
+            break;
+        default:
+            run += c;
+            i++;
+            break;
+        }
+    }
+    end_run();
+
+    *literal = best;
+    return best.size() >= TRIGGER_MIN_LITERAL;
+}
+
+// -------------------------------------------------------------------
+// TriggerMatcher
+// -------------------------------------------------------------------
+
+TriggerMatcher::TriggerMatcher() : _classes(1), _state(0), _vec_width(0) {
+    memset(_class, 0, sizeof(_class));
+    memset(_first, 0, sizeof(_first));
+    memset(_second, 0, sizeof(_second));
+}
+
+TriggerMatcher::~TriggerMatcher() {
+    for (auto &t : _triggers) {
+        if (t.compiled)
+            regfree(&t.re);
+    }
+}
+
+uint8_t TriggerMatcher::compile(const std::vector<TriggerSpec> &specs, size_t *bad_index,
+                                std::string *error) {
+    if (specs.size() > TRIGGER_MAX_COUNT) {
+        *bad_index = TRIGGER_MAX_COUNT;
+        *error = "too many triggers";
+        return TRIGGERS_TOO_MANY;
+    }
+
+    // regex_t is copied bitwise into place and must not move afterwards
+    _triggers.reserve(specs.size());
+    for (size_t i = 0; i < specs.size(); i++) {
+        const TriggerSpec &spec = specs[i];
+        *bad_index = i;
+
+        Trigger t;
+        t.id = spec.id;
+        t.flags = spec.flags;
+        t.compiled = false;
+        t.armed = true;
+        t.last_fired_ns = 0;
+        t.suppressed = 0;
+        t.fired_line = 0;
+
+        if (spec.pattern.empty() || spec.pattern.size() > TRIGGER_MAX_PATTERN) {
+            *error = "pattern empty or too long";
+            return TRIGGERS_BAD_PATTERN;
+        }
+        if (spec.flags & TRIGGER_REGEX) {
+            if (spec.pattern.find('\0') != std::string::npos ||
+                !required_literal(spec.pattern, &t.literal)) {
+                *error = "regex has no required literal outside groups and alternation";
+                return TRIGGERS_BAD_PATTERN;
+            }
+            int cflags = REG_EXTENDED;
+            if (spec.flags & TRIGGER_IGNORE_CASE)
+                cflags |= REG_ICASE;
+            int rc = regcomp(&t.re, spec.pattern.c_str(), cflags);
+            if (rc != 0) {
+                char msg[128];
+                regerror(rc, &t.re, msg, sizeof(msg));
+                *error = msg;
+                return TRIGGERS_BAD_PATTERN;
+            }
+            t.compiled = true;
+        } else {
+            if (spec.pattern.size() < TRIGGER_MIN_LITERAL) {
+                *error = "literal too short";
+                return TRIGGERS_BAD_PATTERN;
+            }
+            t.literal = spec.pattern;
+        }
+        _triggers.push_back(t);
+    }
+
+    // Byte classes: one per distinct folded pattern byte, 0 for the rest
+    for (const auto &t : _triggers) {
+        for (char ch : t.literal) {
+            uint8_t f = fold(static_cast<uint8_t>(ch));
+            if (!_class[f])
+                _class[f] = static_cast<uint8_t>(_classes++);
+        }
+    }
+    for (int b = 'A'; b <= 'Z'; b++)
+        _class[b] = _class[fold(static_cast<uint8_t>(b))];
+
+    // Trie; 0 means "no edge" while building since nothing leads to the root
+    const size_t C = _classes;
+    _delta.assign(C, 0);
+    std::vector<std::vector<uint16_t>> out(1);
+    for (size_t idx = 0; idx < _triggers.size(); idx++) {
+        size_t st = 0;
+        for (char ch : _triggers[idx].literal) {
+            size_t cls = _class[static_cast<uint8_t>(ch)];
+            size_t next = _delta[st * C + cls];
+            if (!next) {
+                next = out.size();
+                _delta[st * C + cls] = static_cast<uint16_t>(next);
+                _delta.resize(_delta.size() + C, 0);
+                out.emplace_back();
+            }
+            st = next;
+        }
+        out[st].push_back(static_cast<uint16_t>(idx));
+    }
+
+    // Failure links in BFS order, folded into a full transition table
+    std::vector<uint16_t> fail(out.size(), 0);
+    std::vector<uint16_t> queue;
+    for (size_t c = 0; c < C; c++) {
+        if (_delta[c])
+            queue.push_back(_delta[c]);
+    }
+    for (size_t qi = 0; qi < queue.size(); qi++) {
+        size_t u = queue[qi];
+        for (size_t c = 0; c < C; c++) {
+            uint16_t v = _delta[u * C + c];
+            uint16_t f = _delta[fail[u] * C + c];
+            if (v) {
+                fail[v] = f;
+                out[v].insert(out[v].end(), out[f].begin(), out[f].end());
+                queue.push_back(v);
+            } else {
+                _delta[u * C + c] = f;
+            }
+        }
+    }
+
+    _out_start.assign(1, 0);
+    _out.clear();
+    for (const auto &o : out) {
+        _out.insert(_out.end(), o.begin(), o.end());
+        _out_start.push_back(static_cast<uint32_t>(_out.size()));
+    }
+
+    // Root acceleration sets
+    for (const auto &t : _triggers) {
+        mark_byte(_first, static_cast<uint8_t>(t.literal[0]));
+        mark_byte(_second, static_cast<uint8_t>(t.literal[1]));
+    }
+    uint8_t first[256], second[256];
+    size_t nf = 0, ns = 0;
+    bool seen_first[256] = {}, seen_second[256] = {};
+    for (int b = 0; b < 256; b++) {
+        uint8_t v = static_cast<uint8_t>(b | 0x20);
+        if (_first[b] && !seen_first[v]) {
+            seen_first[v] = true;
+            first[nf++] = v;
+        }
+        if (_second[b] && !seen_second[v]) {
+            seen_second[v] = true;
+            second[ns++] = v;
+        }
+    }
+    // Pad to a fixed width by repeating the last value
+    size_t widest = std::max(nf, ns);
+    _vec_width = widest == 0 ? 0 : widest <= 1 ? 1 : widest <= 2 ? 2 : widest <= 4 ? 4 :
+                 widest <= VECTOR_SET_MAX ? VECTOR_SET_MAX : 0;
+    for (size_t k = 0; k < _vec_width; k++) {
+        _vec_first[k] = first[std::min(k, nf - 1)];
+        _vec_second[k] = second[std::min(k, ns - 1)];
+    }
+
+    _state = 0;
+    _pending.clear();
+    return TRIGGERS_OK;
+}
+
+// First i in [from, len - 1) where (data[i] | 0x20) is one of first and
+// (data[i + 1] | 0x20) one of second: a superset of the real candidates.
+// Returns the position reached when it runs out of whole vectors.
+template <size_t W>
+static size_t skip_vector(const uint8_t *data, size_t i, size_t len, const uint8_t *first,
+                          const uint8_t *second, bool *found) {
+    *found = false;
+#if defined(__SSE2__)
+    const __m128i fold = _mm_set1_epi8(0x20);
+    __m128i f[W], s[W];
+    for (size_t k = 0; k < W; k++) {
+        f[k] = _mm_set1_epi8(static_cast<char>(first[k]));
+        s[k] = _mm_set1_epi8(static_cast<char>(second[k]));
+    }
+    for (; i + 17 <= len; i += 16) {
+        __m128i b0 = _mm_or_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), fold);
+        __m128i b1 = _mm_or_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1)), fold);
+        __m128i m0 = _mm_cmpeq_epi8(b0, f[0]);
+        __m128i m1 = _mm_cmpeq_epi8(b1, s[0]);
+        for (size_t k = 1; k < W; k++) {
+            m0 = _mm_or_si128(m0, _mm_cmpeq_epi8(b0, f[k]));
+            m1 = _mm_or_si128(m1, _mm_cmpeq_epi8(b1, s[k]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(m0, m1)));
+        if (mask) {
+            *found = true;
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t fold = vdupq_n_u8(0x20);
+    uint8x16_t f[W], s[W];
+    for (size_t k = 0; k < W; k++) {
+        f[k] = vdupq_n_u8(first[k]);
+        s[k] = vdupq_n_u8(second[k]);
+    }
+    for (; i + 17 <= len; i += 16) {
+        uint8x16_t b0 = vorrq_u8(vld1q_u8(data + i), fold);
+        uint8x16_t b1 = vorrq_u8(vld1q_u8(data + i + 1), fold);
+        uint8x16_t m0 = vceqq_u8(b0, f[0]);
+        uint8x16_t m1 = vceqq_u8(b1, s[0]);
+        for (size_t k = 1; k < W; k++) {
+            m0 = vorrq_u8(m0, vceqq_u8(b0, f[k]));
+            m1 = vorrq_u8(m1, vceqq_u8(b1, s[k]));
+        }
+        // Narrow to a 64-bit mask with 4 bits per byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(m0, m1)), 4)), 0);
+        if (mask) {
+            *found = true;
+            return i + static_cast<size_t>(__builtin_ctzll(mask)) / 4;
+        }
+    }
+#else
+    (void)data; (void)len; (void)first; (void)second;
+#endif
+    return i;
+}
+
+// First i in [from, len) where a match can start: data[i] in _first and
+// data[i + 1] in _second, or a _first byte at the very end whose second
+// byte has not arrived yet. Returns len if there is none. Skipping the
+// rest is exact: from the root, any other byte pair leads back to it.
+// A vector hit may be a false candidate; the automaton step sorts it out.
+size_t TriggerMatcher::skip(const uint8_t *data, size_t i, size_t len) const {
+    bool found = false;
+    switch (_vec_width) {
+    case 1: i = skip_vector<1>(data, i, len, _vec_first, _vec_second, &found); break;
+    case 2: i = skip_vector<2>(data, i, len, _vec_first, _vec_second, &found); break;
+    case 4: i = skip_vector<4>(data, i, len, _vec_first, _vec_second, &found); break;
+    case VECTOR_SET_MAX:
+        i = skip_vector<VECTOR_SET_MAX>(data, i, len, _vec_first, _vec_second, &found);
+        break;
+    default: break;
+    }
+    if (found)
+        return i;
+
+    for (; i + 1 < len; i++) {
+        if (_first[data[i]] && _second[data[i + 1]])
+            return i;
+    }
+    if (i + 1 == len && _first[data[i]])
+        return i;
+    return len;
+}
+
+// Bytes [from, to) into out (replacing its contents); *start is the
+// sequence number of out[0], later than from if older bytes are gone.
+void TriggerMatcher::copy_range(const Chunk &chunk, uint64_t from, uint64_t to,
+                                std::vector<uint8_t> &out, uint64_t *start) const {
+    out.clear();
+    *start = std::max(from, chunk.seq);
+    if (from < chunk.seq && chunk.read) {
+        uint64_t before = std::min(to, chunk.seq);
+        size_t got = chunk.read(chunk.ctx, from, static_cast<size_t>(before - from), out);
+        *start = before - got;
+    }
+    if (to > chunk.seq) {
+        uint64_t lo = std::max(from, chunk.seq) - chunk.seq;
+        out.insert(out.end(), chunk.data + lo, chunk.data + (to - chunk.seq));
+    }
+}
+
+static const uint8_t *last_newline(const uint8_t *data, size_t len) {
+#if defined(__GLIBC__)
+    return static_cast<const uint8_t *>(memrchr(data, '\n', len));
+#else
+    for (size_t i = len; i-- > 0; ) {
+        if (data[i] == '\n')
+            return data + i;
+    }
+    return nullptr;
+#endif
+}
+
+// Start of the line containing pos, looking back at most TRIGGER_MAX_LINE.
+uint64_t TriggerMatcher::line_start(const Chunk &chunk, uint64_t pos) const {
+    uint64_t lo = pos > TRIGGER_MAX_LINE ? pos - TRIGGER_MAX_LINE : 0;
+    uint64_t in_chunk = std::max(lo, chunk.seq);
+    if (pos > in_chunk) {
+        const uint8_t *base = chunk.data + (in_chunk - chunk.seq);
+        const uint8_t *nl = last_newline(base, static_cast<size_t>(pos - in_chunk));
+        if (nl)
+            return in_chunk + static_cast<uint64_t>(nl - base) + 1;
+    }
+    if (lo >= chunk.seq)
+        return lo;
+
+    uint64_t start;
+    copy_range(chunk, lo, std::min(pos, chunk.seq), _scratch, &start);
+    const uint8_t *nl = last_newline(_scratch.data(), _scratch.size());
+    if (nl)
+        return start + static_cast<uint64_t>(nl - _scratch.data()) + 1;
+    return start;
+}
+
+// Find the '\n' ending the line at or after from (within the chunk): sets
+// *end to its position and returns true, or sets *end to the end of the
+// chunk and returns false if the line goes on.
+static bool find_line_end(const uint8_t *data, size_t len, uint64_t seq, uint64_t from,
+                          uint64_t *end) {
+    size_t off = from > seq ? static_cast<size_t>(from - seq) : 0;
+    const void *nl = off < len ? memchr(data + off, '\n', len - off) : nullptr;
+    if (!nl) {
+        *end = seq + len;
+        return false;
+    }
+    *end = seq + static_cast<uint64_t>(static_cast<const uint8_t *>(nl) - data);
+    return true;
+}
+
+uint64_t TriggerMatcher::line_end(const Chunk &chunk, uint64_t from) const {
+    uint64_t end;
+    find_line_end(chunk.data, chunk.len, chunk.seq, from, &end);
+    return end;
+}
+
+// True (counting the hit as suppressed) within TRIGGER_COOLDOWN_MS of the
+// trigger's last event.
+bool TriggerMatcher::cooling_down(Trigger &t, uint64_t now_ns) {
+    if (t.last_fired_ns &&
+        now_ns - t.last_fired_ns < static_cast<uint64_t>(TRIGGER_COOLDOWN_MS) * 1000000ull) {
+        t.suppressed++;
+        return true;
+    }
+    return false;
+}
+
+void TriggerMatcher::fire(Trigger &t, uint64_t match_seq, size_t match_len,
+                          uint64_t line_start, uint64_t line_end, const Chunk &chunk,
+                          uint64_t now_ns, std::vector<TriggerHit> &hits) {
+    TriggerHit hit;
+    hit.id = t.id;
+    hit.seq = match_seq;
+    hit.len = static_cast<uint32_t>(match_len);
+    hit.suppressed = t.suppressed;
+
+    // The line from its start, unless that would leave out the match
+    uint64_t match_end = match_seq + match_len;
+    uint64_t from = line_start;
+    if (match_end - from > TRIGGER_MAX_CONTEXT)
+        from = match_end - std::min<uint64_t>(match_end, TRIGGER_MAX_CONTEXT);
+    uint64_t to = std::min<uint64_t>(std::max(line_end, match_end), from + TRIGGER_MAX_CONTEXT);
+    copy_range(chunk, from, to, hit.context, &hit.context_seq);
+    if (!hit.context.empty() && hit.context.back() == '\r')
+        hit.context.pop_back();
+
+    t.suppressed = 0;
+    t.last_fired_ns = now_ns;
+    if (t.flags & TRIGGER_ONCE)
+        t.armed = false;
+    hits.push_back(std::move(hit));
+}
+
+// The automaton found trigger index's literal ending at end.
+void TriggerMatcher::matched(uint16_t index, uint64_t end, const Chunk &chunk,
+                             uint64_t now_ns, std::vector<TriggerHit> &hits) {
+    Trigger &t = _triggers[index];
+    if (!t.armed)
+        return;
+    const size_t len = t.literal.size();
+    const uint64_t start = end - len;
+
+    if (!(t.flags & TRIGGER_REGEX)) {
+        // The automaton ignores case; check it here unless asked not to
+        if (!(t.flags & TRIGGER_IGNORE_CASE)) {
+            if (start >= chunk.seq) {
+                if (memcmp(chunk.data + (start - chunk.seq), t.literal.data(), len) != 0)
+                    return;
+            } else {
+                uint64_t got;
+                copy_range(chunk, start, end, _scratch, &got);
+                if (got != start || memcmp(_scratch.data(), t.literal.data(), len) != 0)
+                    return;
+            }
+        }
+        if (!cooling_down(t, now_ns))
+            fire(t, start, len, line_start(chunk, start), line_end(chunk, end), chunk,
+                 now_ns, hits);
+        return;
+    }
+
+    // Regex: confirm once the line is complete (or at the end of this read)
+    uint64_t ls = line_start(chunk, start);
+    if (t.fired_line == ls + 1)
+        return;
+    for (const auto &p : _pending) {
+        if (p.index == index && p.line_start == ls)
+            return;
+    }
+    if (_pending.size() < TRIGGER_MAX_COUNT * 2)
+        _pending.push_back({index, ls, end});
+}
+
+// Run a pending regex over its line as read so far. Returns true once the
+// pending entry is settled: the regex matched, or the line ended without.
+bool TriggerMatcher::confirm(Pending &pending, const Chunk &chunk, uint64_t now_ns,
+                             std::vector<TriggerHit> &hits) {
+    Trigger &t = _triggers[pending.index];
+    if (!t.armed)
+        return true;
+
+    uint64_t end;
+    bool complete = find_line_end(chunk.data, chunk.len, chunk.seq, pending.scan_from, &end);
+    uint64_t from = pending.line_start;
+    bool too_long = end - from >= TRIGGER_MAX_LINE;
+    if (too_long)
+        from = end - TRIGGER_MAX_LINE;
+
+    uint64_t start;
+    copy_range(chunk, from, end, _scratch, &start);
+    if (!_scratch.empty() && _scratch.back() == '\r')
+        _scratch.pop_back();
+    _scratch.push_back('\0');
+
+    regmatch_t m;
+    if (regexec(&t.re, reinterpret_cast<const char *>(_scratch.data()), 1, &m, 0) == 0) {
+        t.fired_line = pending.line_start + 1;
+        if (!cooling_down(t, now_ns))
+            fire(t, start + static_cast<uint64_t>(m.rm_so),
+                 static_cast<size_t>(m.rm_eo - m.rm_so), start, end, chunk, now_ns, hits);
+        return true;
+    }
+    pending.scan_from = chunk.seq + chunk.len;
+    return complete || too_long;
+}
+
+void TriggerMatcher::scan(const uint8_t *data, size_t len, uint64_t seq, uint64_t now_ns,
+                          TriggerReadFn read, void *ctx, std::vector<TriggerHit> &hits) {
+    if (_triggers.empty() || len == 0)
+        return;
+    const Chunk chunk = {data, len, seq, read, ctx};
+    const uint16_t *delta = _delta.data();
+    const size_t classes = _classes;
+
+    uint16_t st = _state;
+    size_t i = 0;
+    while (i < len) {
+        if (st == 0) {
+            i = skip(data, i, len);
+            if (i >= len)
+                break;
+        }
+        st = delta[st * classes + _class[data[i]]];
+        i++;
+        for (uint32_t o = _out_start[st]; o < _out_start[st + 1]; o++)
+            matched(_out[o], seq + i, chunk, now_ns, hits);
+    }
+    _state = st;
+
+    for (size_t k = 0; k < _pending.size(); ) {
+        if (confirm(_pending[k], chunk, now_ns, hits))
+            _pending.erase(_pending.begin() + static_cast<std::ptrdiff_t>(k));
+        else
+            k++;
+    }
+}
@@ -0,0 +1,148 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Output triggers: a session's literal and regex patterns compiled into
+// one Aho-Corasick automaton over case-folded bytes that runs on every PTY
+// read. While the automaton is at its root the scan jumps between
+// candidate byte pairs 16 bytes at a time, so output that contains no
+// pattern prefix costs about as much as a vector compare.
+
+#ifndef CRT_SESSIOND_TRIGGER_H
+#define CRT_SESSIOND_TRIGGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <regex.h>
+#include <string>
+#include <vector>
+
+struct TriggerSpec {
+    uint32_t    id;
+    uint8_t     flags;                // TriggerFlags
+    std::string pattern;
+};
+
+struct TriggerHit {
+    uint32_t id;
+    uint64_t seq;                     // Sequence number of the first matched byte
+    uint32_t len;                     // Match length
+    uint32_t suppressed;              // Hits dropped by the cooldown since the last event
+    uint64_t context_seq;             // Sequence number of context[0]
+    std::vector<uint8_t> context;     // Matching line, at most TRIGGER_MAX_CONTEXT bytes
+};
+
+// Append scrollback [seq, seq + len) to out. Bytes no longer retained are
+// missing from the front; returns the number appended.
+typedef size_t (*TriggerReadFn)(void *ctx, uint64_t seq, size_t len,
+                                std::vector<uint8_t> &out);
+
+class TriggerMatcher {
+public:
+    TriggerMatcher();
+    ~TriggerMatcher();
+
+    // Non-copyable
+    TriggerMatcher(const TriggerMatcher &) = delete;
+    TriggerMatcher &operator=(const TriggerMatcher &) = delete;
+
+    // Compile specs (at most TRIGGER_MAX_COUNT). Returns a TriggerStatus;
+    // on failure *bad_index names the offending spec and *error says why.
+    uint8_t compile(const std::vector<TriggerSpec> &specs, size_t *bad_index,
+                    std::string *error);
+
+    // Scan output that has just been appended to the scrollback at
+    // [seq, seq + len), appending events to hits. Matches may span calls;
+    // read supplies earlier bytes of a line when a hit needs them.
+    void scan(const uint8_t *data, size_t len, uint64_t seq, uint64_t now_ns,
+              TriggerReadFn read, void *ctx, std::vector<TriggerHit> &hits);
+
+    size_t size() const { return _triggers.size(); }
+
+private:
+    struct Trigger {
+        uint32_t    id;
+        uint8_t     flags;
+        std::string literal;          // Pattern, or the regex's required literal
+        bool        compiled;
+        regex_t     re;
+        bool        armed;            // False once a TRIGGER_ONCE trigger fired
+        uint64_t    last_fired_ns;
+        uint32_t    suppressed;
+        uint64_t    fired_line;       // Line start of the last regex hit (+1, 0 = none)
+    };
+
+    // A regex literal hit whose line has not been fully read yet
+    struct Pending {
+        uint16_t index;
+        uint64_t line_start;
+        uint64_t scan_from;           // Where to look for the end of the line
+    };
+
+    // The chunk being scanned plus the way to reach bytes before it
+    struct Chunk {
+        const uint8_t *data;
+        size_t len;
+        uint64_t seq;
+        TriggerReadFn read;
+        void *ctx;
+    };
+
+    size_t skip(const uint8_t *data, size_t from, size_t len) const;
+    void copy_range(const Chunk &chunk, uint64_t from, uint64_t to,
+                    std::vector<uint8_t> &out, uint64_t *start) const;
+    uint64_t line_start(const Chunk &chunk, uint64_t pos) const;
+    uint64_t line_end(const Chunk &chunk, uint64_t from) const;
+    void matched(uint16_t index, uint64_t end, const Chunk &chunk, uint64_t now_ns,
+                 std::vector<TriggerHit> &hits);
+    bool confirm(Pending &pending, const Chunk &chunk, uint64_t now_ns,
+                 std::vector<TriggerHit> &hits);
+    bool cooling_down(Trigger &t, uint64_t now_ns);
+    void fire(Trigger &t, uint64_t match_seq, size_t match_len, uint64_t line_start,
+              uint64_t line_end, const Chunk &chunk, uint64_t now_ns,
+              std::vector<TriggerHit> &hits);
+
+    std::vector<Trigger> _triggers;
+
+    // Automaton: _delta[state * _classes + class] is the next state, and
+    // _out[_out_start[state] .. _out_start[state + 1]) the triggers that
+    // end there. State 0 is the root.
+    uint8_t _class[256];
+    size_t _classes;
+    std::vector<uint16_t> _delta;
+    std::vector<uint32_t> _out_start;
+    std::vector<uint16_t> _out;
+    uint16_t _state;
+
+    // Root acceleration: a match can only start at a byte in _first
+    // followed by a byte in _second (both cases of letters). The vector
+    // scan compares (byte | 0x20) against _vec_width folded values of each.
+    static constexpr size_t VECTOR_SET_MAX = 8;
+    bool _first[256];
+    bool _second[256];
+    size_t _vec_width;                // 0 = byte tables only
+    uint8_t _vec_first[VECTOR_SET_MAX];
+    uint8_t _vec_second[VECTOR_SET_MAX];
+
+    std::vector<Pending> _pending;
+    mutable std::vector<uint8_t> _scratch;
+};
+
+#endif // CRT_SESSIOND_TRIGGER_H
@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "worker.h"
+#include "log.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+static std::mutex g_worker_mutex;
+static std::condition_variable g_worker_cv;
+static std::deque<std::function<void()>> g_worker_jobs;
+static std::thread g_worker_thread;
+static bool g_worker_stopping = false;
+
+static void worker_main() {
+    std::unique_lock<std::mutex> lock(g_worker_mutex);
+    while (true) {
+        g_worker_cv.wait(lock, [] { return g_worker_stopping || !g_worker_jobs.empty(); });
+        if (g_worker_jobs.empty())
+            return;  // stopping and drained
+
+        std::function<void()> job = std::move(g_worker_jobs.front());
+        g_worker_jobs.pop_front();
+
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+void worker_submit(std::function<void()> job) {
+    std::lock_guard<std::mutex> lock(g_worker_mutex);
+    if (g_worker_stopping)
+        return;
+    if (!g_worker_thread.joinable()) {
+        // Started lazily: the daemon must not own threads across daemonize()'s fork
+        g_worker_thread = std::thread(worker_main);
+        LOG_DEBUG("worker thread started");
+    }
+    g_worker_jobs.push_back(std::move(job));
+    g_worker_cv.notify_one();
+}
+
+void worker_shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(g_worker_mutex);
+        g_worker_stopping = true;
+    }
+    g_worker_cv.notify_one();
+    if (g_worker_thread.joinable())
+        g_worker_thread.join();
+}
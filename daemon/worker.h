@@ -0,0 +1,37 @@
+/*
+    Copyright (c) 2026 Alex Fabri
+    https://fromhelloworld.com
+    https://github.com/hotbit9
+
+    This file is part of CRT Plus.
+
+    CRT Plus is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CRT Plus is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CRT Plus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Background worker thread for CPU-heavy jobs (scrollback compression) so
+// the poll() loop never stalls on them. Jobs run one at a time, FIFO.
+
+#ifndef CRT_SESSIOND_WORKER_H
+#define CRT_SESSIOND_WORKER_H
+
+#include <functional>
+
+// Queue a job for the worker thread. Starts the thread on first use.
+// Jobs must only touch state that is owned by the job or guarded by a mutex.
+void worker_submit(std::function<void()> job);
+
+// Run all queued jobs to completion and join the worker thread.
+void worker_shutdown();
+
+#endif // CRT_SESSIOND_WORKER_H